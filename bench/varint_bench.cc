@@ -0,0 +1,123 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#include "varints.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kCount      = 1 << 16;
+constexpr std::size_t kIterations = 200;
+
+const char *KernelName(dbuf::detail::varint_kernel kernel) {
+  switch (kernel) {
+  case dbuf::detail::varint_kernel::scalar:
+    return "scalar";
+  case dbuf::detail::varint_kernel::sse41:
+    return "sse4.1";
+  case dbuf::detail::varint_kernel::avx2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+template <typename Function>
+double NanosecondsPerValue(const Function &function) {
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t iteration = 0; iteration < kIterations; ++iteration) {
+    function();
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(kIterations * kCount);
+}
+
+// Returns false if the kernel writes other bytes than the scalar codec or doesn't decode them back
+template <typename T>
+bool Run(const char *field, const std::vector<T> &values, dbuf::detail::varint_kernel kernel) {
+  std::string expected;
+  dbuf::detail::encode_varints(expected, values.data(), values.size(), dbuf::detail::varint_kernel::scalar);
+  std::string encoded;
+  dbuf::detail::encode_varints(encoded, values.data(), values.size(), kernel);
+  std::vector<T> decoded(values.size());
+  std::string_view in = encoded;
+  if (encoded != expected || !dbuf::detail::decode_varints(in, decoded.data(), decoded.size(), kernel) ||
+      !in.empty() || decoded != values) {
+    std::fprintf(stderr, "%s: %s kernel doesn't match the scalar codec\n", field, KernelName(kernel));
+    return false;
+  }
+
+  const double encode_time = NanosecondsPerValue([&] {
+    encoded.clear();
+    dbuf::detail::encode_varints(encoded, values.data(), values.size(), kernel);
+  });
+  const double decode_time = NanosecondsPerValue([&] {
+    in = encoded;
+    dbuf::detail::decode_varints(in, decoded.data(), decoded.size(), kernel);
+  });
+  std::printf(
+      "%-8s %-8s encode %6.2f ns/value, decode %6.2f ns/value\n",
+      field,
+      KernelName(kernel),
+      encode_time,
+      decode_time);
+  return true;
+}
+
+template <typename T>
+bool Compare(const char *field, const std::vector<T> &values) {
+  const auto kernel = dbuf::detail::default_varint_kernel();
+  return Run(field, values, dbuf::detail::varint_kernel::scalar) &&
+         (kernel == dbuf::detail::varint_kernel::scalar || Run(field, values, kernel));
+}
+
+} // namespace
+
+int main() {
+  std::mt19937_64 random(42);
+  dbuf::Samples samples;
+  samples.count = kCount;
+  samples.deltas.resize(kCount);
+  samples.ids.resize(kCount);
+  samples.levels.resize(kCount);
+  // Mostly small values with a few long varints, like deltas and ids of typical payloads
+  for (std::size_t ind = 0; ind < kCount; ++ind) {
+    const bool large    = random() % 64 == 0;
+    samples.deltas[ind] = static_cast<int>(large ? random() % 100000 : random() % 100) - (large ? 50000 : 50);
+    samples.ids[ind]    = large ? random() : random() % 128;
+    samples.levels[ind] = static_cast<std::int8_t>(static_cast<int>(random() % 128) - 64);
+  }
+
+  const bool matches =
+      Compare("deltas", samples.deltas) && Compare("ids", samples.ids) && Compare("levels", samples.levels);
+  if (!matches) {
+    return EXIT_FAILURE;
+  }
+
+  // The generated codecs use the detected kernel
+  std::string encoded;
+  samples.encode(encoded);
+  dbuf::Samples decoded;
+  std::string_view in = encoded;
+  if (!decoded.decode(in) || decoded.deltas != samples.deltas || decoded.ids != samples.ids ||
+      decoded.levels != samples.levels) {
+    std::fprintf(stderr, "Samples don't survive encode() and decode()\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -13,18 +13,31 @@ the Free Software Foundation, either version 3 of the License, or
 #include "core/ast/expression.h"
 #include "core/interning/interned_string.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 #include <vector>
 
 namespace dbuf::ast {
 
+// Field annotation, that moves the field out of the hot part of the generated type
+inline constexpr std::string_view kColdAnnotation = "cold";
+
 struct TypedVariable : NamedType {
   TypeExpression type_expression;
+  // Annotations of a field, like `[cold]`, dependencies have none
+  std::vector<Identifier> annotations = {};
+
+  [[nodiscard]] bool HasAnnotation(std::string_view annotation) const {
+    return std::any_of(annotations.begin(), annotations.end(), [annotation](const Identifier &identifier) {
+      return identifier.name.GetString() == annotation;
+    });
+  }
 };
 inline std::ostream &operator<<(std::ostream &os, const TypedVariable &var) {
   os << var.name << " " << var.type_expression;
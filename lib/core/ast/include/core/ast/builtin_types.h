@@ -0,0 +1,111 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#pragma once
+
+#include "core/interning/interned_string.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace dbuf::ast {
+
+/**
+ * @brief Kind of the values of a builtin type, a literal is accepted by every type of its kind that fits it
+ *
+ */
+enum struct BuiltinKind { Bool, Signed, Unsigned, Float, String };
+
+/**
+ * @brief Describes a builtin scalar type, like `Int` or `UInt8`
+ *
+ */
+struct BuiltinType {
+  std::string_view name;
+  BuiltinKind kind;
+  // Width of the values in bits, 0 for the types without a fixed width
+  uint8_t bits = 0;
+  // Encoded as exactly bits / 8 bytes instead of a varint
+  bool fixed = false;
+
+  [[nodiscard]] bool Fits(int64_t value) const {
+    if (kind != BuiltinKind::Signed) {
+      return false;
+    }
+    if (bits == 0 || bits >= 64) {
+      return true;
+    }
+    const int64_t bound = int64_t {1} << (bits - 1);
+    return -bound <= value && value < bound;
+  }
+
+  [[nodiscard]] bool Fits(uint64_t value) const {
+    if (kind != BuiltinKind::Unsigned) {
+      return false;
+    }
+    return bits == 0 || bits >= 64 || value < (uint64_t {1} << bits);
+  }
+};
+
+inline constexpr std::array kBuiltinTypes = {
+    BuiltinType {"Bool", BuiltinKind::Bool},
+    BuiltinType {"Int", BuiltinKind::Signed},
+    BuiltinType {"Int8", BuiltinKind::Signed, 8},
+    BuiltinType {"Int16", BuiltinKind::Signed, 16},
+    BuiltinType {"Int32", BuiltinKind::Signed, 32},
+    BuiltinType {"Int64", BuiltinKind::Signed, 64},
+    BuiltinType {"Unsigned", BuiltinKind::Unsigned},
+    BuiltinType {"UInt8", BuiltinKind::Unsigned, 8},
+    BuiltinType {"UInt16", BuiltinKind::Unsigned, 16},
+    BuiltinType {"UInt32", BuiltinKind::Unsigned, 32},
+    BuiltinType {"UInt64", BuiltinKind::Unsigned, 64},
+    BuiltinType {"Fixed32", BuiltinKind::Unsigned, 32, true},
+    BuiltinType {"Fixed64", BuiltinKind::Unsigned, 64, true},
+    BuiltinType {"Float", BuiltinKind::Float, 64, true},
+    BuiltinType {"Float32", BuiltinKind::Float, 32, true},
+    BuiltinType {"String", BuiltinKind::String},
+};
+
+/**
+ * @brief Returns the builtin type with the name, or nullptr for the types defined in the schema
+ *
+ * Names are compared by id with the names of the builtin types, which are interned once and kept for the whole run.
+ */
+inline const BuiltinType *FindBuiltinType(const InternedString &name) {
+  static const auto kNames = [] {
+    std::array<InternedString, kBuiltinTypes.size()> names;
+    std::transform(kBuiltinTypes.begin(), kBuiltinTypes.end(), names.begin(), [](const BuiltinType &type) {
+      return InternedString(std::string(type.name));
+    });
+    return names;
+  }();
+  const auto *iter = std::find(kNames.begin(), kNames.end(), name);
+  return iter == kNames.end() ? nullptr : &kBuiltinTypes[iter - kNames.begin()];
+}
+
+inline bool IsBuiltinType(const InternedString &name) {
+  return FindBuiltinType(name) != nullptr;
+}
+
+/**
+ * @brief Builtin sequence type `Vec T n` of exactly n elements of type T, n has type `Unsigned`
+ *
+ */
+inline constexpr std::string_view kVecType = "Vec";
+
+inline bool IsVecType(const InternedString &name) {
+  static const InternedString kName {std::string(kVecType)};
+  return name == kName;
+}
+
+} // namespace dbuf::ast
@@ -52,6 +52,12 @@ ErrorList Checker::CheckTypeResolution(const ast::AST &ast) {
   return type_expression_checker.CheckTypes();
 }
 
+ErrorList
+Checker::CheckTypeResolution(const ast::AST &ast, const std::vector<InternedString> &types, Z3stuff &z3_stuff) {
+  TypeChecker type_expression_checker(ast, z3_stuff);
+  return type_expression_checker.CheckTypes(types);
+}
+
 int Checker::CheckAll(ast::AST &ast) {
   ErrorList name_resolution_errors = CheckNameResolution(ast);
   if (!name_resolution_errors.empty()) {
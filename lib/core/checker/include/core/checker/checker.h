@@ -12,8 +12,11 @@ the Free Software Foundation, either version 3 of the License, or
 
 #include "core/ast/ast.h"
 #include "core/checker/common.h"
+#include "core/checker/expression_comparator.h"
 #include "core/interning/interned_string.h"
 
+#include <vector>
+
 namespace dbuf::checker {
 
 class Checker {
@@ -23,6 +26,13 @@ public:
   static ErrorList CheckNameResolution(const ast::AST &ast);
   static ErrorList CheckPositivity(ast::AST &ast);
   static ErrorList CheckTypeResolution(const ast::AST &ast);
+  /**
+   * @brief Checks only the given types, in visit order
+   *
+   * The other types are taken from the z3 datatypes of previous checks, the checked ones replace their datatypes.
+   */
+  static ErrorList
+  CheckTypeResolution(const ast::AST &ast, const std::vector<InternedString> &types, Z3stuff &z3_stuff);
 
   static int CheckAll(ast::AST &ast);
 };
@@ -13,6 +13,7 @@ the Free Software Foundation, either version 3 of the License, or
 #include "core/ast/ast.h"
 #include "core/ast/expression.h"
 #include "core/interning/interned_string.h"
+#include "core/patterns/decision_tree.h"
 #include "glog/logging.h"
 
 #include <cassert>
@@ -23,11 +24,15 @@ the Free Software Foundation, either version 3 of the License, or
 #include <set>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 namespace dbuf::checker {
 
 using DependencyGraph = std::map<InternedString, std::set<InternedString>>;
 
+// Compiled pattern matching of every enum
+using DecisionTrees = std::unordered_map<InternedString, patterns::DecisionTree>;
+
 struct Error { // NOLINT(bugprone-exception-escape)
   std::string message;
 };
@@ -11,25 +11,31 @@ the Free Software Foundation, either version 3 of the License, or
 #pragma once
 
 #include "core/ast/ast.h"
+#include "core/ast/builtin_types.h"
 #include "core/checker/common.h"
 #include "glog/logging.h"
 #include "location.hh"
 #include "z3++.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <sstream>
+#include <string>
+#include <unordered_map>
 
 namespace dbuf::checker {
 
 struct Z3stuff {
   explicit Z3stuff()
-      : solver_(context_)
-      , sorts_(
-            {{InternedString("Int"), context_.int_sort()},
-             {InternedString("Unsigned"), context_.int_sort()},
-             {InternedString("Float"), context_.real_sort()},
-             {InternedString("Bool"), context_.bool_sort()},
-             {InternedString("Float"), context_.real_sort()},
-             {InternedString("String"), context_.string_sort()}}) {}
+      : solver_(context_) {
+    for (const auto &builtin : ast::kBuiltinTypes) {
+      sorts_.emplace(InternedString(std::string(builtin.name)), GetSort(builtin.kind));
+    }
+    // Sequences are never compared by value, only their lengths are
+    const InternedString vec_name(std::string(ast::kVecType));
+    sorts_.emplace(vec_name, context_.uninterpreted_sort(vec_name.GetString().c_str()));
+  }
 
   using NameToSort        = std::unordered_map<InternedString, z3::sort>;        // NameToSort[type_name] = sort
   using NameToConstructor = std::unordered_map<InternedString, z3::func_decl>;   // NameToConstructor[cons_name] = cons
@@ -41,6 +47,59 @@ struct Z3stuff {
   NameToSort sorts_;               // z3_sorts_[type_name] = sort
   NameToConstructor constructors_; // z3_constructors_[cons_name] = constructor
   NameToFields accessors_;         // z3_accessors_[cons_name][field_name] = accessor
+  // Number of datatypes declared in the context, z3 never releases them
+  size_t declarations_ = 0;
+
+  /**
+   * @brief Symbol for a new datatype of the type
+   *
+   * z3 merges datatypes declared with the same name in one context, so a type checked again with another definition
+   * gets a new name for its datatype.
+   */
+  z3::symbol GetDatatypeSymbol(const InternedString &type_name) {
+    const size_t version = versions_[type_name]++;
+    ++declarations_;
+    if (version == 0) {
+      return context_.str_symbol(type_name.GetString().c_str());
+    }
+    return context_.str_symbol((type_name.GetString() + "'" + std::to_string(version)).c_str());
+  }
+
+  /**
+   * @brief Asserts the bounds of the values of the type for the expression, if the type is a fixed-width integer
+   *
+   * Fixed-width integers are bounded integers, so that they can be compared with the unbounded ones and literals.
+   * Must be called inside of the solver scope of the comparison.
+   */
+  void AddBounds(const z3::expr &expr, const InternedString &type_name) {
+    const ast::BuiltinType *builtin = ast::FindBuiltinType(type_name);
+    if (builtin == nullptr || builtin->bits == 0 || builtin->kind == ast::BuiltinKind::Float) {
+      return;
+    }
+    const bool is_signed = builtin->kind == ast::BuiltinKind::Signed;
+    // The largest value is 2^(bits - 1) - 1 for signed types and 2^bits - 1 for unsigned ones
+    const uint64_t max   = std::numeric_limits<uint64_t>::max() >> (64 - builtin->bits + (is_signed ? 1 : 0));
+    const z3::expr lower = is_signed ? context_.int_val(-static_cast<int64_t>(max) - 1) : context_.int_val(0);
+    solver_.add(lower <= expr && expr <= context_.int_val(max));
+  }
+
+private:
+  std::unordered_map<InternedString, size_t> versions_;
+
+  z3::sort GetSort(ast::BuiltinKind kind) {
+    switch (kind) {
+    case ast::BuiltinKind::Bool:
+      return context_.bool_sort();
+    case ast::BuiltinKind::Signed:
+    case ast::BuiltinKind::Unsigned:
+      return context_.int_sort();
+    case ast::BuiltinKind::Float:
+      return context_.real_sort();
+    case ast::BuiltinKind::String:
+      return context_.string_sort();
+    }
+    return context_.int_sort();
+  }
 };
 
 struct ExpressionToZ3 {
@@ -93,6 +152,7 @@ struct ExpressionToZ3 {
               var_access.var_identifier.name.GetString().c_str(),
               z3_stuff.sorts_.at(GetVarAccessType(new_access, ast, &context).identifier.name)));
       it = it2;
+      z3_stuff.AddBounds(it->second, GetVarAccessType(new_access, ast, &context).identifier.name);
     }
     z3::expr expr = it->second; // z3 symbol corresponding to the var_access base
 
@@ -105,6 +165,7 @@ struct ExpressionToZ3 {
       DLOG(INFO) << "Current expr is " << expr;
       // Update the new_access
       new_access.field_identifiers.push_back(ast::Identifier {{parser::location()}, {field.name}});
+      z3_stuff.AddBounds(expr, GetVarAccessType(new_access, ast, &context).identifier.name);
     }
     return expr;
   } // NOLINT(clang-diagnostic-return-type)
@@ -33,13 +33,26 @@ namespace dbuf::checker {
 class TypeChecker {
 public:
   explicit TypeChecker(const ast::AST &ast);
+  /**
+   * @brief Checks with the z3 datatypes declared by previous checks, the checked types replace their datatypes
+   *
+   */
+  TypeChecker(const ast::AST &ast, Z3stuff &z3_stuff);
 
   ErrorList CheckTypes();
 
+  /**
+   * @brief Checks only the given types, every type must come after its dependencies
+   *
+   */
+  ErrorList CheckTypes(const std::vector<InternedString> &types);
+
   void operator()(const ast::Message &ast_message);
   void operator()(const ast::Enum &ast_enum);
 
 private:
+  void BuildDecisionTrees();
+
   /**
    * @brief Check that all dependencies are correctly defined
    *
@@ -54,6 +67,12 @@ private:
   void CheckFields(const ast::TypeWithFields &type);
 
   void CheckTypeExpression(const ast::TypeExpression &type_expression);
+  /**
+   * @brief Check that `Vec T n` has a type of elements and a length of type `Unsigned`
+   *
+   * @param type_expression
+   */
+  void CheckVecTypeExpression(const ast::TypeExpression &type_expression);
 
   ast::TypeExpression GetVarAccessType(const ast::VarAccess &var_access);
 
@@ -64,7 +83,10 @@ private:
   std::deque<Scope *> context_;
   ErrorList errors_;
 
-  Z3stuff z3_stuff_;
+  // Owned only if the checker doesn't use datatypes of previous checks
+  std::optional<Z3stuff> own_z3_stuff_;
+  Z3stuff &z3_stuff_;
+  DecisionTrees decision_trees_;
 };
 
 } // namespace dbuf::checker
@@ -10,28 +10,34 @@ the Free Software Foundation, either version 3 of the License, or
 */
 #pragma once
 #include "core/ast/ast.h"
+#include "core/ast/builtin_types.h"
 #include "core/ast/expression.h"
 #include "core/checker/common.h"
 #include "core/checker/expression_comparator.h"
 #include "core/substitutor/substitutor.h"
 
+#include <cstdint>
 #include <optional>
+#include <type_traits>
+#include <utility>
 
 namespace dbuf::checker {
 
 class TypeComparator {
 public:
   explicit TypeComparator(
-      const ast::TypeExpression &expected,
+      Substitutor::LazyTypeExpression expected,
       const ast::AST &ast,
       std::deque<Scope *> *context_ptr,
       Substitutor *substitutor_ptr,
-      Z3stuff *z3_stuff_ptr)
-      : expected_(expected)
+      Z3stuff *z3_stuff_ptr,
+      const DecisionTrees &decision_trees)
+      : expected_(std::move(expected))
       , ast_(ast)
       , context_(*context_ptr)
       , substitutor_(*substitutor_ptr)
-      , z3_stuff_(*z3_stuff_ptr) {}
+      , z3_stuff_(*z3_stuff_ptr)
+      , decision_trees_(decision_trees) {}
 
   [[nodiscard]] std::optional<Error> Compare(const ast::Expression &expr);
 
@@ -43,12 +49,22 @@ public:
   std::optional<Error> operator()(const ast::Value &val);
 
   // Value specifications
+  // Literals are accepted by every builtin type of their kind, integers only if they fit in it
   template <typename T>
   std::optional<Error> operator()(const ast::ScalarValue<T> &val) {
-    if (expected_.identifier.name != GetTypename(val)) {
+    const InternedString &expected_name = expected_.GetIdentifier().name;
+    const ast::BuiltinType *expected    = ast::FindBuiltinType(expected_name);
+    if (expected == nullptr || expected->kind != ast::FindBuiltinType(GetTypename(val))->kind) {
       return Error(
           CreateError() << "Got value of type \"" << GetTypename(val) << "\", but expected type is \""
-                        << expected_.identifier.name << "\" at " << val.location);
+                        << expected_name << "\" at " << val.location);
+    }
+    if constexpr (std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t>) {
+      if (!expected->Fits(val.value)) {
+        return Error(
+            CreateError() << "Value " << val.value << " does not fit in type \"" << expected_name << "\" at "
+                          << val.location);
+      }
     }
     return {};
   }
@@ -56,31 +72,33 @@ public:
   std::optional<Error> operator()(const ast::ConstructedValue &val);
 
 private:
-  const ast::TypeExpression &expected_;
+  // Parameters of the expected type are substituted only if they are inspected
+  Substitutor::LazyTypeExpression expected_;
   const ast::AST &ast_;
   std::deque<Scope *> &context_;
   Substitutor &substitutor_;
   Z3stuff &z3_stuff_;
+  const DecisionTrees &decision_trees_;
 
   [[nodiscard]] std::optional<Error> CompareTypeExpressions(
-      const ast::TypeExpression &expected_type,
+      const Substitutor::LazyTypeExpression &expected_type,
       const ast::TypeExpression &expression,
       Z3stuff &z3_stuff) {
-    if (expected_type.identifier.name != expression.identifier.name) {
+    if (expected_type.GetIdentifier().name != expression.identifier.name) {
       return Error(
           CreateError() << "Got type \"" << expression.identifier.name << "\", but expected type is \""
-                        << expected_type.identifier.name << "\" at " << expression.location);
+                        << expected_type.GetIdentifier().name << "\" at " << expression.location);
     }
 
-    if (expected_type.parameters.size() != expression.parameters.size()) {
+    if (expected_type.GetParametersCount() != expression.parameters.size()) {
       return Error(
-          CreateError() << "Expected " << expected_type.parameters.size() << "type parametes, but got "
+          CreateError() << "Expected " << expected_type.GetParametersCount() << "type parametes, but got "
                         << expression.parameters.size() << " at " << expression.location);
     }
 
-    for (size_t id = 0; id < expected_type.parameters.size(); ++id) {
+    for (size_t id = 0; id < expected_type.GetParametersCount(); ++id) {
       auto error =
-          CompareExpressions(*expected_type.parameters[id], *expression.parameters[id], z3_stuff, ast_, context_);
+          CompareExpressions(*expected_type.GetParameter(id), *expression.parameters[id], z3_stuff, ast_, context_);
       if (error) {
         return Error(
             CreateError() << "Type parameter " << id << " mismatch: " << error->message << " at "
@@ -11,12 +11,14 @@ the Free Software Foundation, either version 3 of the License, or
 #include "core/checker/name_resolution_checker.h"
 
 #include "core/ast/ast.h"
+#include "core/ast/builtin_types.h"
 #include "core/ast/expression.h"
 #include "core/interning/interned_string.h"
 #include "glog/logging.h"
 
 #include <algorithm>
 #include <sstream>
+#include <string>
 #include <variant>
 
 namespace dbuf::checker {
@@ -184,11 +186,10 @@ void NameResolutionChecker::AddFields(const InternedString &constructor_name, co
 }
 
 void NameResolutionChecker::AddGlobalNames(const ast::AST &ast) {
-  AddName(InternedString("Int"), "type", false);
-  AddName(InternedString("Unsigned"), "type", false);
-  AddName(InternedString("String"), "type", false);
-  AddName(InternedString("Float"), "type", false);
-  AddName(InternedString("Bool"), "type", false);
+  for (const auto &builtin : ast::kBuiltinTypes) {
+    AddName(InternedString(std::string(builtin.name)), "type", false);
+  }
+  AddName(InternedString(std::string(ast::kVecType)), "type", false);
 
   auto visitor = [this](const auto &type) {
     if constexpr (std::is_same_v<std::decay_t<decltype(type)>, ast::Message>) {
@@ -94,6 +94,7 @@ PositivityChecker::Result PositivityChecker::TopSortGraph() const {
   std::stringstream message_stream;
   Result result;
 
+  // Types and their dependencies are visited in the order of names, so the order of definitions doesn't matter
   for (const auto &[type_name, _] : dependency_graph_) {
     if (!node_states.contains(type_name)) {
       std::vector<InternedString> cycle = Visit(type_name, sorted, node_states);
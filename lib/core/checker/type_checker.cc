@@ -11,17 +11,20 @@ the Free Software Foundation, either version 3 of the License, or
 #include "core/checker/type_checker.h"
 
 #include "core/ast/ast.h"
+#include "core/ast/builtin_types.h"
 #include "core/ast/expression.h"
 #include "core/checker/common.h"
 #include "core/checker/expression_comparator.h"
 #include "core/checker/type_comparator.h"
 #include "core/interning/interned_string.h"
+#include "core/patterns/decision_tree.h"
 #include "glog/logging.h"
 #include "location.hh"
 #include "z3++.h"
 
 #include <cstddef>
 #include <optional>
+#include <utility>
 #include <ranges>
 #include <stdexcept>
 #include <string>
@@ -31,10 +34,32 @@ the Free Software Foundation, either version 3 of the License, or
 namespace dbuf::checker {
 
 TypeChecker::TypeChecker(const ast::AST &ast)
-    : ast_(ast) {}
+    : ast_(ast)
+    , own_z3_stuff_(std::in_place)
+    , z3_stuff_(*own_z3_stuff_) {
+  BuildDecisionTrees();
+}
+
+TypeChecker::TypeChecker(const ast::AST &ast, Z3stuff &z3_stuff)
+    : ast_(ast)
+    , z3_stuff_(z3_stuff) {
+  BuildDecisionTrees();
+}
+
+void TypeChecker::BuildDecisionTrees() {
+  for (const auto &[name, type] : ast_.types) {
+    if (std::holds_alternative<ast::Enum>(type)) {
+      decision_trees_.emplace(name, patterns::DecisionTree(std::get<ast::Enum>(type)));
+    }
+  }
+}
 
 ErrorList TypeChecker::CheckTypes() {
-  for (const auto &node : ast_.visit_order) {
+  return CheckTypes(ast_.visit_order);
+}
+
+ErrorList TypeChecker::CheckTypes(const std::vector<InternedString> &types) {
+  for (const auto &node : types) {
     std::visit(*this, ast_.types.at(node));
   }
 
@@ -55,10 +80,11 @@ void TypeChecker::operator()(const ast::Message &ast_message) {
 
   // Create a z3 datatype for this message
 
-  z3::symbol name_symbol = z3_stuff_.context_.str_symbol(ast_message.identifier.name.GetString().c_str());
+  // Datatypes of a previous definition of the message are replaced
+  z3::symbol name_symbol = z3_stuff_.GetDatatypeSymbol(ast_message.identifier.name);
 
   z3::constructors cs(z3_stuff_.context_);
-  z3_stuff_.sorts_.emplace(ast_message.identifier.name, z3_stuff_.context_.datatype_sort(name_symbol));
+  z3_stuff_.sorts_.insert_or_assign(ast_message.identifier.name, z3_stuff_.context_.datatype_sort(name_symbol));
 
   z3::symbol recognizer_symbol =
       z3_stuff_.context_.str_symbol(("is_" + ast_message.identifier.name.GetString()).c_str());
@@ -70,7 +96,12 @@ void TypeChecker::operator()(const ast::Message &ast_message) {
     accessor_sorts.push_back(z3_stuff_.sorts_.at(field.type_expression.identifier.name));
   }
 
-  cs.add(name_symbol, recognizer_symbol, ast_message.fields.size(), accessor_names.data(), accessor_sorts.data());
+  cs.add(
+      z3_stuff_.context_.str_symbol(ast_message.identifier.name.GetString().c_str()),
+      recognizer_symbol,
+      ast_message.fields.size(),
+      accessor_names.data(),
+      accessor_sorts.data());
 
   z3_stuff_.sorts_.at(ast_message.identifier.name) = z3_stuff_.context_.datatype(name_symbol, cs);
   DLOG(INFO) << "Created a message sort: " << z3_stuff_.sorts_.at(ast_message.identifier.name);
@@ -83,10 +114,10 @@ void TypeChecker::operator()(const ast::Message &ast_message) {
   // Query them from the constructors
   cs.query(0, message_constructor, is_message_constructor_recognizer, field_accessors);
 
-  z3_stuff_.constructors_.emplace(ast_message.identifier.name, message_constructor);
+  z3_stuff_.constructors_.insert_or_assign(ast_message.identifier.name, message_constructor);
   DLOG(INFO) << "Constructor: " << message_constructor;
 
-  z3_stuff_.accessors_.emplace(ast_message.identifier.name, Z3stuff::FieldToAccessor());
+  z3_stuff_.accessors_.insert_or_assign(ast_message.identifier.name, Z3stuff::FieldToAccessor());
   for (size_t i = 0; i < ast_message.fields.size(); ++i) {
     z3_stuff_.accessors_.at(ast_message.identifier.name).emplace(ast_message.fields[i].name, field_accessors[i]);
     DLOG(INFO) << "Accessor for field " << ast_message.fields[i].name << ": " << field_accessors[i];
@@ -128,9 +159,14 @@ void TypeChecker::operator()(const ast::Enum &ast_enum) {
       substitutor_.AddSubstitution(ast_enum.type_dependencies[id].name, std::make_shared<const ast::Expression>(value));
 
       // Check that value has expected type in this context
-      auto type_err =
-          TypeComparator(ast_enum.type_dependencies[id].type_expression, ast_, &context_, &substitutor_, &z3_stuff_)
-              .Compare(ast::Expression(value));
+      auto type_err = TypeComparator(
+                          Substitutor::LazyTypeExpression(ast_enum.type_dependencies[id].type_expression),
+                          ast_,
+                          &context_,
+                          &substitutor_,
+                          &z3_stuff_,
+                          decision_trees_)
+                          .Compare(ast::Expression(value));
       if (type_err) {
         errors_.emplace_back(*type_err);
         return;
@@ -203,8 +239,8 @@ void TypeChecker::operator()(const ast::Enum &ast_enum) {
   // Create a z3 sort for this enum
 
   z3::constructors cs(z3_stuff_.context_);
-  z3::symbol name_symbol = z3_stuff_.context_.str_symbol(ast_enum.identifier.name.GetString().c_str());
-  z3_stuff_.sorts_.emplace(ast_enum.identifier.name, z3_stuff_.context_.datatype_sort(name_symbol));
+  z3::symbol name_symbol = z3_stuff_.GetDatatypeSymbol(ast_enum.identifier.name);
+  z3_stuff_.sorts_.insert_or_assign(ast_enum.identifier.name, z3_stuff_.context_.datatype_sort(name_symbol));
 
   for (const auto &rule : ast_enum.pattern_mapping) {
     for (const auto &constructor : rule.outputs) {
@@ -237,10 +273,10 @@ void TypeChecker::operator()(const ast::Enum &ast_enum) {
 
       cs.query(constructor_idx, z3_constructor, is_z3_constructor_recognizer, field_accessors);
 
-      z3_stuff_.constructors_.emplace(constructor.identifier.name, z3_constructor);
+      z3_stuff_.constructors_.insert_or_assign(constructor.identifier.name, z3_constructor);
       DLOG(INFO) << "Constructor \"" << constructor.identifier.name << "\": " << z3_constructor;
 
-      z3_stuff_.accessors_.emplace(constructor.identifier.name, Z3stuff::FieldToAccessor());
+      z3_stuff_.accessors_.insert_or_assign(constructor.identifier.name, Z3stuff::FieldToAccessor());
       for (size_t i = 0; i < constructor.fields.size(); ++i) {
         z3_stuff_.accessors_.at(constructor.identifier.name).emplace(constructor.fields[i].name, field_accessors[i]);
         DLOG(INFO) << "Accessor for field " << constructor.fields[i].name << ": " << field_accessors[i];
@@ -258,7 +294,13 @@ void TypeChecker::CheckDependencies(const ast::DependentType &type) {
   DLOG(INFO) << "Checking dependencies";
   for (const auto &dependency : type.type_dependencies) {
     DLOG(INFO) << "Checking dependency: " << dependency;
-    CheckTypeExpression(dependency.type_expression);
+    if (ast::IsVecType(dependency.type_expression.identifier.name)) {
+      errors_.emplace_back(
+          CreateError() << "Dependency \"" << dependency.name << "\" can't be a sequence at "
+                        << dependency.type_expression.location);
+    } else {
+      CheckTypeExpression(dependency.type_expression);
+    }
 
     // After we checked the depdency we can add it to scope to be seen by other dependencies
     scope.AddName(dependency.name, dependency.type_expression);
@@ -272,7 +314,7 @@ void TypeChecker::CheckFields(const ast::TypeWithFields &type) {
 
   for (const auto &field : type.fields) {
     DLOG(INFO) << "Checking field: " << field.name << " of type " << field.type_expression;
-    auto after_substitution = std::get<ast::TypeExpression>(substitutor_(field.type_expression));
+    auto after_substitution = substitutor_.Lazy(field.type_expression).Force();
     DLOG(INFO) << "After substitution: " << after_substitution;
     CheckTypeExpression(after_substitution);
     scope.AddName(field.name, after_substitution);
@@ -281,11 +323,11 @@ void TypeChecker::CheckFields(const ast::TypeWithFields &type) {
 
 void TypeChecker::CheckTypeExpression(const ast::TypeExpression &type_expression) {
   DLOG(INFO) << "Checking type expression: " << type_expression;
-  if (type_expression.identifier.name == InternedString("Int") ||
-      type_expression.identifier.name == InternedString("Unsigned") ||
-      type_expression.identifier.name == InternedString("Float") ||
-      type_expression.identifier.name == InternedString("Bool") ||
-      type_expression.identifier.name == InternedString("String")) {
+  if (ast::IsBuiltinType(type_expression.identifier.name)) {
+    return;
+  }
+  if (ast::IsVecType(type_expression.identifier.name)) {
+    CheckVecTypeExpression(type_expression);
     return;
   }
 
@@ -309,15 +351,14 @@ void TypeChecker::CheckTypeExpression(const ast::TypeExpression &type_expression
   for (size_t id = 0; id < type.type_dependencies.size(); ++id) {
     DLOG(INFO) << "Comparing argument " << *type_expression.parameters[id] << " against type "
                << type.type_dependencies[id].type_expression;
-    // Update type using already known substitutions
-    DLOG(INFO) << "Type before substitution: " << type.type_dependencies[id].type_expression;
-    ast::TypeExpression substituted_type =
-        std::get<ast::TypeExpression>(substitutor_(type.type_dependencies[id].type_expression));
+    // Update type using already known substitutions, parameters are substituted only if the comparator needs them
+    Substitutor::LazyTypeExpression substituted_type = substitutor_.Lazy(type.type_dependencies[id].type_expression);
     DLOG(INFO) << "Type after substitution: " << substituted_type;
 
     // Check that parameter hase exprected type
-    auto type_err = TypeComparator(substituted_type, ast_, &context_, &substitutor_, &z3_stuff_)
-                        .Compare(*type_expression.parameters[id]);
+    auto type_err =
+        TypeComparator(std::move(substituted_type), ast_, &context_, &substitutor_, &z3_stuff_, decision_trees_)
+            .Compare(*type_expression.parameters[id]);
     if (type_err) {
       errors_.emplace_back(*type_err);
       return;
@@ -329,4 +370,36 @@ void TypeChecker::CheckTypeExpression(const ast::TypeExpression &type_expression
   substitutor_.PopScope();
 }
 
+void TypeChecker::CheckVecTypeExpression(const ast::TypeExpression &type_expression) {
+  if (type_expression.parameters.size() != 2) {
+    errors_.emplace_back(
+        CreateError() << "Expected 2 parameters for typename \"" << type_expression.identifier.name << "\", but got "
+                      << type_expression.parameters.size() << " at " << type_expression.location);
+    return;
+  }
+
+  const auto *element_type = std::get_if<ast::TypeExpression>(type_expression.parameters[0].get());
+  if (element_type == nullptr || ast::IsVecType(element_type->identifier.name)) {
+    errors_.emplace_back(
+        CreateError() << "Expected type of elements as the first parameter of \"" << type_expression.identifier.name
+                      << "\" at " << type_expression.location);
+    return;
+  }
+  CheckTypeExpression(*element_type);
+
+  // Length is checked like a parameter of a dependency `n Unsigned`
+  const ast::TypeExpression length_type {{type_expression.location}, {{}, {InternedString("Unsigned")}}};
+  auto type_err = TypeComparator(
+                      Substitutor::LazyTypeExpression(length_type),
+                      ast_,
+                      &context_,
+                      &substitutor_,
+                      &z3_stuff_,
+                      decision_trees_)
+                      .Compare(*type_expression.parameters[1]);
+  if (type_err) {
+    errors_.emplace_back(*type_err);
+  }
+}
+
 } // namespace dbuf::checker
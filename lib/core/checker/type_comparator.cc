@@ -11,18 +11,33 @@ the Free Software Foundation, either version 3 of the License, or
 #include "core/checker/type_comparator.h"
 
 #include "core/ast/ast.h"
+#include "core/ast/builtin_types.h"
 #include "core/ast/expression.h"
 #include "core/checker/common.h"
 #include "core/checker/expression_comparator.h"
 #include "core/interning/interned_string.h"
+#include "core/patterns/decision_tree.h"
 #include "core/substitutor/substitutor.h"
 #include "glog/logging.h"
 
+#include <algorithm>
+#include <initializer_list>
+#include <numeric>
 #include <optional>
 #include <variant>
+#include <vector>
 
 namespace dbuf::checker {
 
+namespace {
+
+bool IsOfKind(const InternedString &type_name, std::initializer_list<ast::BuiltinKind> kinds) {
+  const ast::BuiltinType *builtin = ast::FindBuiltinType(type_name);
+  return builtin != nullptr && std::find(kinds.begin(), kinds.end(), builtin->kind) != kinds.end();
+}
+
+} // namespace
+
 struct Matcher {
   Z3stuff &z3_stuff;
   std::deque<Scope *> &context;
@@ -136,37 +151,37 @@ std::optional<Error> TypeComparator::operator()(const ast::BinaryExpression &exp
   }
 
   DLOG(INFO) << "Expression " << expr << " should be of type " << expected_;
+  const InternedString &expected_name = expected_.GetIdentifier().name;
+  using Kind = ast::BuiltinKind;
   if (expr.type == ast::BinaryExpressionType::Plus) {
-    if (expected_.identifier.name == InternedString("Int") || expected_.identifier.name == InternedString("Unsigned") ||
-        expected_.identifier.name == InternedString("String") || expected_.identifier.name == InternedString("Float")) {
+    if (IsOfKind(expected_name, {Kind::Signed, Kind::Unsigned, Kind::String, Kind::Float})) {
       return {};
     }
   }
   if (expr.type == ast::BinaryExpressionType::Star) {
-    if (expected_.identifier.name == InternedString("Int") || expected_.identifier.name == InternedString("Unsigned") ||
-        expected_.identifier.name == InternedString("Float")) {
+    if (IsOfKind(expected_name, {Kind::Signed, Kind::Unsigned, Kind::Float})) {
       return {};
     }
   }
   if (expr.type == ast::BinaryExpressionType::Minus) {
-    if (expected_.identifier.name == InternedString("Int") || expected_.identifier.name == InternedString("Float")) {
+    if (IsOfKind(expected_name, {Kind::Signed, Kind::Float})) {
       return {};
     }
   }
   if (expr.type == ast::BinaryExpressionType::Slash) {
-    if (expected_.identifier.name == InternedString("Float")) {
+    if (IsOfKind(expected_name, {Kind::Float})) {
       return {};
     }
   }
   if (expr.type == ast::BinaryExpressionType::And || expr.type == ast::BinaryExpressionType::Or) {
-    if (expected_.identifier.name == InternedString("Bool")) {
+    if (IsOfKind(expected_name, {Kind::Bool})) {
       return {};
     }
   }
   DLOG(ERROR) << "Invalid operator use in expression " << expr;
   return Error(
       CreateError() << "Operator \"" << static_cast<char>(expr.type) << "\""
-                    << " is not supported by type " << expected_.identifier.name << "\" at " << expr.location);
+                    << " is not supported by type " << expected_name << "\" at " << expr.location);
   return {};
 }
 std::optional<Error> TypeComparator::operator()(const ast::UnaryExpression &expr) {
@@ -175,20 +190,21 @@ std::optional<Error> TypeComparator::operator()(const ast::UnaryExpression &expr
   if (expr_err) {
     return expr_err;
   }
+  const InternedString &expected_name = expected_.GetIdentifier().name;
   if (expr.type == ast::UnaryExpressionType::Minus) {
-    if (expected_.identifier.name == InternedString("Int") || expected_.identifier.name == InternedString("Float")) {
+    if (IsOfKind(expected_name, {ast::BuiltinKind::Signed, ast::BuiltinKind::Float})) {
       return {};
     }
   }
   if (expr.type == ast::UnaryExpressionType::Bang) {
-    if (expected_.identifier.name == InternedString("Bool")) {
+    if (IsOfKind(expected_name, {ast::BuiltinKind::Bool})) {
       return {};
     }
   }
   DLOG(ERROR) << "Invalid operator use in expression " << expr;
   return Error(
       CreateError() << "Operator \"" << static_cast<char>(expr.type) << "\""
-                    << " is not supported by type " << expected_.identifier.name << "\" at " << expr.location);
+                    << " is not supported by type " << expected_name << "\" at " << expr.location);
   return {};
 }
 std::optional<Error> TypeComparator::operator()(const ast::VarAccess &expr) {
@@ -251,12 +267,12 @@ std::optional<Error> TypeComparator::operator()(const ast::Value &val) {
 std::optional<Error> TypeComparator::operator()(const ast::ConstructedValue &val) {
   const InternedString &type_name = ast_.constructor_to_type.at(val.constructor_identifier.name);
 
-  if (type_name != expected_.identifier.name) {
-    DLOG(ERROR) << "Invalid type of constructed value " << val << " expected " << expected_.identifier.name << " got "
-                << type_name << " at " << val.location;
+  if (type_name != expected_.GetIdentifier().name) {
+    DLOG(ERROR) << "Invalid type of constructed value " << val << " expected " << expected_.GetIdentifier().name
+                << " got " << type_name << " at " << val.location;
     return Error(
         CreateError() << "Got value of type \"" << type_name << "\", but expected type is \""
-                      << expected_.identifier.name << "\" at " << val.location);
+                      << expected_.GetIdentifier().name << "\" at " << val.location);
   }
 
   // If the base type is correct then we have two cases:
@@ -273,20 +289,42 @@ std::optional<Error> TypeComparator::operator()(const ast::ConstructedValue &val
   // the arguments that were passed in our expected type expression
   // To do this we need to iterate through rules and find the one that can be satisfied or throw an error if none can
   DLOG(INFO) << "Matching expression " << expected_ << " against enum " << type_name;
-  for (const auto &rule : ast_enum.pattern_mapping) {
+  // If the dependencies inspected by the decision tree are values, only the rules of its leaf can match.
+  // Otherwise we have to try every rule
+  const auto *leaf = decision_trees_.at(type_name).Select([this](size_t input) -> std::optional<patterns::Key> {
+    if (input >= expected_.GetParametersCount()) {
+      return std::nullopt;
+    }
+    const auto &parameter = *expected_.GetParameter(input);
+    if (!std::holds_alternative<ast::Value>(parameter)) {
+      return std::nullopt;
+    }
+    return patterns::GetKey(std::get<ast::Value>(parameter));
+  });
+  std::vector<size_t> candidates;
+  if (leaf != nullptr) {
+    candidates = leaf->rules;
+  } else {
+    candidates.resize(ast_enum.pattern_mapping.size());
+    std::iota(candidates.begin(), candidates.end(), 0);
+  }
+
+  // Rules are matched speculatively: bindings of a failed match are dropped by restoring the saved substitutions
+  const Substitutor::Snapshot snapshot = substitutor_.Save();
+  for (size_t rule_id : candidates) {
+    const auto &rule = ast_enum.pattern_mapping[rule_id];
     DLOG(INFO) << "Trying input patterns " << rule.inputs;
     bool matches = true;
-    substitutor_.PushScope();
     for (size_t i = 0; i < rule.inputs.size(); ++i) {
-      if (!Matcher {z3_stuff_, context_, substitutor_, ast_}(*expected_.parameters[i], rule.inputs[i])) {
+      if (!Matcher {z3_stuff_, context_, substitutor_, ast_}(*expected_.GetParameter(i), rule.inputs[i])) {
         matches = false;
         break;
       }
       // If the pattern matches, we need to add the bindings to the substitutor
-      substitutor_.AddSubstitution(ast_enum.type_dependencies[i].name, expected_.parameters[i]);
+      substitutor_.AddSubstitution(ast_enum.type_dependencies[i].name, expected_.GetParameter(i));
     }
     if (!matches) {
-      substitutor_.PopScope();
+      substitutor_.Restore(snapshot);
       continue;
     }
     for (const auto &constructor : rule.outputs) {
@@ -295,11 +333,14 @@ std::optional<Error> TypeComparator::operator()(const ast::ConstructedValue &val
         continue;
       }
       DLOG(INFO) << "Found constructor " << constructor.identifier.name << ", checking fields";
-      return CheckConstructedValue(val, constructor);
+      auto err = CheckConstructedValue(val, constructor);
+      substitutor_.Restore(snapshot);
+      return err;
     }
     // Break because we already found a matching pattern but didn't find any suitable constructors
     break;
   }
+  substitutor_.Restore(snapshot);
   return Error(
       CreateError() << "Constructor \"" << val.constructor_identifier.name << "\" cannot be used in this context at "
                     << val.location);
@@ -309,16 +350,17 @@ std::optional<Error>
 TypeComparator::CheckConstructedValue(const ast::ConstructedValue &val, const ast::TypeWithFields &constructor) {
   // Check that all fields have the correct types
   for (size_t i = 0; i < constructor.fields.size(); ++i) {
-    const auto &field         = constructor.fields[i];
-    const auto &expected_type = std::get<ast::TypeExpression>(substitutor_(field.type_expression));
+    const auto &field  = constructor.fields[i];
+    auto expected_type = substitutor_.Lazy(field.type_expression);
     DLOG(INFO) << "Checking that field " << field.name << " has type " << expected_type;
     if (std::holds_alternative<ast::VarAccess>(*val.fields[i].second)) {
       const auto &var_access = std::get<ast::VarAccess>(*val.fields[i].second);
-      context_.back()->AddName(var_access.var_identifier.name, expected_type);
+      context_.back()->AddName(var_access.var_identifier.name, expected_type.Force());
       continue;
     }
     auto field_err =
-        TypeComparator(expected_type, ast_, &context_, &substitutor_, &z3_stuff_).Compare(*val.fields[i].second);
+        TypeComparator(std::move(expected_type), ast_, &context_, &substitutor_, &z3_stuff_, decision_trees_)
+            .Compare(*val.fields[i].second);
     if (field_err) {
       DLOG(ERROR) << "Field " << field.name << " has incorrect type";
       return field_err;
@@ -0,0 +1,97 @@
+#include "core/codegen/code_writer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unistd.h>
+
+namespace dbuf::gen {
+
+const std::string_view CodeWriter::kSpaces = "                                                                ";
+
+CodeWriter::CodeWriter(size_t capacity) {
+  buffer_.reserve(capacity);
+}
+
+CodeWriter &CodeWriter::operator<<(std::string_view str) {
+  buffer_ += str;
+  return *this;
+}
+
+CodeWriter &CodeWriter::operator<<(char symbol) {
+  buffer_ += symbol;
+  return *this;
+}
+
+CodeWriter &CodeWriter::operator<<(const InternedString &str) {
+  buffer_ += str.GetString();
+  return *this;
+}
+
+CodeWriter &CodeWriter::Indent(size_t width) {
+  for (; width > kSpaces.size(); width -= kSpaces.size()) {
+    buffer_ += kSpaces;
+  }
+  buffer_ += kSpaces.substr(0, width);
+  return *this;
+}
+
+const std::string &CodeWriter::str() const {
+  return buffer_;
+}
+
+uint64_t CodeWriter::Hash() const {
+  uint64_t hash = kFnvOffsetBasis;
+  for (char symbol : buffer_) {
+    hash = (hash ^ static_cast<unsigned char>(symbol)) * kFnvPrime;
+  }
+  return hash;
+}
+
+bool CodeWriter::WriteToFile(const std::string &path) const {
+  if (HasSameContent(path)) {
+    return false;
+  }
+
+  // Concurrent runs of the compiler and threads of one run may write the same path, so every writer has its own file
+  static std::atomic<uint64_t> temp_counter = 0;
+  const std::string temp_path =
+      path + "." + std::to_string(getpid()) + "." + std::to_string(temp_counter.fetch_add(1)) + ".tmp";
+  {
+    std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+      throw std::string("Cannot open file in the given path");
+    }
+    output.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    if (!output.good()) {
+      throw std::string("Cannot write file in the given path");
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temp_path, path, error);
+  if (error) {
+    std::filesystem::remove(temp_path, error);
+    throw std::string("Cannot write file in the given path");
+  }
+  return true;
+}
+
+bool CodeWriter::HasSameContent(const std::string &path) const {
+  std::error_code error;
+  const auto size = std::filesystem::file_size(path, error);
+  if (error || size != buffer_.size()) {
+    return false;
+  }
+
+  std::ifstream input(path, std::ios::binary);
+  std::string content(buffer_.size(), '\0');
+  input.read(content.data(), static_cast<std::streamsize>(content.size()));
+  return input.good() && content == buffer_;
+}
+
+} // namespace dbuf::gen
@@ -1,15 +1,1227 @@
 #include "core/codegen/cpp_gen.h"
 
+#include "core/ast/builtin_types.h"
+#include "core/ir/reachability.h"
+#include "core/patterns/decision_tree.h"
 #include "glog/logging.h"
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
 namespace dbuf::gen {
 
+namespace {
+
+// Fixed32 and Fixed64 have the same C++ types as UInt32 and UInt64, they differ only on the wire
+const std::unordered_map<std::string_view, std::string_view> kFixedWidthTypes = {
+    {"Int8", "std::int8_t"},
+    {"Int16", "std::int16_t"},
+    {"Int32", "std::int32_t"},
+    {"Int64", "std::int64_t"},
+    {"UInt8", "std::uint8_t"},
+    {"UInt16", "std::uint16_t"},
+    {"UInt32", "std::uint32_t"},
+    {"UInt64", "std::uint64_t"},
+    {"Fixed32", "std::uint32_t"},
+    {"Fixed64", "std::uint64_t"},
+    {"Float32", "float"},
+};
+
+constexpr std::string_view kTaggedUnionHelper = R"(namespace detail {
+template <typename... Ts>
+union tagged_storage {};
+
+template <typename T, typename... Ts>
+union tagged_storage<T, Ts...> {
+  constexpr tagged_storage()
+      : rest() {}
+  template <typename... Args>
+  constexpr tagged_storage(std::in_place_index_t<0>, Args &&...args)
+      : first(std::forward<Args>(args)...) {}
+  template <std::size_t I, typename... Args>
+  constexpr tagged_storage(std::in_place_index_t<I>, Args &&...args)
+      : rest(std::in_place_index<I - 1>, std::forward<Args>(args)...) {}
+  constexpr ~tagged_storage() {}
+
+  T first;
+  tagged_storage<Ts...> rest;
+};
+
+// Enums of field-less constructors keep only the tag, the constructors have no state to store
+struct stateless_storage {
+  constexpr stateless_storage() = default;
+  template <std::size_t I, typename... Args>
+  constexpr stateless_storage(std::in_place_index_t<I>, Args &&...) {}
+};
+
+template <typename T>
+T &stateless_instance() {
+  static T instance;
+  return instance;
+}
+
+template <typename T, typename... Ts>
+constexpr std::size_t index_of() {
+  constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+  for (std::size_t ind = 0; ind < sizeof...(Ts); ++ind) {
+    if (matches[ind]) {
+      return ind;
+    }
+  }
+  return sizeof...(Ts);
+}
+
+// Constructors larger than two pointers are kept out of line, so that an enum whose values are mostly field-less
+// constructors is as small as a pointer and the tag, instead of its largest constructor
+template <typename T>
+inline constexpr bool boxed_v = sizeof(T) > 2 * sizeof(void *);
+
+template <typename T>
+using slot_t = std::conditional_t<boxed_v<T>, std::unique_ptr<T>, T>;
+
+// Replacement of std::variant for enums: the smallest tag and a union of the constructors, dispatched by jump tables.
+// A moved-from value holding an out-of-line constructor may only be assigned to or destroyed.
+template <typename... Ts>
+class tagged_union {
+  static constexpr bool kStateless = (std::is_empty_v<Ts> && ...);
+  using storage_type               = std::conditional_t<kStateless, stateless_storage, tagged_storage<slot_t<Ts>...>>;
+  using tag_type                   = std::conditional_t<(sizeof...(Ts) <= 256), unsigned char, unsigned short>;
+
+public:
+  template <std::size_t I>
+  using alternative = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+  tagged_union()
+      : storage_(std::in_place_index<0>, make_slot<0>())
+      , tag_(0) {}
+  template <
+      typename T,
+      std::size_t I = index_of<std::decay_t<T>, Ts...>(),
+      typename      = std::enable_if_t<(I < sizeof...(Ts))>>
+  tagged_union(T &&value)
+      : storage_(std::in_place_index<I>, make_slot<I>(std::forward<T>(value)))
+      , tag_(I) {}
+  tagged_union(const tagged_union &other)
+      : storage_()
+      , tag_(other.tag_) {
+    for_index(tag_, [this, &other](auto index) {
+      construct_slot<index>(make_slot<index>(static_cast<const alternative<index> &>(other.get<index>())));
+    });
+  }
+  tagged_union(tagged_union &&other) noexcept
+      : storage_()
+      , tag_(other.tag_) {
+    move_slot(other);
+  }
+  // The copy is made before the current constructor is destroyed, so a throwing copy leaves the value unchanged
+  tagged_union &operator=(const tagged_union &other) {
+    if (this != &other) {
+      tagged_union copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+  tagged_union &operator=(tagged_union &&other) noexcept {
+    if (this != &other) {
+      destroy();
+      tag_ = other.tag_;
+      move_slot(other);
+    }
+    return *this;
+  }
+  ~tagged_union() {
+    destroy();
+  }
+
+  constexpr std::size_t index() const {
+    return tag_;
+  }
+
+  template <std::size_t I>
+  alternative<I> &get() {
+    if constexpr (kStateless) {
+      return stateless_instance<alternative<I>>();
+    } else if constexpr (boxed_v<alternative<I>>) {
+      return *slot<I>(storage_);
+    } else {
+      return slot<I>(storage_);
+    }
+  }
+  template <std::size_t I>
+  const alternative<I> &get() const {
+    return const_cast<tagged_union *>(this)->template get<I>();
+  }
+
+  // The new constructor is created before the current one is destroyed, so a throwing constructor changes nothing
+  template <std::size_t I, typename... Args>
+  alternative<I> &emplace(Args &&...args) {
+    auto value = make_slot<I>(std::forward<Args>(args)...);
+    destroy();
+    tag_ = I;
+    construct_slot<I>(std::move(value));
+    return get<I>();
+  }
+
+  template <typename F>
+  decltype(auto) visit(F &&function) const {
+    return dispatch(tag_, function);
+  }
+
+private:
+  template <std::size_t I>
+  using slot_type = std::tuple_element_t<I, std::tuple<slot_t<Ts>...>>;
+
+  template <std::size_t I, typename Storage>
+  static auto &slot(Storage &storage) {
+    if constexpr (I == 0) {
+      return storage.first;
+    } else {
+      return slot<I - 1>(storage.rest);
+    }
+  }
+
+  template <std::size_t I, typename... Args>
+  static slot_type<I> make_slot(Args &&...args) {
+    if constexpr (boxed_v<alternative<I>>) {
+      return std::make_unique<alternative<I>>(std::forward<Args>(args)...);
+    } else {
+      return alternative<I>(std::forward<Args>(args)...);
+    }
+  }
+
+  template <std::size_t I>
+  void construct_slot(slot_type<I> &&value) {
+    if constexpr (!kStateless) {
+      std::construct_at(&slot<I>(storage_), std::move(value));
+    }
+  }
+  // Out-of-line constructors are moved by their pointers
+  void move_slot(tagged_union &other) noexcept {
+    for_index(tag_, [this, &other](auto index) {
+      if constexpr (!kStateless) {
+        construct_slot<index>(std::move(slot<index>(other.storage_)));
+      }
+    });
+  }
+  void destroy() {
+    if constexpr (!kStateless) {
+      for_index(tag_, [this](auto index) { std::destroy_at(&slot<index>(storage_)); });
+    }
+  }
+
+  template <typename F, std::size_t... Is>
+  static void for_index(std::size_t tag, F &function, std::index_sequence<Is...>) {
+    static constexpr void (*kTable[])(F &) = {
+        [](F &function) { function(std::integral_constant<std::size_t, Is> {}); }...};
+    kTable[tag](function);
+  }
+  template <typename F>
+  static void for_index(std::size_t tag, F &&function) {
+    for_index(tag, function, std::index_sequence_for<Ts...> {});
+  }
+
+  template <typename Self, typename F, std::size_t... Is>
+  static decltype(auto) dispatch(Self &self, std::size_t tag, F &function, std::index_sequence<Is...>) {
+    using result_type = decltype(function(self.template get<0>()));
+    static constexpr result_type (*kTable[])(Self &, F &) = {
+        [](Self &self, F &function) -> result_type { return function(self.template get<Is>()); }...};
+    return kTable[tag](self, function);
+  }
+  template <typename F>
+  decltype(auto) dispatch(std::size_t tag, F &&function) {
+    return dispatch(*this, tag, function, std::index_sequence_for<Ts...> {});
+  }
+  template <typename F>
+  decltype(auto) dispatch(std::size_t tag, F &&function) const {
+    return dispatch(*this, tag, function, std::index_sequence_for<Ts...> {});
+  }
+
+  [[no_unique_address]] storage_type storage_;
+  tag_type tag_;
+};
+
+template <std::size_t I, typename... Ts>
+auto &get(tagged_union<Ts...> &value) {
+  return value.template get<I>();
+}
+
+template <std::size_t I, typename... Ts>
+const auto &get(const tagged_union<Ts...> &value) {
+  return value.template get<I>();
+}
+
+template <typename T, typename... Ts>
+const T &get(const tagged_union<Ts...> &value) {
+  return value.template get<index_of<T, Ts...>()>();
+}
+
+template <typename T, typename... Ts>
+bool holds_alternative(const tagged_union<Ts...> &value) {
+  return value.index() == index_of<T, Ts...>();
+}
+
+template <typename F, typename... Ts>
+decltype(auto) visit(F &&function, const tagged_union<Ts...> &value) {
+  return value.visit(function);
+}
+} // namespace detail
+
+)";
+
+// Integers are varints, signed ones are zigzag encoded first, Fixed32/64 and floats are 4 or 8 bytes in little endian,
+// String is prefixed with its size. Generated structs are encoded with their own encode() and decode().
+// Enum specializations, that have a single constructor for their template parameters, are encoded without the index
+// of the constructor, the branch is resolved at compile time.
+// Checked decoding validates every value with its dependencies right after it is decoded.
+constexpr std::string_view kCodecHelpers = R"(namespace detail {
+inline void encode_varint(std::string &out, unsigned long long value) {
+  for (; value >= 0x80; value >>= 7) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+inline bool decode_varint(std::string_view &in, unsigned long long &value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && !in.empty(); shift += 7) {
+    const auto byte = static_cast<unsigned char>(in.front());
+    in.remove_prefix(1);
+    value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+concept signed_integer = std::is_integral_v<T> && std::is_signed_v<T>;
+
+template <typename T>
+concept unsigned_integer = std::is_integral_v<T> && std::is_unsigned_v<T> && !std::is_same_v<T, bool>;
+
+template <signed_integer T>
+void encode(std::string &out, const T &value) {
+  const auto wide = static_cast<long long>(value);
+  encode_varint(out, (static_cast<unsigned long long>(wide) << 1) ^ static_cast<unsigned long long>(wide >> 63));
+}
+
+template <signed_integer T>
+bool decode(std::string_view &in, T &value) {
+  unsigned long long raw = 0;
+  if (!decode_varint(in, raw)) {
+    return false;
+  }
+  const auto wide = static_cast<long long>((raw >> 1) ^ (0ULL - (raw & 1)));
+  if (wide < std::numeric_limits<T>::min() || wide > std::numeric_limits<T>::max()) {
+    return false;
+  }
+  value = static_cast<T>(wide);
+  return true;
+}
+
+template <unsigned_integer T>
+void encode(std::string &out, const T &value) {
+  encode_varint(out, value);
+}
+
+template <unsigned_integer T>
+bool decode(std::string_view &in, T &value) {
+  unsigned long long raw = 0;
+  if (!decode_varint(in, raw) || raw > std::numeric_limits<T>::max()) {
+    return false;
+  }
+  value = static_cast<T>(raw);
+  return true;
+}
+
+// Fixed32 and Fixed64 are always written in sizeof(T) bytes in little endian, regardless of their value
+template <unsigned_integer T>
+void encode_fixed(std::string &out, const T &value) {
+  auto bits = static_cast<unsigned long long>(value);
+  for (std::size_t byte = 0; byte < sizeof(T); ++byte, bits >>= 8) {
+    out.push_back(static_cast<char>(bits & 0xff));
+  }
+}
+
+template <unsigned_integer T>
+bool decode_fixed(std::string_view &in, T &value) {
+  if (in.size() < sizeof(T)) {
+    return false;
+  }
+  unsigned long long bits = 0;
+  for (std::size_t byte = sizeof(T); byte > 0; --byte) {
+    bits = (bits << 8) | static_cast<unsigned char>(in[byte - 1]);
+  }
+  value = static_cast<T>(bits);
+  in.remove_prefix(sizeof(T));
+  return true;
+}
+
+inline void encode(std::string &out, bool value) {
+  out.push_back(value ? '\1' : '\0');
+}
+
+inline bool decode(std::string_view &in, bool &value) {
+  if (in.empty() || static_cast<unsigned char>(in.front()) > 1) {
+    return false;
+  }
+  value = in.front() == '\1';
+  in.remove_prefix(1);
+  return true;
+}
+
+inline void encode(std::string &out, double value) {
+  encode_fixed(out, std::bit_cast<std::uint64_t>(value));
+}
+
+inline bool decode(std::string_view &in, double &value) {
+  std::uint64_t bits = 0;
+  if (!decode_fixed(in, bits)) {
+    return false;
+  }
+  value = std::bit_cast<double>(bits);
+  return true;
+}
+
+inline void encode(std::string &out, float value) {
+  encode_fixed(out, std::bit_cast<std::uint32_t>(value));
+}
+
+inline bool decode(std::string_view &in, float &value) {
+  std::uint32_t bits = 0;
+  if (!decode_fixed(in, bits)) {
+    return false;
+  }
+  value = std::bit_cast<float>(bits);
+  return true;
+}
+
+template <typename Allocator>
+void encode(std::string &out, const std::basic_string<char, std::char_traits<char>, Allocator> &value) {
+  encode_varint(out, value.size());
+  out += value;
+}
+
+// Decoded strings keep their allocator, so strings of values constructed in an arena stay in it
+template <typename Allocator>
+bool decode(std::string_view &in, std::basic_string<char, std::char_traits<char>, Allocator> &value) {
+  unsigned long long size = 0;
+  if (!decode_varint(in, size) || size > in.size()) {
+    return false;
+  }
+  value.assign(in.substr(0, size));
+  in.remove_prefix(size);
+  return true;
+}
+
+template <typename T>
+void encode(std::string &out, const T &value) {
+  value.encode(out);
+}
+
+// Generated types with runtime dependencies take them in decode() too, the lengths of their vectors may depend on them
+template <typename T, typename... Args>
+  requires requires(std::string_view &in, T &value, const Args &...args) { value.decode(in, args...); }
+bool decode(std::string_view &in, T &value, const Args &...args) {
+  return value.decode(in, args...);
+}
+
+template <template <typename...> typename Variant, typename... Ts>
+void encode_variant(std::string &out, const Variant<Ts...> &value) {
+  if constexpr (sizeof...(Ts) == 1) {
+    get<0>(value).encode(out);
+  } else {
+    encode_varint(out, value.index());
+    visit([&out](const auto &constructor) { constructor.encode(out); }, value);
+  }
+}
+
+template <template <typename...> typename Variant, typename... Ts>
+bool decode_tag(std::string_view &in, const Variant<Ts...> &value, std::size_t &tag) {
+  tag = 0;
+  if constexpr (sizeof...(Ts) == 1) {
+    return true;
+  }
+  unsigned long long raw = 0;
+  if (!decode_varint(in, raw) || raw >= sizeof...(Ts)) {
+    return false;
+  }
+  tag = static_cast<std::size_t>(raw);
+  return true;
+}
+
+template <template <typename...> typename Variant, typename... Ts, std::size_t... Is, typename... Args>
+bool decode_alternative(
+    std::string_view &in,
+    std::size_t tag,
+    Variant<Ts...> &value,
+    std::index_sequence<Is...>,
+    const Args &...args) {
+  return ((tag == Is && value.template emplace<Is>().decode(in, args...)) || ...);
+}
+
+template <template <typename...> typename Variant, typename... Ts, typename... Args>
+bool decode_variant(std::string_view &in, Variant<Ts...> &value, const Args &...args) {
+  std::size_t tag = 0;
+  return decode_tag(in, value, tag) && decode_alternative(in, tag, value, std::index_sequence_for<Ts...> {}, args...);
+}
+
+template <typename T, typename... Args>
+bool decode_checked(std::string_view &in, T &value, const Args &...args) {
+  if constexpr (requires { value.decode_checked(in, args...); }) {
+    return value.decode_checked(in, args...);
+  } else {
+    return decode(in, value);
+  }
+}
+
+template <template <typename...> typename Variant, typename... Ts, std::size_t... Is, typename... Args>
+bool decode_alternative_checked(
+    std::string_view &in,
+    std::size_t tag,
+    Variant<Ts...> &value,
+    std::index_sequence<Is...>,
+    const Args &...args) {
+  return ((tag == Is && value.template emplace<Is>().decode_checked(in, args...)) || ...);
+}
+
+template <template <typename...> typename Variant, typename... Ts, typename... Args>
+bool decode_constructor_checked(
+    std::string_view &in,
+    std::size_t tag,
+    Variant<Ts...> &value,
+    const Args &...args) {
+  return decode_alternative_checked(in, tag, value, std::index_sequence_for<Ts...> {}, args...);
+}
+
+template <template <typename...> typename Variant, typename... Ts, typename... Args>
+bool decode_variant_checked(std::string_view &in, Variant<Ts...> &value, const Args &...args) {
+  std::size_t tag = 0;
+  return decode_tag(in, value, tag) && decode_constructor_checked(in, tag, value, args...);
+}
+} // namespace detail
+
+)";
+
+// Sequences of Int and Unsigned values are encoded and decoded in bulk. The kernels handle blocks of varints of a
+// single byte with SSE4.1 or AVX2 and fall back to the scalar codec for the longer ones, so the bytes on the wire are
+// the same. The kernel is chosen once at runtime, the scalar loop is used on other platforms and without extensions.
+constexpr std::string_view kBulkVarintHelpers = R"(namespace detail {
+template <typename T>
+concept varint_integer = signed_integer<T> || unsigned_integer<T>;
+
+// Longest varint of the type, signed values are zigzag encoded to the same number of bits
+template <varint_integer T>
+constexpr std::size_t max_varint_size = (sizeof(T) * 8 + 6) / 7;
+
+template <varint_integer T>
+unsigned long long to_varint(T value) {
+  if constexpr (signed_integer<T>) {
+    const auto wide = static_cast<long long>(value);
+    return (static_cast<unsigned long long>(wide) << 1) ^ static_cast<unsigned long long>(wide >> 63);
+  } else {
+    return value;
+  }
+}
+
+inline char *write_varint(char *dst, unsigned long long value) {
+  for (; value >= 0x80; value >>= 7) {
+    *dst++ = static_cast<char>((value & 0x7f) | 0x80);
+  }
+  *dst++ = static_cast<char>(value);
+  return dst;
+}
+
+enum class varint_kernel { scalar, sse41, avx2 };
+
+inline varint_kernel detect_varint_kernel() {
+#if defined(__x86_64__) && defined(__GNUC__)
+  if (__builtin_cpu_supports("avx2")) {
+    return varint_kernel::avx2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return varint_kernel::sse41;
+  }
+#endif
+  return varint_kernel::scalar;
+}
+
+inline varint_kernel default_varint_kernel() {
+  static const varint_kernel kernel = detect_varint_kernel();
+  return kernel;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+// Lanes of the varints that don't fit in a single byte have some of these bits set
+template <varint_integer T>
+__attribute__((target("sse4.1"))) __m128i multibyte_bits_sse41() {
+  if constexpr (sizeof(T) == 1) {
+    return _mm_set1_epi8(static_cast<char>(0x80));
+  } else if constexpr (sizeof(T) == 2) {
+    return _mm_set1_epi16(static_cast<short>(0xff80));
+  } else if constexpr (sizeof(T) == 4) {
+    return _mm_set1_epi32(static_cast<int>(0xffffff80));
+  } else {
+    return _mm_set1_epi64x(static_cast<long long>(~0x7fULL));
+  }
+}
+
+template <varint_integer T>
+__attribute__((target("sse4.1"))) __m128i zigzag_encode_sse41(__m128i value) {
+  __m128i sign;
+  __m128i doubled;
+  if constexpr (sizeof(T) == 1) {
+    sign    = _mm_cmpgt_epi8(_mm_setzero_si128(), value);
+    doubled = _mm_add_epi8(value, value);
+  } else if constexpr (sizeof(T) == 2) {
+    sign    = _mm_srai_epi16(value, 15);
+    doubled = _mm_add_epi16(value, value);
+  } else if constexpr (sizeof(T) == 4) {
+    sign    = _mm_srai_epi32(value, 31);
+    doubled = _mm_add_epi32(value, value);
+  } else {
+    sign    = _mm_shuffle_epi32(_mm_srai_epi32(value, 31), _MM_SHUFFLE(3, 3, 1, 1));
+    doubled = _mm_add_epi64(value, value);
+  }
+  return _mm_xor_si128(doubled, sign);
+}
+
+template <varint_integer T>
+__attribute__((target("sse4.1"))) char *encode_varints_sse41(
+    char *dst,
+    const T *values,
+    std::size_t count,
+    std::size_t &done) {
+  constexpr std::size_t lanes = 16 / sizeof(T);
+  // Gathers the low bytes of the lanes
+  alignas(16) char gather[16];
+  for (std::size_t ind = 0; ind < 16; ++ind) {
+    gather[ind] = static_cast<char>(ind < lanes ? ind * sizeof(T) : 0x80);
+  }
+  const __m128i shuffle   = _mm_load_si128(reinterpret_cast<const __m128i *>(gather));
+  const __m128i multibyte = multibyte_bits_sse41<T>();
+  for (; count - done >= lanes; done += lanes) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + done));
+    if constexpr (signed_integer<T>) {
+      block = zigzag_encode_sse41<T>(block);
+    }
+    if (!_mm_testz_si128(block, multibyte)) {
+      for (std::size_t ind = 0; ind < lanes; ++ind) {
+        dst = write_varint(dst, to_varint(values[done + ind]));
+      }
+      continue;
+    }
+    // There is room for 16 bytes, since every value is given at least two
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), sizeof(T) == 1 ? block : _mm_shuffle_epi8(block, shuffle));
+    dst += lanes;
+  }
+  return dst;
+}
+
+template <varint_integer T>
+__attribute__((target("avx2"))) __m256i zigzag_encode_avx2(__m256i value) {
+  __m256i sign;
+  __m256i doubled;
+  if constexpr (sizeof(T) == 1) {
+    sign    = _mm256_cmpgt_epi8(_mm256_setzero_si256(), value);
+    doubled = _mm256_add_epi8(value, value);
+  } else if constexpr (sizeof(T) == 2) {
+    sign    = _mm256_srai_epi16(value, 15);
+    doubled = _mm256_add_epi16(value, value);
+  } else if constexpr (sizeof(T) == 4) {
+    sign    = _mm256_srai_epi32(value, 31);
+    doubled = _mm256_add_epi32(value, value);
+  } else {
+    sign    = _mm256_cmpgt_epi64(_mm256_setzero_si256(), value);
+    doubled = _mm256_add_epi64(value, value);
+  }
+  return _mm256_xor_si256(doubled, sign);
+}
+
+template <varint_integer T>
+__attribute__((target("avx2"))) char *encode_varints_avx2(
+    char *dst,
+    const T *values,
+    std::size_t count,
+    std::size_t &done) {
+  constexpr std::size_t lanes = 32 / sizeof(T);
+  constexpr std::size_t half  = lanes / 2;
+  // Every 128-bit half gathers the low bytes of its lanes, the upper half puts them after the ones of the lower half
+  alignas(32) char gather[32];
+  for (std::size_t ind = 0; ind < 32; ++ind) {
+    const std::size_t position = ind % 16;
+    const std::size_t first    = ind < 16 ? 0 : half;
+    const bool used            = position >= first && position < first + half;
+    gather[ind]                = static_cast<char>(used ? (position - first) * sizeof(T) : 0x80);
+  }
+  const __m256i shuffle   = _mm256_load_si256(reinterpret_cast<const __m256i *>(gather));
+  const __m256i multibyte = _mm256_broadcastsi128_si256(multibyte_bits_sse41<T>());
+  for (; count - done >= lanes; done += lanes) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + done));
+    if constexpr (signed_integer<T>) {
+      block = zigzag_encode_avx2<T>(block);
+    }
+    if (!_mm256_testz_si256(block, multibyte)) {
+      for (std::size_t ind = 0; ind < lanes; ++ind) {
+        dst = write_varint(dst, to_varint(values[done + ind]));
+      }
+      continue;
+    }
+    if constexpr (sizeof(T) == 1) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), block);
+    } else {
+      const __m256i gathered = _mm256_shuffle_epi8(block, shuffle);
+      _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(dst),
+          _mm_or_si128(_mm256_castsi256_si128(gathered), _mm256_extracti128_si256(gathered, 1)));
+    }
+    dst += lanes;
+  }
+  return dst;
+}
+
+// Varints of a single byte are below 0x80, so they fit in any type after the zigzag decoding
+template <varint_integer T>
+__attribute__((target("sse4.1"))) __m128i zigzag_decode_bytes_sse41(__m128i bytes) {
+  if constexpr (signed_integer<T>) {
+    const __m128i half = _mm_and_si128(_mm_srli_epi16(bytes, 1), _mm_set1_epi8(0x7f));
+    const __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(bytes, _mm_set1_epi8(1)));
+    return _mm_xor_si128(half, sign);
+  } else {
+    return bytes;
+  }
+}
+
+// Widens the bytes to the values, sign extension keeps both the signed and the unsigned values
+template <varint_integer T>
+__attribute__((target("sse4.1"))) void widen_bytes_sse41(const char *bytes, T *values) {
+  constexpr std::size_t lanes = 16 / sizeof(T);
+  for (std::size_t part = 0; part < 16; part += lanes) {
+    __m128i widened;
+    if constexpr (sizeof(T) == 1) {
+      widened = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + part));
+    } else if constexpr (sizeof(T) == 2) {
+      widened = _mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(bytes + part)));
+    } else if constexpr (sizeof(T) == 4) {
+      int chunk = 0;
+      std::memcpy(&chunk, bytes + part, sizeof(chunk));
+      widened = _mm_cvtepi8_epi32(_mm_cvtsi32_si128(chunk));
+    } else {
+      short chunk = 0;
+      std::memcpy(&chunk, bytes + part, sizeof(chunk));
+      widened = _mm_cvtepi8_epi64(_mm_cvtsi32_si128(chunk));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(values + part), widened);
+  }
+}
+
+template <varint_integer T>
+__attribute__((target("sse4.1"))) bool decode_varints_sse41(
+    std::string_view &in,
+    T *values,
+    std::size_t count,
+    std::size_t &done) {
+  while (count - done >= 16 && in.size() >= 16) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in.data()));
+    const auto mask     = static_cast<unsigned>(_mm_movemask_epi8(bytes));
+    // Bytes before the first continuation bit are whole varints, the values after them are overwritten later
+    const auto run = static_cast<std::size_t>(mask == 0 ? 16 : std::countr_zero(mask));
+    if (run > 0) {
+      alignas(16) char decoded[16];
+      _mm_store_si128(reinterpret_cast<__m128i *>(decoded), zigzag_decode_bytes_sse41<T>(bytes));
+      widen_bytes_sse41(decoded, values + done);
+      done += run;
+      in.remove_prefix(run);
+    }
+    if (run < 16 && !decode(in, values[done++])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <varint_integer T>
+__attribute__((target("avx2"))) void widen_bytes_avx2(const char *bytes, T *values) {
+  constexpr std::size_t lanes = 32 / sizeof(T);
+  for (std::size_t part = 0; part < 32; part += lanes) {
+    __m256i widened;
+    if constexpr (sizeof(T) == 1) {
+      widened = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes + part));
+    } else if constexpr (sizeof(T) == 2) {
+      widened = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + part)));
+    } else if constexpr (sizeof(T) == 4) {
+      widened = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(bytes + part)));
+    } else {
+      int chunk = 0;
+      std::memcpy(&chunk, bytes + part, sizeof(chunk));
+      widened = _mm256_cvtepi8_epi64(_mm_cvtsi32_si128(chunk));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(values + part), widened);
+  }
+}
+
+template <varint_integer T>
+__attribute__((target("avx2"))) bool decode_varints_avx2(
+    std::string_view &in,
+    T *values,
+    std::size_t count,
+    std::size_t &done) {
+  while (count - done >= 32 && in.size() >= 32) {
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in.data()));
+    const auto mask     = static_cast<unsigned>(_mm256_movemask_epi8(bytes));
+    const auto run      = static_cast<std::size_t>(mask == 0 ? 32 : std::countr_zero(mask));
+    if (run > 0) {
+      alignas(32) char decoded[32];
+      _mm_store_si128(
+          reinterpret_cast<__m128i *>(decoded),
+          zigzag_decode_bytes_sse41<T>(_mm256_castsi256_si128(bytes)));
+      _mm_store_si128(
+          reinterpret_cast<__m128i *>(decoded + 16),
+          zigzag_decode_bytes_sse41<T>(_mm256_extracti128_si256(bytes, 1)));
+      widen_bytes_avx2(decoded, values + done);
+      done += run;
+      in.remove_prefix(run);
+    }
+    if (run < 32 && !decode(in, values[done++])) {
+      return false;
+    }
+  }
+  return true;
+}
+#endif
+
+template <varint_integer T>
+void encode_varints(
+    std::string &out,
+    const T *values,
+    std::size_t count,
+    varint_kernel kernel = default_varint_kernel()) {
+  // Room for the longest varints, the string is cut to the written bytes after
+  const std::size_t offset = out.size();
+  out.resize(offset + count * max_varint_size<T>);
+  char *dst        = out.data() + offset;
+  std::size_t done = 0;
+#if defined(__x86_64__) && defined(__GNUC__)
+  if (kernel == varint_kernel::avx2) {
+    dst = encode_varints_avx2(dst, values, count, done);
+  }
+  if (kernel != varint_kernel::scalar) {
+    dst = encode_varints_sse41(dst, values, count, done);
+  }
+#endif
+  for (; done < count; ++done) {
+    dst = write_varint(dst, to_varint(values[done]));
+  }
+  out.resize(static_cast<std::size_t>(dst - out.data()));
+}
+
+template <varint_integer T>
+bool decode_varints(
+    std::string_view &in,
+    T *values,
+    std::size_t count,
+    varint_kernel kernel = default_varint_kernel()) {
+  std::size_t done = 0;
+#if defined(__x86_64__) && defined(__GNUC__)
+  if (kernel == varint_kernel::avx2 && !decode_varints_avx2(in, values, count, done)) {
+    return false;
+  }
+  if (kernel != varint_kernel::scalar && !decode_varints_sse41(in, values, count, done)) {
+    return false;
+  }
+#endif
+  for (; done < count; ++done) {
+    if (!decode(in, values[done])) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace detail
+
+
+)";
+
+// Elements of sequences are packed one after another without tags and without the length, which is known from the
+// dependencies. Arrays have lengths known at compile time, vectors get them from the fields decoded before and from the
+// dependencies of the struct, which decode() and decode_checked() receive.
+constexpr std::string_view kSequenceCodecHelpers = R"(namespace detail {
+// Bytes taken at least by an element. Generated types may take none, like messages without fields or enums with a
+// single field-less constructor.
+template <typename T>
+constexpr std::size_t min_encoded_size() {
+  if constexpr (std::is_floating_point_v<T>) {
+    return sizeof(T);
+  } else if constexpr (std::is_arithmetic_v<T> || std::is_convertible_v<const T &, std::string_view>) {
+    return 1;
+  } else {
+    return 0;
+  }
+}
+
+// Elements that take bytes can't be more than the rest of the input allows, other lengths are only bounded by the type
+template <typename T, typename Length>
+bool fits_input(std::string_view in, const Length &length) {
+  if constexpr (min_encoded_size<T>() > 0) {
+    return static_cast<unsigned long long>(length) <= in.size() / min_encoded_size<T>();
+  } else {
+    return static_cast<unsigned long long>(length) <= std::numeric_limits<std::size_t>::max();
+  }
+}
+
+// Elements of vectors are constructed with the allocator of the vector if they use one, so that they are moved into it
+template <typename T, typename Allocator>
+T make_element(const Allocator &alloc) {
+  if constexpr (std::uses_allocator_v<T, Allocator>) {
+    return T(alloc);
+  } else {
+    return T {};
+  }
+}
+
+template <typename T, std::size_t N>
+void encode(std::string &out, const std::array<T, N> &value) {
+  if constexpr (varint_integer<T>) {
+    encode_varints(out, value.data(), N);
+  } else {
+    for (const auto &item : value) {
+      encode(out, item);
+    }
+  }
+}
+
+template <typename T, std::size_t N, typename... Args>
+bool decode(std::string_view &in, std::array<T, N> &value, const Args &...args) {
+  if constexpr (varint_integer<T>) {
+    return decode_varints(in, value.data(), N);
+  } else {
+    return std::all_of(value.begin(), value.end(), [&](T &item) { return decode(in, item, args...); });
+  }
+}
+
+// Items are cast to T, since std::vector<bool> returns proxies
+template <typename T, typename Allocator>
+void encode(std::string &out, const std::vector<T, Allocator> &value) {
+  if constexpr (varint_integer<T>) {
+    encode_varints(out, value.data(), value.size());
+  } else {
+    for (const auto &item : value) {
+      encode(out, static_cast<const T &>(item));
+    }
+  }
+}
+
+// Lengths are taken with the types of their expressions, so that these overloads are preferred to the generic ones.
+// Elements that may take no bytes are reserved up to the size of the input only.
+template <typename T, typename Allocator, typename Length, typename... Args>
+bool decode(std::string_view &in, std::vector<T, Allocator> &value, const Length &length, const Args &...args) {
+  if (!fits_input<T>(in, length)) {
+    return false;
+  }
+  const auto size = static_cast<std::size_t>(length);
+  if constexpr (varint_integer<T>) {
+    value.resize(size);
+    return decode_varints(in, value.data(), size);
+  } else {
+    value.clear();
+    value.reserve(std::min(size, in.size()));
+    for (std::size_t ind = 0; ind < size; ++ind) {
+      T item = make_element<T>(value.get_allocator());
+      if (!decode(in, item, args...)) {
+        return false;
+      }
+      value.push_back(std::move(item));
+    }
+    return true;
+  }
+}
+
+template <unsigned_integer T, std::size_t N>
+void encode_fixed(std::string &out, const std::array<T, N> &value) {
+  for (const auto &item : value) {
+    encode_fixed(out, item);
+  }
+}
+
+template <unsigned_integer T, std::size_t N>
+bool decode_fixed(std::string_view &in, std::array<T, N> &value) {
+  return std::all_of(value.begin(), value.end(), [&in](T &item) { return decode_fixed(in, item); });
+}
+
+template <unsigned_integer T, typename Allocator>
+void encode_fixed(std::string &out, const std::vector<T, Allocator> &value) {
+  for (const auto &item : value) {
+    encode_fixed(out, item);
+  }
+}
+
+template <unsigned_integer T, typename Allocator, typename Length>
+bool decode_fixed(std::string_view &in, std::vector<T, Allocator> &value, const Length &length) {
+  if (static_cast<unsigned long long>(length) > in.size() / sizeof(T)) {
+    return false;
+  }
+  value.resize(static_cast<std::size_t>(length));
+  return std::all_of(value.begin(), value.end(), [&in](T &item) { return decode_fixed(in, item); });
+}
+
+template <typename T, std::size_t N, typename... Args>
+bool decode_checked(std::string_view &in, std::array<T, N> &value, const Args &...args) {
+  if constexpr (varint_integer<T>) {
+    return decode(in, value);
+  } else {
+    return std::all_of(value.begin(), value.end(), [&](T &item) { return decode_checked(in, item, args...); });
+  }
+}
+
+template <typename T, typename Allocator, typename Length, typename... Args>
+bool decode_checked(std::string_view &in, std::vector<T, Allocator> &value, const Length &length, const Args &...args) {
+  if constexpr (varint_integer<T>) {
+    return decode(in, value, length);
+  } else {
+    if (!fits_input<T>(in, length)) {
+      return false;
+    }
+    const auto size = static_cast<std::size_t>(length);
+    value.clear();
+    value.reserve(std::min(size, in.size()));
+    for (std::size_t ind = 0; ind < size; ++ind) {
+      T item = make_element<T>(value.get_allocator());
+      if (!decode_checked(in, item, args...)) {
+        return false;
+      }
+      value.push_back(std::move(item));
+    }
+    return true;
+  }
+}
+} // namespace detail
+
+)";
+
+constexpr std::string_view kLayoutHelper = R"(namespace detail {
+// Size of the struct with the members ordered by decreasing alignment, which has the least padding
+template <typename... Ts>
+constexpr std::size_t min_struct_size() {
+  std::size_t alignments[] = {alignof(Ts)...};
+  std::size_t sizes[]      = {sizeof(Ts)...};
+  for (std::size_t ind = 1; ind < sizeof...(Ts); ++ind) {
+    for (std::size_t pos = ind; pos > 0 && alignments[pos - 1] < alignments[pos]; --pos) {
+      std::swap(alignments[pos - 1], alignments[pos]);
+      std::swap(sizes[pos - 1], sizes[pos]);
+    }
+  }
+  std::size_t size = 0;
+  for (std::size_t ind = 0; ind < sizeof...(Ts); ++ind) {
+    size = (size + alignments[ind] - 1) / alignments[ind] * alignments[ind] + sizes[ind];
+  }
+  return (size + alignments[0] - 1) / alignments[0] * alignments[0];
+}
+} // namespace detail
+
+)";
+
+constexpr std::string_view kColdStorageHelper = R"(namespace detail {
+// Cold fields are allocated on the first write, reads of absent fields see the default values
+template <typename T>
+class cold_storage {
+public:
+  cold_storage() = default;
+  cold_storage(const cold_storage &other)
+      : value_(other.value_ ? std::make_unique<T>(*other.value_) : nullptr) {}
+  cold_storage(cold_storage &&other) noexcept = default;
+  cold_storage &operator=(const cold_storage &other) {
+    if (this != &other) {
+      value_ = other.value_ ? std::make_unique<T>(*other.value_) : nullptr;
+    }
+    return *this;
+  }
+  cold_storage &operator=(cold_storage &&other) noexcept = default;
+
+  const T &get() const {
+    static const T kEmpty {};
+    return value_ ? *value_ : kEmpty;
+  }
+
+  T &get_or_create() {
+    if (!value_) {
+      value_ = std::make_unique<T>();
+    }
+    return *value_;
+  }
+
+private:
+  std::unique_ptr<T> value_;
+};
+} // namespace detail
+
+)";
+
+constexpr std::string_view kArenaHelper = R"(// Monotonic buffer released all at once with the arena. It is passed
+// explicitly: values are constructed in it with their allocator-extended
+// constructors, like Drawing(arena.resource()), or decoded into it with
+// decode(in, arena.resource()). The arena is not synchronized, and values
+// must not outlive it.
+class Arena {
+public:
+  explicit Arena(std::size_t initial_size = 4096)
+      : resource_(initial_size) {}
+  Arena(const Arena &)            = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  std::pmr::memory_resource *resource() {
+    return &resource_;
+  }
+
+private:
+  std::pmr::monotonic_buffer_resource resource_;
+};
+
+namespace detail {
+// Containers keep the allocator they are constructed with even through assignments, so members decoded with another
+// allocator are constructed anew. Arrays are reset element by element.
+template <typename T>
+void reset(T &value, const std::pmr::polymorphic_allocator<> &alloc) noexcept {
+  if constexpr (std::uses_allocator_v<T, std::pmr::polymorphic_allocator<>>) {
+    std::destroy_at(&value);
+    std::construct_at(&value, alloc);
+  } else {
+    for (auto &item : value) {
+      reset(item, alloc);
+    }
+  }
+}
+} // namespace detail
+
+)";
+
+void CollectAccessedNames(const ast::Expression &expr, std::unordered_set<InternedString> &names);
+
+void CollectAccessedNames(const ast::TypeExpression &type_expression, std::unordered_set<InternedString> &names) {
+  for (const auto &parameter : type_expression.parameters) {
+    CollectAccessedNames(*parameter, names);
+  }
+}
+
+void CollectAccessedNames(const ast::Expression &expr, std::unordered_set<InternedString> &names) {
+  if (std::holds_alternative<ast::BinaryExpression>(expr)) {
+    CollectAccessedNames(*std::get<ast::BinaryExpression>(expr).left, names);
+    CollectAccessedNames(*std::get<ast::BinaryExpression>(expr).right, names);
+  } else if (std::holds_alternative<ast::UnaryExpression>(expr)) {
+    CollectAccessedNames(*std::get<ast::UnaryExpression>(expr).expression, names);
+  } else if (std::holds_alternative<ast::TypeExpression>(expr)) {
+    CollectAccessedNames(std::get<ast::TypeExpression>(expr), names);
+  } else if (std::holds_alternative<ast::VarAccess>(expr)) {
+    const auto &var_access = std::get<ast::VarAccess>(expr);
+    names.insert(var_access.var_identifier.name);
+    for (const auto &field_identifier : var_access.field_identifiers) {
+      names.insert(field_identifier.name);
+    }
+  } else if (std::holds_alternative<ast::Value>(expr)) {
+    const auto &value = std::get<ast::Value>(expr);
+    if (std::holds_alternative<ast::ConstructedValue>(value)) {
+      for (const auto &[_, field] : std::get<ast::ConstructedValue>(value).fields) {
+        CollectAccessedNames(*field, names);
+      }
+    }
+  }
+}
+
+// Fields of messages and of all constructors of enums
+std::vector<const ast::TypedVariable *> GetFields(const ir::Type &type) {
+  std::vector<const ast::TypedVariable *> fields;
+  if (type.IsEnum()) {
+    for (const auto &rule : type.AsEnum().pattern_mapping) {
+      for (const auto &constructor : rule.outputs) {
+        for (const auto &field : constructor.fields) {
+          fields.push_back(&field);
+        }
+      }
+    }
+  } else {
+    for (const auto &field : type.AsMessage().fields) {
+      fields.push_back(&field);
+    }
+  }
+  return fields;
+}
+
+// Whether some type of the schema uses a type with the name matching the predicate
+bool UsesTypes(const ir::Schema &schema, const std::function<bool(const InternedString &)> &predicate) {
+  return std::any_of(schema.GetTypes().begin(), schema.GetTypes().end(), [&](const ir::Type &type) {
+    const auto used_types = std::visit(
+        [&schema](const auto *declaration) { return ir::GetUsedTypes(*declaration, schema.GetAST()); },
+        type.declaration);
+    return std::any_of(used_types.begin(), used_types.end(), predicate);
+  });
+}
+
+// Case labels must be representable in the C++ type of the dependency, the other keys never match it
+bool IsReachableCase(const ast::TypeExpression &type, const patterns::Key &key) {
+  const auto *builtin = ast::FindBuiltinType(type.identifier.name);
+  if (builtin == nullptr || builtin->kind == ast::BuiltinKind::Bool || builtin->kind == ast::BuiltinKind::Float ||
+      builtin->kind == ast::BuiltinKind::String) {
+    return true;
+  }
+  // Int and Unsigned are generated as int and unsigned
+  ast::BuiltinType cpp_type = *builtin;
+  if (cpp_type.bits == 0) {
+    cpp_type.bits = 32;
+  }
+  if (const auto *value = std::get_if<int64_t>(&key)) {
+    return cpp_type.Fits(*value) || (*value >= 0 && cpp_type.Fits(static_cast<uint64_t>(*value)));
+  }
+  const auto value = std::get<uint64_t>(key);
+  return cpp_type.Fits(value) ||
+         (value <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) &&
+          cpp_type.Fits(static_cast<int64_t>(value)));
+}
+
+// Literals of the extreme keys have no type of their own, so they are spelled by the values of their types
+std::string GetCaseLabel(const patterns::Key &key) {
+  if (const auto *value = std::get_if<int64_t>(&key)) {
+    return *value == std::numeric_limits<int64_t>::min() ? "(-9223372036854775807LL - 1)" : std::to_string(*value);
+  }
+  const auto value = std::get<uint64_t>(key);
+  return std::to_string(value) + (value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) ? "ULL" : "");
+}
+
+size_t GetBuiltinAlignment(const InternedString &name) {
+  if (name == InternedString("Bool")) {
+    return alignof(bool);
+  }
+  if (name == InternedString("Int") || name == InternedString("Unsigned")) {
+    return alignof(int);
+  }
+  if (name == InternedString("Float")) {
+    return alignof(double);
+  }
+  if (const auto *builtin = ast::FindBuiltinType(name); builtin != nullptr && builtin->bits != 0) {
+    return builtin->bits / 8;
+  }
+  if (name == InternedString("String")) {
+    return alignof(std::string);
+  }
+  return 1;
+}
+
+} // namespace
+
 void CppCodeGenerator::PrintVariables(
-    std::basic_ostream<char> &out,
+    CodeWriter &out,
     const std::vector<ast::TypedVariable> &variables,
     std::string &&delimeter,
     bool with_types,
@@ -33,225 +1245,852 @@ void CppCodeGenerator::PrintVariables(
   }
 }
 
-bool CppCodeGenerator::CheckForTriggers(
-    const std::unordered_set<InternedString> &trigger_names,
-    const ast::Expression &expr) {
-  bool result = false;
-  if (std::holds_alternative<ast::BinaryExpression>(expr)) {
-    result |= CheckForTriggers(trigger_names, *(std::get<ast::BinaryExpression>(expr).left)) ||
-              CheckForTriggers(trigger_names, *(std::get<ast::BinaryExpression>(expr).right));
-  } else if (std::holds_alternative<ast::UnaryExpression>(expr)) {
-    result |= CheckForTriggers(trigger_names, *(std::get<ast::UnaryExpression>(expr).expression));
-  } else if (std::holds_alternative<ast::Value>(expr)) {
-    const auto &value = std::get<ast::Value>(expr);
-    if (std::holds_alternative<ast::ConstructedValue>(value)) {
-      const auto &constructed_value = std::get<ast::ConstructedValue>(value);
-      for (const auto &[_, field] : constructed_value.fields) {
-        result |= CheckForTriggers(trigger_names, *field);
+void CppCodeGenerator::Generate(const ir::Schema &schema, size_t jobs) {
+  schema_ = &schema;
+  CollectColdFields();
+  CollectAllocatorAwareTypes();
+  uses_fixed_width_types_ = UsesTypes(schema, [](const InternedString &name) {
+    return kFixedWidthTypes.contains(name.GetString());
+  });
+  uses_sequences_ = UsesTypes(schema, ast::IsVecType);
+  if (options_.split_headers) {
+    GenerateHeaders(schema, jobs);
+    return;
+  }
+  PrintStandardIncludes();
+  *output_ << "namespace dbuf {\n";
+
+  // Runtime checks compare string dependencies with generated helpers
+  if (std::any_of(schema.GetTypes().begin(), schema.GetTypes().end(), HasStringPatterns)) {
+    PrintStringHelpers();
+  }
+  if (options_.compact_enums) {
+    PrintTaggedUnionHelper();
+  }
+  if (options_.codecs) {
+    PrintCodecHelpers();
+  }
+  if (!cold_fields_.empty()) {
+    PrintColdStorageHelper();
+  }
+  if (options_.pmr) {
+    PrintArenaHelper();
+  }
+  if (options_.reorder_fields) {
+    PrintLayoutHelper();
+  }
+
+  const auto &types                  = schema.GetTypes();
+  const size_t specializations_count = schema.GetSpecializations().size();
+  if (jobs <= 1) {
+    printed_specializations_.assign(specializations_count, false);
+    for (const auto &type : types) {
+      PrintType(type);
+    }
+  } else {
+    // Every type is printed into its own buffer with the specializations it prints when types are printed one by one
+    const auto plans = PlanTypes();
+    std::vector<std::shared_ptr<CodeWriter>> buffers(types.size());
+    ParallelFor(types.size(), jobs, [&](size_t ind) {
+      buffers[ind] = std::make_shared<CodeWriter>();
+      CppCodeGenerator type_generator(buffers[ind], *this);
+      type_generator.printed_specializations_.assign(specializations_count, true);
+      for (const auto id : plans[ind]) {
+        type_generator.printed_specializations_[id] = false;
       }
+      type_generator.PrintType(types[ind]);
+    });
+    for (const auto &buffer : buffers) {
+      *output_ << buffer->str();
     }
-  } else if (std::holds_alternative<ast::VarAccess>(expr)) {
-    result |= trigger_names.contains(std::get<ast::VarAccess>(expr).var_identifier.name);
   }
-  return result;
+  *output_ << "} // namespace dbuf\n";
+}
+
+void CppCodeGenerator::PrintType(const ir::Type &type) {
+  DLOG(INFO) << "Generating cpp struct" << type.name;
+  if (type.IsEnum() && !type.dependencies.empty()) {
+    *output_ << "template <";
+    PrintVariables(*output_, type.AsEnum().type_dependencies, ", ", true, false, true);
+    *output_ << ">\n";
+    *output_ << "struct " << type.name << ";\n\n";
+  }
+  PrintSpecialization(type.declared);
 }
 
-void CppCodeGenerator::Generate(const ast::AST *tree) {
-  tree_ = tree;
-  *output_ << "#include <string>\n";
-  *output_ << "#include <variant>\n\n";
+void CppCodeGenerator::GenerateHeaders(const ir::Schema &schema, size_t jobs) {
+  // Headers are put into the directory named after the output file, and include each other by their names
+  const auto directory     = std::filesystem::path(out_file_).replace_extension();
+  const std::string prefix = directory.filename().string() + "/";
+  const auto &types        = schema.GetTypes();
+  const bool has_helpers   = HasRuntimeHelpers() || std::any_of(types.begin(), types.end(), HasStringPatterns);
+
+  auto add_header = [&](const std::string &name) {
+    extra_files_.emplace_back((directory / name).string(), std::make_shared<CodeWriter>());
+    return extra_files_.back().second;
+  };
+
+  extra_files_.clear();
+  for (const auto &type : types) {
+    add_header(type.name.GetString() + ".h");
+  }
+  ParallelFor(types.size(), jobs, [&](size_t ind) {
+    CppCodeGenerator type_generator(extra_files_[ind].second, *this);
+    type_generator.PrintHeader(types[ind]);
+  });
+
+  CppCodeGenerator forward_generator(add_header(std::string(kForwardHeader)), *this);
+  forward_generator.PrintForwardDeclarations();
+
+  if (has_helpers) {
+    CppCodeGenerator helpers_generator(add_header(std::string(kHelpersHeader)), *this);
+    *helpers_generator.output_ << "#pragma once\n\n";
+    if (HasRuntimeHelpers()) {
+      helpers_generator.PrintStandardIncludes();
+    }
+    *helpers_generator.output_ << "namespace dbuf {\n";
+    if (std::any_of(types.begin(), types.end(), HasStringPatterns)) {
+      helpers_generator.PrintStringHelpers();
+    }
+    if (options_.compact_enums) {
+      helpers_generator.PrintTaggedUnionHelper();
+    }
+    if (options_.codecs) {
+      helpers_generator.PrintCodecHelpers();
+    }
+    if (!cold_fields_.empty()) {
+      helpers_generator.PrintColdStorageHelper();
+    }
+    if (options_.pmr) {
+      helpers_generator.PrintArenaHelper();
+    }
+    if (options_.reorder_fields) {
+      helpers_generator.PrintLayoutHelper();
+    }
+    *helpers_generator.output_ << "} // namespace dbuf\n";
+  }
+
+  // Umbrella header keeps the code that includes the single header working
+  *output_ << "#pragma once\n\n";
+  *output_ << "#include \"" << prefix << kForwardHeader << "\"\n";
+  for (const auto &type : types) {
+    *output_ << "#include \"" << prefix << type.name << ".h\"\n";
+  }
+}
+
+void CppCodeGenerator::PrintHeader(const ir::Type &type) {
+  // Hidden specializations are printed next to their type, the other types come from the included headers
+  printed_specializations_.clear();
+  for (const auto &specialization : schema_->GetSpecializations()) {
+    printed_specializations_.push_back(specialization.type != type.id);
+  }
+
+  *output_ << "#pragma once\n\n";
+  PrintStandardIncludes();
+  // Includes follow the edges of the positivity graph, the types used in dependencies, fields and values
+  const auto used_types = std::visit(
+      [this](const auto *declaration) { return ir::GetUsedTypes(*declaration, schema_->GetAST()); },
+      type.declaration);
+  bool has_includes = false;
+  if (HasRuntimeHelpers() || HasStringPatterns(type)) {
+    *output_ << "#include \"" << kHelpersHeader << "\"\n";
+    has_includes = true;
+  }
+  for (const auto &used_type : used_types) {
+    if (used_type != type.name && schema_->FindType(used_type)) {
+      *output_ << "#include \"" << used_type << ".h\"\n";
+      has_includes = true;
+    }
+  }
+  if (has_includes) {
+    *output_ << "\n";
+  }
+
   *output_ << "namespace dbuf {\n";
-  auto declaration_generator = [&](const auto &type) {
-    if constexpr (std::is_same<std::decay_t<decltype(type)>, ast::Enum>()) {
-      if (type.type_dependencies.size() != 0) {
-        *output_ << "template <";
-        PrintVariables(*output_, type.type_dependencies, ", ", true, false, true);
-        *output_ << ">\n";
-        *output_ << "struct " << type.identifier.name << ";\n\n";
+  PrintType(type);
+  for (size_t id = 0; id < printed_specializations_.size(); ++id) {
+    PrintSpecialization(id);
+  }
+  *output_ << "} // namespace dbuf\n";
+}
+
+void CppCodeGenerator::CollectColdFields() {
+  cold_fields_.clear();
+  const auto &types = schema_->GetTypes();
+
+  // Values of the types used as dependencies are template parameters, so they and the types of their fields must
+  // stay structural and keep all fields inline
+  std::unordered_set<InternedString> constant_types;
+  std::vector<InternedString> stack;
+  for (const auto &type : types) {
+    for (const auto &dependency : type.dependencies) {
+      if (dependency.type && constant_types.insert(schema_->GetType(*dependency.type).name).second) {
+        stack.push_back(schema_->GetType(*dependency.type).name);
       }
     }
-  };
+  }
+  while (!stack.empty()) {
+    const auto type = schema_->FindType(stack.back());
+    stack.pop_back();
+    const auto used_types = std::visit(
+        [this](const auto *declaration) { return ir::GetUsedTypes(*declaration, schema_->GetAST()); },
+        schema_->GetType(*type).declaration);
+    for (const auto &used_type : used_types) {
+      if (schema_->FindType(used_type) && constant_types.insert(used_type).second) {
+        stack.push_back(used_type);
+      }
+    }
+  }
 
-  for (const auto &type : tree->visit_order) {
-    DLOG(INFO) << "Generating cpp struct" << type;
-    std::visit(declaration_generator, tree->types.at(type));
-    std::visit(*this, tree->types.at(type));
+  // Fields read by dependency expressions are accessed as members, so they stay inline too
+  std::unordered_set<InternedString> accessed_names;
+  for (const auto &type : types) {
+    std::visit(
+        [&accessed_names](const auto *declaration) {
+          for (const auto &dependency : declaration->type_dependencies) {
+            CollectAccessedNames(dependency.type_expression, accessed_names);
+          }
+        },
+        type.declaration);
+    for (const auto *field : GetFields(type)) {
+      CollectAccessedNames(field->type_expression, accessed_names);
+    }
+  }
+
+  for (const auto &type : types) {
+    if (constant_types.contains(type.name)) {
+      continue;
+    }
+    for (const auto *field : GetFields(type)) {
+      if (field->HasAnnotation(ast::kColdAnnotation) && !accessed_names.contains(field->name)) {
+        cold_fields_.insert(field);
+      }
+    }
   }
-  *output_ << "} // namespace dbuf\n";
 }
 
-void CppCodeGenerator::operator()(const ast::Message &ast_message) {
-  const std::vector<ast::TypedVariable> checker_input;
-  (*this)(ast_message, checker_input);
+void CppCodeGenerator::CollectAllocatorAwareTypes() {
+  allocator_aware_types_.clear();
+  if (!options_.pmr) {
+    return;
+  }
+  // Structs may contain the structs printed after them in the schema, so the set grows until it stops changing
+  auto add_struct = [this](const InternedString &name, const std::vector<ir::Field> &fields) {
+    if (allocator_aware_types_.contains(name)) {
+      return false;
+    }
+    if (std::none_of(fields.begin(), fields.end(), [this](const auto &field) { return IsAllocatorAware(field); })) {
+      return false;
+    }
+    allocator_aware_types_.insert(name);
+    return true;
+  };
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (const auto &specialization : schema_->GetSpecializations()) {
+      changed |= add_struct(specialization.name, specialization.fields);
+      for (const auto &constructor : specialization.constructors) {
+        changed |= add_struct(constructor.name, constructor.fields);
+      }
+    }
+  }
 }
 
-void CppCodeGenerator::operator()(
-    const ast::Message &ast_message,
-    const std::vector<ast::TypedVariable> &checker_input) {
-  std::unordered_map<InternedString, std::vector<std::shared_ptr<const ast::Expression>>> checker_members;
+bool CppCodeGenerator::IsAllocatorAware(const ir::Field &field) const {
+  // Cold fields are members of Cold, that is allocated by detail::cold_storage
+  if (cold_fields_.contains(field.variable)) {
+    return false;
+  }
+  const auto &type_name = field.variable->type_expression.identifier.name;
+  if (ast::IsVecType(type_name)) {
+    return field.runtime_length;
+  }
+  if (type_name == InternedString("String")) {
+    return true;
+  }
+  if (field.specialization) {
+    return allocator_aware_types_.contains(schema_->GetSpecialization(*field.specialization).name);
+  }
+  return field.type && allocator_aware_types_.contains(schema_->GetType(*field.type).name);
+}
 
-  // Vector with final cpp fields for this message
-  // To change Bar<a> to Bar_a without coping ast_message
-  std::vector<ast::TypedVariable> cpp_struct_fields;
-  cpp_struct_fields.reserve(ast_message.fields.size());
+bool CppCodeGenerator::HasRuntimeHelpers() const {
+  return options_.codecs || options_.pmr || options_.compact_enums || options_.reorder_fields || !cold_fields_.empty();
+}
 
-  // checker_input are variable dependencies of this type
-  // they are known at runtime this is why they triggers new type creation
-  // as other variables of message
-  std::unordered_set<InternedString> trigger_names;
-  for (const auto &var : checker_input) {
-    trigger_names.insert(var.name);
+void CppCodeGenerator::PrintStandardIncludes() {
+  std::set<std::string_view> headers = {"string", "variant"};
+  if (options_.codecs) {
+    headers.insert({"bit", "cstddef", "cstdint", "limits", "string_view", "type_traits", "utility"});
+  }
+  if (options_.pmr) {
+    headers.insert({"cstddef", "memory", "memory_resource", "utility"});
+  }
+  if (options_.compact_enums) {
+    headers.insert({"cstddef", "memory", "tuple", "type_traits", "utility"});
+  }
+  if (options_.reorder_fields) {
+    headers.insert({"cstddef", "utility"});
   }
+  if (!cold_fields_.empty()) {
+    headers.insert("memory");
+  }
+  if (uses_fixed_width_types_) {
+    headers.insert("cstdint");
+  }
+  if (uses_sequences_) {
+    headers.insert({"algorithm", "array", "cstddef", "vector"});
+  }
+  const bool uses_bulk_varints = options_.codecs && uses_sequences_;
+  if (uses_bulk_varints) {
+    headers.insert({"cstring", "memory"});
+  }
+  for (const auto &header : headers) {
+    *output_ << "#include <" << header << ">\n";
+  }
+  if (uses_bulk_varints) {
+    *output_ << "#if defined(__x86_64__) && defined(__GNUC__)\n#include <immintrin.h>\n#endif\n";
+  }
+  *output_ << "\n";
+}
 
-  // Generates all the needed extra types for this message
-  // And fill cpp_struct_fields with relevant types
-  for (const auto &field : ast_message.fields) {
-    std::unordered_set<size_t> positions_of_variable_dependencies;
-    // new field that will replace field in this message
-    ast::TypedVariable new_field;
-    new_field.name = field.name;
-    for (size_t ind = 0; ind < field.type_expression.parameters.size(); ++ind) {
-      if (CheckForTriggers(trigger_names, *field.type_expression.parameters[ind])) {
-        positions_of_variable_dependencies.insert(ind);
+void CppCodeGenerator::PrintForwardDeclarations() {
+  *output_ << "#pragma once\n\n";
+  *output_ << "namespace dbuf {\n";
+  // Messages are template parameters by value, so the types taking them can't be declared before their definitions.
+  // Enums are passed by pointer, so they only have to be declared before.
+  std::unordered_set<ir::TypeId> declared;
+  for (const auto &type : schema_->GetTypes()) {
+    const bool can_declare = std::all_of(type.dependencies.begin(), type.dependencies.end(), [&](const auto &field) {
+      return !field.type || (schema_->GetType(*field.type).IsEnum() && declared.contains(*field.type));
+    });
+    if (!can_declare) {
+      continue;
+    }
+    declared.insert(type.id);
+    const auto &dependencies = type.IsEnum() ? type.AsEnum().type_dependencies : type.AsMessage().type_dependencies;
+    if (!dependencies.empty()) {
+      *output_ << "template <";
+      PrintVariables(*output_, dependencies, ", ", true, false, true);
+      *output_ << ">\n";
+    }
+    *output_ << "struct " << type.name << ";\n\n";
+  }
+  *output_ << "} // namespace dbuf\n";
+}
+
+bool CppCodeGenerator::HasStringPatterns(const ir::Type &type) {
+  if (!type.IsEnum()) {
+    return false;
+  }
+  for (const auto &rule : type.AsEnum().pattern_mapping) {
+    for (const auto &input : rule.inputs) {
+      if (std::holds_alternative<ast::Value>(input) &&
+          std::holds_alternative<ast::ScalarValue<std::string>>(std::get<ast::Value>(input))) {
+        return true;
       }
     }
+  }
+  return false;
+}
+
+std::vector<std::vector<ir::SpecializationId>> CppCodeGenerator::PlanTypes() const {
+  const auto &types = schema_->GetTypes();
+  std::vector<std::vector<ir::SpecializationId>> plans(types.size());
+  std::vector<bool> planned(schema_->GetSpecializations().size(), false);
+  for (size_t ind = 0; ind < types.size(); ++ind) {
+    PlanSpecialization(types[ind].declared, planned, plans[ind]);
+  }
+  return plans;
+}
 
-    if (!positions_of_variable_dependencies.empty()) {
-      // vector with expressions for this field in type check
-      std::vector<std::shared_ptr<const ast::Expression>> variable_dependencies_expressions;
+void CppCodeGenerator::PlanSpecialization(
+    ir::SpecializationId id,
+    std::vector<bool> &planned,
+    std::vector<ir::SpecializationId> &specializations) const {
+  // Mirrors the order in which PrintSpecialization visits specializations
+  if (planned[id]) {
+    return;
+  }
+  planned[id] = true;
+  specializations.push_back(id);
 
-      const auto &previous_type = tree_->types.at(field.type_expression.identifier.name);
-      std::vector<ast::TypedVariable> previous_type_dependencies;
-      std::stringstream new_type_name;
-      if (std::holds_alternative<ast::Message>(previous_type)) {
-        previous_type_dependencies = std::get<ast::Message>(previous_type).type_dependencies;
-        new_type_name << std::get<ast::Message>(previous_type).identifier.name;
-      } else if (std::holds_alternative<ast::Enum>(previous_type)) {
-        previous_type_dependencies = std::get<ast::Enum>(previous_type).type_dependencies;
-        new_type_name << std::get<ast::Enum>(previous_type).identifier.name;
+  auto plan_struct = [&](const std::vector<ir::Field> &fields) {
+    for (const auto &field : fields) {
+      if (field.specialization) {
+        PlanSpecialization(*field.specialization, planned, specializations);
+      }
+      if (field.element_specialization) {
+        PlanSpecialization(*field.element_specialization, planned, specializations);
       }
+    }
+  };
 
-      // filling vector expressions, getting new type name and constructing new field
-      for (size_t ind = 0; ind < previous_type_dependencies.size(); ++ind) {
-        if (positions_of_variable_dependencies.contains(ind)) {
-          variable_dependencies_expressions.emplace_back(field.type_expression.parameters[ind]);
-          new_type_name << "_" << previous_type_dependencies[ind].name;
-        } else {
-          new_field.type_expression.parameters.emplace_back(field.type_expression.parameters[ind]);
-        }
+  const auto &specialization = schema_->GetSpecialization(id);
+  const auto &type           = schema_->GetType(specialization.type);
+  if (!type.IsEnum()) {
+    plan_struct(specialization.fields);
+    return;
+  }
+
+  // PrintEnum stops at the first rule with all stars
+  size_t printed_rules = type.AsEnum().pattern_mapping.size();
+  if (specialization.runtime_dependencies.empty()) {
+    for (size_t rule = 0; rule < type.AsEnum().pattern_mapping.size(); ++rule) {
+      const auto &inputs = type.AsEnum().pattern_mapping[rule].inputs;
+      if (std::all_of(inputs.begin(), inputs.end(), [](const auto &input) {
+            return std::holds_alternative<ast::Star>(input);
+          })) {
+        printed_rules = rule + 1;
+        break;
       }
+    }
+  }
+  for (const auto &constructor : specialization.constructors) {
+    if (constructor.rule < printed_rules) {
+      plan_struct(constructor.fields);
+    }
+  }
+}
 
-      // if such type was not already created - creating it
-      if (!created_hidden_types_.contains(InternedString(new_type_name.str()))) {
-        std::vector<ast::TypedVariable> hidden_dependencies;
-        std::vector<ast::TypedVariable> real_dependencies;
-        for (size_t ind = 0; ind < previous_type_dependencies.size(); ++ind) {
-          if (!positions_of_variable_dependencies.contains(ind)) {
-            real_dependencies.emplace_back(previous_type_dependencies[ind]);
-          } else {
-            hidden_dependencies.emplace_back(previous_type_dependencies[ind]);
-          }
-        }
-        if (std::holds_alternative<ast::Message>(previous_type)) {
-          DLOG(INFO) << "Generating cpp extra message " << new_type_name.str();
-          ast::Message new_message;
-          new_message.fields            = std::get<ast::Message>(previous_type).fields;
-          new_message.type_dependencies = real_dependencies;
-          new_message.identifier.name   = InternedString(new_type_name.str());
-
-          (*this)(new_message, hidden_dependencies);
-        } else if (std::holds_alternative<ast::Enum>(previous_type)) {
-          DLOG(INFO) << "Generating cpp extra enum " << new_type_name.str();
-          ast::Enum new_enum;
-          new_enum.pattern_mapping   = std::get<ast::Enum>(previous_type).pattern_mapping;
-          new_enum.type_dependencies = real_dependencies;
-          new_enum.identifier.name   = InternedString(new_type_name.str());
-
-          (*this)(new_enum, hidden_dependencies);
-        }
-        created_hidden_types_.insert(InternedString(new_type_name.str()));
+CppCodeGenerator::StaticValueKind CppCodeGenerator::GetStaticValueKind(const ast::Expression &expr) const {
+  if (!std::holds_alternative<ast::Value>(expr)) {
+    return StaticValueKind::kNone;
+  }
+  const auto &value = std::get<ast::Value>(expr);
+  if (std::holds_alternative<ast::ScalarValue<std::string>>(value)) {
+    return StaticValueKind::kString;
+  }
+  if (std::holds_alternative<ast::ConstructedValue>(value) &&
+      schema_->GetConstructorType(std::get<ast::ConstructedValue>(value).constructor_identifier.name).IsEnum()) {
+    return StaticValueKind::kEnum;
+  }
+  return StaticValueKind::kNone;
+}
+
+void CppCodeGenerator::PrintSpecialization(ir::SpecializationId id) {
+  // Recursive types use the specialization that is being printed
+  if (printed_specializations_[id]) {
+    return;
+  }
+  printed_specializations_[id] = true;
+
+  const auto &specialization = schema_->GetSpecialization(id);
+  if (!schema_->GetType(specialization.type).IsEnum()) {
+    DLOG(INFO) << "Generating cpp message " << specialization.name;
+    PrintStruct(
+        specialization.name,
+        specialization.static_dependencies,
+        specialization.fields,
+        specialization.runtime_dependencies);
+  } else if (specialization.runtime_dependencies.empty()) {
+    PrintEnum(specialization);
+  } else {
+    PrintRuntimeEnum(specialization);
+  }
+}
+
+void CppCodeGenerator::PrintStruct(
+    const InternedString &name,
+    const std::vector<ast::TypedVariable> &type_dependencies,
+    const std::vector<ir::Field> &fields,
+    const std::vector<ast::TypedVariable> &checker_input) {
+  // Fields with runtime dependencies are checked in the order of declaration
+  std::vector<std::pair<InternedString, std::vector<std::shared_ptr<const ast::Expression>>>> checker_members;
+
+  // Vector with final cpp fields for this struct
+  // To change Bar<a> to Bar_a without coping the fields
+  std::vector<ast::TypedVariable> cpp_struct_fields;
+  cpp_struct_fields.reserve(fields.size());
+
+  // Sequences with elements of hidden types check every element, lengths known only at runtime are checked too
+  std::unordered_set<InternedString> sequence_names;
+  std::vector<std::pair<InternedString, std::shared_ptr<const ast::Expression>>> length_checks;
+
+  // Replaces the type with its hidden specialization, parameters known at runtime are passed to the type check
+  auto specialize = [this](
+                        const ast::TypeExpression &type_expression,
+                        ir::SpecializationId id,
+                        std::vector<std::shared_ptr<const ast::Expression>> &runtime_parameters) {
+    PrintSpecialization(id);
+    const auto &specialization = schema_->GetSpecialization(id);
+    ast::TypeExpression hidden_type;
+    hidden_type.identifier.name = specialization.name;
+    for (size_t ind = 0; ind < type_expression.parameters.size(); ++ind) {
+      if (specialization.is_runtime[ind]) {
+        runtime_parameters.emplace_back(type_expression.parameters[ind]);
+      } else {
+        hidden_type.parameters.emplace_back(type_expression.parameters[ind]);
+      }
+    }
+    return hidden_type;
+  };
+
+  // Prints all the hidden types needed for this struct
+  // And fill cpp_struct_fields with relevant types
+  for (const auto &field : fields) {
+    if (ast::IsVecType(field.variable->type_expression.identifier.name)) {
+      ast::TypedVariable new_field = *field.variable;
+      auto &parameters             = new_field.type_expression.parameters;
+      if (field.element_specialization) {
+        std::vector<std::shared_ptr<const ast::Expression>> element_dependencies;
+        parameters[0] = std::make_shared<const ast::Expression>(specialize(
+            std::get<ast::TypeExpression>(*parameters[0]),
+            *field.element_specialization,
+            element_dependencies));
+        sequence_names.insert(new_field.name);
+        checker_members.emplace_back(new_field.name, std::move(element_dependencies));
+      }
+      // Vec without the length is a vector
+      if (field.runtime_length) {
+        length_checks.emplace_back(new_field.name, parameters[1]);
+        parameters.pop_back();
       }
+      cpp_struct_fields.emplace_back(std::move(new_field));
+      continue;
+    }
+    if (!field.specialization) {
+      cpp_struct_fields.emplace_back(*field.variable);
+      continue;
+    }
 
-      checker_members[field.name] = std::move(variable_dependencies_expressions);
+    // new field that will replace field in this struct
+    ast::TypedVariable new_field;
+    new_field.name = field.variable->name;
 
-      new_field.type_expression.identifier.name = InternedString(new_type_name.str());
-      cpp_struct_fields.emplace_back(new_field);
-    } else {
-      cpp_struct_fields.emplace_back(field);
-    }
+    // parameters known at runtime are passed to the type check
+    std::vector<std::shared_ptr<const ast::Expression>> variable_dependencies_expressions;
+    new_field.type_expression =
+        specialize(field.variable->type_expression, *field.specialization, variable_dependencies_expressions);
 
-    trigger_names.insert(field.name);
+    checker_members.emplace_back(new_field.name, std::move(variable_dependencies_expressions));
+    cpp_struct_fields.emplace_back(std::move(new_field));
   }
 
-  DLOG(INFO) << "Generating cpp message " << ast_message.identifier.name << " templates";
-  if (!ast_message.type_dependencies.empty()) {
+  DLOG(INFO) << "Generating cpp message " << name << " templates";
+  if (!type_dependencies.empty()) {
     *output_ << "template <";
-    PrintVariables(*output_, ast_message.type_dependencies, ", ", true, false, true);
+    PrintVariables(*output_, type_dependencies, ", ", true, false, true);
     *output_ << ">\n";
   }
 
-  *output_ << "struct " << ast_message.identifier.name << " {\n";
+  *output_ << "struct " << name << " {\n";
 
-  DLOG(INFO) << "Generating cpp message " << ast_message.identifier.name << " static variables";
+  DLOG(INFO) << "Generating cpp message " << name << " static variables";
+  // Static variables are members of the struct, so they are numbered from 1 in every struct
+  int string_counter = 0;
+  int enum_counter   = 0;
   for (auto &field : cpp_struct_fields) {
     for (auto &expr : field.type_expression.parameters) {
-      if (std::holds_alternative<ast::Value>(*expr)) {
-        const auto &value = std::get<ast::Value>(*expr);
-        if (std::holds_alternative<ast::ScalarValue<std::string>>(value)) {
-          std::string str = std::get<ast::ScalarValue<std::string>>(value).value;
-          *output_ << "  constexpr static const char str_" << ++string_counter_ << "[] = \"" << str << "\";\n";
-          ast::VarAccess new_expr;
-          std::stringstream expr_name;
-          expr_name << "str_" << string_counter_;
-          new_expr.var_identifier.name = InternedString(expr_name.str());
-          expr                         = std::make_shared<ast::Expression>(new_expr);
-        } else if (std::holds_alternative<ast::ConstructedValue>(value)) {
-          const auto &constructed_value = std::get<ast::ConstructedValue>(value);
-          if (std::holds_alternative<ast::Enum>(
-                  tree_->types.at(tree_->constructor_to_type.at(constructed_value.constructor_identifier.name)))) {
-            //  constexpr static const Dependent<3> enum_1 = Dependent<3>(Second<3>(5));
-            const auto &enum_name = tree_->constructor_to_type.at(constructed_value.constructor_identifier.name);
-            *output_ << "  constexpr static const " << enum_name << " enum_" << ++enum_counter_ << " = " << enum_name;
-            *output_ << "(";
-            (*this)(constructed_value);
-            *output_ << ");\n";
-
-            ast::VarAccess new_expr;
-            std::stringstream expr_name;
-            expr_name << "&enum_" << enum_counter_;
-            new_expr.var_identifier.name = InternedString(expr_name.str());
-            expr                         = std::make_shared<ast::Expression>(new_expr);
-          }
-        }
+      const auto kind = GetStaticValueKind(*expr);
+      if (kind == StaticValueKind::kString) {
+        std::string str = std::get<ast::ScalarValue<std::string>>(std::get<ast::Value>(*expr)).value;
+        output_->Format("  constexpr static const char str_{}[] = \"{}\";\n", ++string_counter, str);
+        ast::VarAccess new_expr;
+        new_expr.var_identifier.name = InternedString(std::format("str_{}", string_counter));
+        expr                         = std::make_shared<ast::Expression>(new_expr);
+      } else if (kind == StaticValueKind::kEnum) {
+        //  constexpr static const Dependent<3> enum_1 = Dependent<3>(Second<3>(5));
+        const auto &constructed_value = std::get<ast::ConstructedValue>(std::get<ast::Value>(*expr));
+        const auto &enum_name = schema_->GetConstructorType(constructed_value.constructor_identifier.name).name;
+        *output_ << "  constexpr static const " << enum_name << " enum_" << ++enum_counter << " = " << enum_name;
+        *output_ << "(";
+        (*this)(constructed_value);
+        *output_ << ");\n";
+
+        ast::VarAccess new_expr;
+        new_expr.var_identifier.name = InternedString(std::format("&enum_{}", enum_counter));
+        expr                         = std::make_shared<ast::Expression>(new_expr);
+      }
+    }
+  }
+
+  DLOG(INFO) << "Generating cpp message " << name << " fields";
+  // Cold fields are moved to a struct allocated on the first write, the rest are members
+  std::unordered_set<InternedString> cold_names;
+  std::vector<ast::TypedVariable> hot_fields;
+  std::vector<size_t> order;
+  for (size_t ind = 0; ind < fields.size(); ++ind) {
+    if (cold_fields_.contains(fields[ind].variable)) {
+      cold_names.insert(cpp_struct_fields[ind].name);
+    } else {
+      hot_fields.push_back(cpp_struct_fields[ind]);
+      order.push_back(ind);
+    }
+  }
+  if (!cold_names.empty()) {
+    *output_ << "  struct Cold {\n";
+    for (const auto &field : cpp_struct_fields) {
+      if (cold_names.contains(field.name)) {
+        *output_ << "    ";
+        (*this)(field);
+        *output_ << ";\n";
       }
     }
+    *output_ << "  };\n";
   }
 
-  DLOG(INFO) << "Generating cpp message " << ast_message.identifier.name << " fields";
+  // Members are declared in the order of the layout, everything else keeps the order of declaration
+  if (options_.reorder_fields) {
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+      return GetAlignment(fields[lhs]) > GetAlignment(fields[rhs]);
+    });
+  }
+  std::vector<ast::TypedVariable> layout_fields;
+  for (const auto ind : order) {
+    layout_fields.push_back(cpp_struct_fields[ind]);
+  }
   *output_ << "  ";
-  PrintVariables(*output_, cpp_struct_fields, ";\n  ", true, true, false);
+  PrintVariables(*output_, layout_fields, ";\n  ", true, true, false);
+  if (!cold_names.empty()) {
+    *output_ << "detail::cold_storage<Cold> cold_;\n  ";
+  }
+  const bool reordered = !std::equal(
+      layout_fields.begin(),
+      layout_fields.end(),
+      hot_fields.begin(),
+      [](const auto &lhs, const auto &rhs) { return lhs.name == rhs.name; });
+  if (allocator_aware_types_.contains(name)) {
+    PrintAllocatorConstructors(name, fields, order, !cold_names.empty(), !reordered);
+  }
+  if (reordered) {
+    PrintLayoutConstructors(name, hot_fields, layout_fields);
+  }
+  for (const auto &field : cpp_struct_fields) {
+    if (cold_names.contains(field.name)) {
+      PrintColdAccessors(field);
+    }
+  }
 
-  DLOG(INFO) << "Generating cpp message " << ast_message.identifier.name << " invariant check";
+  DLOG(INFO) << "Generating cpp message " << name << " invariant check";
   *output_ << "bool check(";
   PrintVariables(*output_, checker_input, ", ", true, false, false);
   *output_ << ") const {\n";
 
   *output_ << "    return true";
   for (const auto &[name, expressions] : checker_members) {
+    const std::string access = name.GetString() + (cold_names.contains(name) ? "()" : "");
     *output_ << " && ";
-    *output_ << name << ".check(";
+    if (sequence_names.contains(name)) {
+      *output_ << "std::all_of(" << access << ".begin(), " << access << ".end(), [&](const auto &item) { return item";
+    } else {
+      *output_ << access;
+    }
+    *output_ << ".check(";
     for (size_t ind = 0; ind < expressions.size(); ++ind) {
       std::visit(*this, *expressions[ind]);
       if (ind != expressions.size() - 1) {
         *output_ << ", ";
       }
     }
-    *output_ << ")";
+    *output_ << (sequence_names.contains(name) ? "); })" : ")");
+  }
+  for (const auto &[name, length] : length_checks) {
+    *output_ << " && " << name << (cold_names.contains(name) ? "()" : "") << ".size() == ";
+    std::visit(*this, *length);
   }
   *output_ << ";\n  }\n";
 
-  DLOG(INFO) << "Generating cpp message " << ast_message.identifier.name << " ending";
+  if (options_.codecs) {
+    PrintStructCodecs(cpp_struct_fields, checker_members, checker_input, length_checks, cold_names);
+  }
+  DLOG(INFO) << "Generating cpp message " << name << " ending";
   *output_ << "};\n\n";
+
+  // Sizes of templates are known only for their instances, and the order is checked only where it is the same on every
+  // target, so that an estimated alignment never breaks the build of the generated code
+  const bool exact_layout = cold_names.empty() && std::all_of(order.begin(), order.end(), [&](size_t ind) {
+                              return IsAlignmentExact(fields[ind]);
+                            });
+  if (options_.reorder_fields && type_dependencies.empty() && !layout_fields.empty() && exact_layout) {
+    *output_ << "static_assert(sizeof(" << name << ") == detail::min_struct_size<";
+    for (size_t ind = 0; ind < layout_fields.size(); ++ind) {
+      if (ind != 0) {
+        *output_ << ", ";
+      }
+      *output_ << "decltype(" << name << "::" << layout_fields[ind].name << ")";
+    }
+    *output_ << ">());\n\n";
+  }
+}
+
+void CppCodeGenerator::PrintLayoutConstructors(
+    const InternedString &name,
+    const std::vector<ast::TypedVariable> &fields,
+    const std::vector<ast::TypedVariable> &layout_fields) {
+  // Aggregate initialization would follow the layout, so the constructor takes the fields in the order of declaration
+  *output_ << name << "() = default;\n";
+  *output_ << "  constexpr " << name << "(";
+  for (size_t ind = 0; ind < fields.size(); ++ind) {
+    if (ind != 0) {
+      *output_ << ", ";
+    }
+    (*this)(fields[ind], false);
+  }
+  *output_ << ")";
+  for (size_t ind = 0; ind < layout_fields.size(); ++ind) {
+    *output_ << "\n      " << (ind == 0 ? ": " : ", ");
+    *output_ << layout_fields[ind].name << "(std::move(" << layout_fields[ind].name << "))";
+  }
+  *output_ << " {}\n  ";
+}
+
+void CppCodeGenerator::PrintAllocatorConstructors(
+    const InternedString &name,
+    const std::vector<ir::Field> &fields,
+    const std::vector<size_t> &order,
+    bool has_cold_fields,
+    bool print_default) {
+  // Members are initialized in the order of the layout, the allocator is given only to the members that use it
+  std::vector<std::pair<std::string, bool>> members;
+  for (const auto ind : order) {
+    members.emplace_back(fields[ind].variable->name.GetString(), IsAllocatorAware(fields[ind]));
+  }
+  if (has_cold_fields) {
+    members.emplace_back("cold_", false);
+  }
+  enum class Source { kNone, kCopy, kMove };
+  auto print_initializers = [&](Source source) {
+    for (size_t ind = 0; ind < members.size(); ++ind) {
+      const auto &[member, uses_allocator] = members[ind];
+      *output_ << "\n      " << (ind == 0 ? ": " : ", ") << member << "(";
+      if (source == Source::kCopy) {
+        *output_ << "other." << member << (uses_allocator ? ", " : "");
+      } else if (source == Source::kMove) {
+        *output_ << "std::move(other." << member << ")" << (uses_allocator ? ", " : "");
+      }
+      *output_ << (uses_allocator ? "alloc)" : ")");
+    }
+    *output_ << " {}\n  ";
+  };
+
+  *output_ << "using allocator_type = std::pmr::polymorphic_allocator<>;\n  ";
+  if (print_default) {
+    *output_ << name << "() = default;\n  ";
+  }
+  *output_ << "explicit " << name << "(const allocator_type &alloc)";
+  print_initializers(Source::kNone);
+  *output_ << name << "(const " << name << " &other, const allocator_type &alloc)";
+  print_initializers(Source::kCopy);
+  *output_ << name << "(" << name << " &&other, const allocator_type &alloc)";
+  print_initializers(Source::kMove);
+}
+
+void CppCodeGenerator::PrintColdAccessors(const ast::TypedVariable &field) {
+  *output_ << "const ";
+  (*this)(field.type_expression, false);
+  *output_ << "&" << field.name << "() const {\n";
+  *output_ << "    return cold_.get()." << field.name << ";\n";
+  *output_ << "  }\n  ";
+  (*this)(field.type_expression, false);
+  *output_ << "&mutable_" << field.name << "() {\n";
+  *output_ << "    return cold_.get_or_create()." << field.name << ";\n";
+  *output_ << "  }\n  ";
+}
+
+size_t CppCodeGenerator::GetAlignment(const ir::Field &field) {
+  if (cold_fields_.contains(field.variable)) {
+    return alignof(void *);
+  }
+  const auto &type_expression = field.variable->type_expression;
+  if (ast::IsVecType(type_expression.identifier.name)) {
+    // Vectors hold pointers, arrays are aligned as their elements
+    if (field.runtime_length) {
+      return alignof(void *);
+    }
+    if (field.element_specialization) {
+      return GetAlignment(*field.element_specialization);
+    }
+    if (field.element_type) {
+      return GetAlignment(schema_->GetType(*field.element_type).declared);
+    }
+    return GetBuiltinAlignment(std::get<ast::TypeExpression>(*type_expression.parameters[0]).identifier.name);
+  }
+  if (field.specialization) {
+    return GetAlignment(*field.specialization);
+  }
+  if (field.type) {
+    return GetAlignment(schema_->GetType(*field.type).declared);
+  }
+  return GetBuiltinAlignment(type_expression.identifier.name);
+}
+
+size_t CppCodeGenerator::GetAlignment(ir::SpecializationId id) {
+  if (const auto iter = alignments_.find(id); iter != alignments_.end()) {
+    return iter->second;
+  }
+
+  // Types can't contain themselves by value, the entry only stops the recursion on malformed schemas
+  alignments_[id]            = 1;
+  size_t alignment           = 1;
+  const auto &specialization = schema_->GetSpecialization(id);
+  for (const auto &field : specialization.fields) {
+    alignment = std::max(alignment, GetAlignment(field));
+  }
+  for (const auto &constructor : specialization.constructors) {
+    for (const auto &field : constructor.fields) {
+      alignment = std::max(alignment, GetAlignment(field));
+    }
+  }
+  alignments_[id] = alignment;
+  return alignment;
+}
+
+bool CppCodeGenerator::IsAlignmentExact(const ir::Field &field) {
+  const auto &type_expression = field.variable->type_expression;
+  if (cold_fields_.contains(field.variable)) {
+    return false;
+  }
+  if (ast::IsVecType(type_expression.identifier.name)) {
+    if (field.runtime_length) {
+      return false;
+    }
+    if (field.element_specialization) {
+      return IsAlignmentExact(*field.element_specialization);
+    }
+    if (field.element_type) {
+      return IsAlignmentExact(schema_->GetType(*field.element_type).declared);
+    }
+    const auto *builtin =
+        ast::FindBuiltinType(std::get<ast::TypeExpression>(*type_expression.parameters[0]).identifier.name);
+    return builtin != nullptr && builtin->kind != ast::BuiltinKind::String;
+  }
+  if (field.specialization) {
+    return IsAlignmentExact(*field.specialization);
+  }
+  if (field.type) {
+    return IsAlignmentExact(schema_->GetType(*field.type).declared);
+  }
+  const auto *builtin = ast::FindBuiltinType(type_expression.identifier.name);
+  return builtin != nullptr && builtin->kind != ast::BuiltinKind::String;
+}
+
+bool CppCodeGenerator::IsAlignmentExact(ir::SpecializationId id) {
+  if (const auto iter = exact_alignments_.find(id); iter != exact_alignments_.end()) {
+    return iter->second;
+  }
+
+  // Variants and tagged unions are laid out by the standard library or by the generated helper
+  const auto &specialization = schema_->GetSpecialization(id);
+  exact_alignments_[id]      = false;
+  if (schema_->GetType(specialization.type).IsEnum()) {
+    return false;
+  }
+  const bool exact = std::all_of(specialization.fields.begin(), specialization.fields.end(), [this](const auto &field) {
+    return IsAlignmentExact(field);
+  });
+  exact_alignments_[id] = exact;
+  return exact;
+}
+
+std::string CppCodeGenerator::GetElementType(const ast::TypeExpression &element) {
+  auto buffer = std::make_shared<CodeWriter>();
+  CppCodeGenerator element_generator(buffer, *this);
+  element_generator(element, false);
+  // Types are printed with a trailing space before the name of the variable
+  std::string type = buffer->str();
+  type.pop_back();
+  return type;
 }
 
 void CppCodeGenerator::operator()(const ast::TypedVariable &variable, bool as_dependency) {
@@ -268,14 +2107,33 @@ void CppCodeGenerator::operator()(const ast::TypeExpression &expr, bool as_depen
     if (as_dependency) {
       *output_ << "const char *";
     } else {
-      *output_ << "std::string ";
+      *output_ << (options_.pmr ? "std::pmr::string " : "std::string ");
     }
   } else if (expr.identifier.name == InternedString("Float")) {
     *output_ << "double ";
   } else if (expr.identifier.name == InternedString("Bool")) {
     *output_ << "bool ";
+  } else if (const auto iter = kFixedWidthTypes.find(expr.identifier.name.GetString());
+             iter != kFixedWidthTypes.end()) {
+    *output_ << iter->second << " ";
+  } else if (ast::IsVecType(expr.identifier.name)) {
+    // Length known only at runtime is dropped from the parameters and checked in check()
+    const std::string element = GetElementType(std::get<ast::TypeExpression>(*expr.parameters[0]));
+    if (expr.parameters.size() == 2) {
+      *output_ << "std::array<" << element << ", ";
+      std::visit(*this, *expr.parameters[1]);
+      *output_ << "> ";
+    } else {
+      *output_ << (options_.pmr ? "std::pmr::vector<" : "std::vector<") << element << "> ";
+    }
   } else {
-    if (as_dependency && std::holds_alternative<ast::Enum>(tree_->types.at(expr.identifier.name))) {
+    // Enums are passed to templates by pointer
+    bool is_enum_dependency = false;
+    if (as_dependency) {
+      const auto type    = schema_->FindType(expr.identifier.name);
+      is_enum_dependency = type && schema_->GetType(*type).IsEnum();
+    }
+    if (is_enum_dependency) {
       *output_ << "const ";
     }
     *output_ << expr.identifier.name;
@@ -291,7 +2149,7 @@ void CppCodeGenerator::operator()(const ast::TypeExpression &expr, bool as_depen
       }
     }
     *output_ << " ";
-    if (as_dependency && std::holds_alternative<ast::Enum>(tree_->types.at(expr.identifier.name))) {
+    if (is_enum_dependency) {
       *output_ << "*";
     }
   }
@@ -336,8 +2194,11 @@ void CppCodeGenerator::operator()(const ast::ConstructedValue &value) {
   *output_ << "}";
 }
 
-void CppCodeGenerator::operator()(const ast::Enum &ast_enum) {
+void CppCodeGenerator::PrintEnum(const ir::Specialization &specialization) {
+  const auto &ast_enum   = schema_->GetType(specialization.type).AsEnum();
   bool has_all_star_case = false;
+  // Constructors of the specialization are ordered by rule
+  size_t tag = 0;
 
   auto print_complex_dependencies = [&](const ast::Enum::Rule &rule) {
     for (size_t ind = 0; (ind != ast_enum.type_dependencies.size()); ++ind) {
@@ -379,16 +2240,10 @@ void CppCodeGenerator::operator()(const ast::Enum &ast_enum) {
     }
     has_all_star_case |= all_stars;
 
-    for (const auto &constructor : rule.outputs) {
-      DLOG(INFO) << "Generating cpp enum " << ast_enum.identifier.name << " constructor "
-                 << constructor.identifier.name;
-      ast::Message sub_struct;
-
-      sub_struct.type_dependencies = ast_enum.type_dependencies;
-      sub_struct.identifier.name   = constructor.identifier.name;
-      sub_struct.fields            = constructor.fields;
-
-      (*this)(sub_struct);
+    for (size_t ind = 0; ind < rule.outputs.size(); ++ind, ++tag) {
+      const auto &constructor = specialization.constructors[tag];
+      DLOG(INFO) << "Generating cpp enum " << ast_enum.identifier.name << " constructor " << constructor.name;
+      PrintStruct(constructor.name, ast_enum.type_dependencies, constructor.fields, {});
     }
 
     DLOG(INFO) << "Generating cpp enum " << ast_enum.identifier.name << " dependencies";
@@ -406,7 +2261,7 @@ void CppCodeGenerator::operator()(const ast::Enum &ast_enum) {
     *output_ << " {\n";
 
     DLOG(INFO) << "Generating cpp enum " << ast_enum.identifier.name << " variable";
-    *output_ << "  std::variant<";
+    *output_ << "  " << (options_.compact_enums ? "detail::tagged_union<" : "std::variant<");
     bool first = true;
     for (const auto &rule_variant : rule.outputs) {
       if (first) {
@@ -423,7 +2278,8 @@ void CppCodeGenerator::operator()(const ast::Enum &ast_enum) {
     *output_ << "  bool check() const {\n";
     *output_ << "    return false";
     first = true;
-    for (const auto &constructor : rule.outputs) {
+    for (size_t ind = 0; ind < rule.outputs.size(); ++ind) {
+      const auto &constructor = rule.outputs[ind];
       *output_ << " ||";
       if (first) {
         first = false;
@@ -431,6 +2287,11 @@ void CppCodeGenerator::operator()(const ast::Enum &ast_enum) {
       } else {
         *output_ << "\n           ";
       }
+      if (options_.compact_enums) {
+        PrintCompactAlternativeCheck(ind);
+        *output_ << "))";
+        continue;
+      }
       *output_ << "(std::holds_alternative<" << constructor.identifier.name;
       print_complex_dependencies(rule);
       *output_ << ">(value) && std::get<" << constructor.identifier.name;
@@ -439,6 +2300,18 @@ void CppCodeGenerator::operator()(const ast::Enum &ast_enum) {
     }
     *output_ << ";\n";
     *output_ << "  }\n";
+    if (options_.codecs) {
+      PrintEnumCodecs();
+      for (const bool with_allocator : GetDecoderOverloads()) {
+        *output_ << "  bool decode_checked(std::string_view &in";
+        PrintDecoderParameters({}, true, with_allocator);
+        *output_ << ") {\n";
+        *output_ << "    return detail::decode_variant_checked(in, value";
+        PrintDecoderArguments({}, with_allocator);
+        *output_ << ");\n";
+        *output_ << "  }\n";
+      }
+    }
 
     *output_ << "};\n\n";
   }
@@ -454,141 +2327,511 @@ void CppCodeGenerator::operator()(const ast::Enum &ast_enum) {
     *output_ << "  bool check() const {\n";
     *output_ << "    return false;\n";
     *output_ << "  }\n";
+    // The enum has no values for these dependencies, so there is nothing to decode
+    if (options_.codecs) {
+      *output_ << "  void encode(std::string &out) const {\n";
+      *output_ << "  }\n";
+      for (const bool with_allocator : GetDecoderOverloads()) {
+        for (const std::string_view decoder : {"decode", "decode_checked"}) {
+          *output_ << "  bool " << decoder << "(std::string_view &in";
+          PrintDecoderParameters({}, true, with_allocator);
+          *output_ << ") {\n";
+          *output_ << "    return false;\n";
+          *output_ << "  }\n";
+        }
+      }
+    }
     *output_ << "};\n\n";
   }
 }
 
-void CppCodeGenerator::operator()(const ast::Enum &ast_enum, const std::vector<ast::TypedVariable> &checker_input) {
-  // Generates enum wirh runtime dependencies
-
-  // I need original correctly ordered dependencied for each case at type check
-  std::string original_name = ast_enum.identifier.name.GetString();
-  std::string added_name    = original_name.substr(original_name.find_first_of('_'));
-  original_name             = original_name.substr(0, original_name.find_first_of('_'));
-
-  for (size_t ind = 0; ind < ast_enum.pattern_mapping.size(); ++ind) {
-    for (const auto &constructor : ast_enum.pattern_mapping[ind].outputs) {
-      ast::Message sub_struct;
-
-      std::stringstream struct_name;
-      struct_name << constructor.identifier.name << "_" << ind + 1 << added_name;
-      DLOG(INFO) << "Generating cpp extra_enum " << ast_enum.identifier.name << " constructor " << struct_name.str();
-
-      sub_struct.type_dependencies = ast_enum.type_dependencies;
-      sub_struct.identifier.name   = InternedString(struct_name.str());
-      sub_struct.fields            = constructor.fields;
-
-      (*this)(sub_struct, checker_input);
-    }
+void CppCodeGenerator::PrintRuntimeEnum(const ir::Specialization &specialization) {
+  // Generates enum with runtime dependencies
+  const auto &type                  = schema_->GetType(specialization.type);
+  const auto &original_enum         = type.AsEnum();
+  const auto &original_dependencies = original_enum.type_dependencies;
+  const auto &type_dependencies     = specialization.static_dependencies;
+  const auto &checker_input         = specialization.runtime_dependencies;
+
+  for (const auto &constructor : specialization.constructors) {
+    DLOG(INFO) << "Generating cpp extra_enum " << specialization.name << " constructor " << constructor.name;
+    PrintStruct(constructor.name, type_dependencies, constructor.fields, checker_input);
   }
 
-  DLOG(INFO) << "Generating cpp extra_enum " << ast_enum.identifier.name << " templates";
-  if (!ast_enum.type_dependencies.empty()) {
+  DLOG(INFO) << "Generating cpp extra_enum " << specialization.name << " templates";
+  if (!type_dependencies.empty()) {
     *output_ << "template <";
-    PrintVariables(*output_, ast_enum.type_dependencies, ", ", true, false, true);
+    PrintVariables(*output_, type_dependencies, ", ", true, false, true);
     *output_ << ">\n";
   }
 
-  *output_ << "struct " << ast_enum.identifier.name << " {\n";
+  *output_ << "struct " << specialization.name << " {\n";
 
-  DLOG(INFO) << "Generating cpp extra_enum " << ast_enum.identifier.name << " variable";
-  *output_ << "  std::variant<";
+  // Prints name of the constructor struct with its template arguments
+  auto print_constructor = [&](const ir::Constructor &constructor) {
+    *output_ << constructor.name;
+    if (!type_dependencies.empty()) {
+      *output_ << "<";
+      PrintVariables(*output_, type_dependencies, ", ", false, false, true);
+      *output_ << ">";
+    }
+  };
+
+  DLOG(INFO) << "Generating cpp extra_enum " << specialization.name << " variable";
+  *output_ << "  " << (options_.compact_enums ? "detail::tagged_union<" : "std::variant<");
   bool first = true;
-  for (size_t ind = 0; ind < ast_enum.pattern_mapping.size(); ++ind) {
-    for (const auto &constructor : ast_enum.pattern_mapping[ind].outputs) {
-      if (first) {
-        first = false;
-      } else {
-        *output_ << ", ";
-      }
-      *output_ << constructor.identifier.name << "_" << ind + 1 << added_name;
-      if (!ast_enum.type_dependencies.empty()) {
-        *output_ << "<";
-        PrintVariables(*output_, ast_enum.type_dependencies, ", ", false, false, true);
-        *output_ << ">";
-      }
+  for (const auto &constructor : specialization.constructors) {
+    if (first) {
+      first = false;
+    } else {
+      *output_ << ", ";
     }
+    print_constructor(constructor);
   }
   *output_ << "> value;\n";
 
-  DLOG(INFO) << "Generating cpp extra_enum " << ast_enum.identifier.name << " invariant check";
+  DLOG(INFO) << "Generating cpp extra_enum " << specialization.name << " invariant check";
   *output_ << "  bool check(";
   PrintVariables(*output_, checker_input, ", ", true, false, true);
   *output_ << ") const {\n";
 
-  const auto &original_dependencies =
-      std::get<ast::Enum>(tree_->types.at(InternedString(original_name))).type_dependencies;
+  // Constructors of the rule with the given index start at rule_begin[index]
+  std::vector<size_t> rule_begin(original_enum.pattern_mapping.size() + 1, 0);
+  for (const auto &constructor : specialization.constructors) {
+    ++rule_begin[constructor.rule + 1];
+  }
+  for (size_t ind = 1; ind < rule_begin.size(); ++ind) {
+    rule_begin[ind] += rule_begin[ind - 1];
+  }
 
-  first = true;
-  for (size_t ind = 0; ind < ast_enum.pattern_mapping.size(); ++ind) {
-    if (first) {
-      first = false;
-      *output_ << "   ";
-    } else {
-      *output_ << "    else";
-    }
-    first = true;
-    for (size_t input_ind = 0; input_ind < ast_enum.pattern_mapping[ind].inputs.size(); ++input_ind) {
-      if (std::holds_alternative<ast::Star>(ast_enum.pattern_mapping[ind].inputs[input_ind])) {
-        continue;
-      }
-      if (first) {
-        first = false;
-        *output_ << " if (";
-      } else {
-        *output_ << " && ";
-      }
-      *output_ << original_dependencies[input_ind].name << " == ";
-      std::visit(*this, ast_enum.pattern_mapping[ind].inputs[input_ind]);
+  // Prints the check that value holds one of the constructors of the rule
+  auto print_rule_check = [&](size_t ind) {
+    if (rule_begin[ind] == rule_begin[ind + 1]) {
+      *output_ << "false";
+      return;
     }
-    bool last_condition = first;
-    *output_ << ((last_condition) ? "\n" : ")\n");
-    *output_ << "      return ";
-
-    first = true;
-    for (const auto &constructor : ast_enum.pattern_mapping[ind].outputs) {
-      std::stringstream constructor_name;
-      constructor_name << constructor.identifier.name << "_" << ind + 1 << added_name;
-      if (first) {
-        first = false;
-      } else {
+    for (size_t tag = rule_begin[ind]; tag < rule_begin[ind + 1]; ++tag) {
+      const auto &constructor = specialization.constructors[tag];
+      if (tag != rule_begin[ind]) {
         *output_ << " || ";
       }
-      *output_ << "(std::holds_alternative<" << constructor_name.str();
-      if (!ast_enum.type_dependencies.empty()) {
-        *output_ << "<";
-        PrintVariables(*output_, ast_enum.type_dependencies, ", ", false, false, true);
-        *output_ << ">";
-      }
-      *output_ << ">(value) && std::get<" << constructor_name.str();
-      if (!ast_enum.type_dependencies.empty()) {
-        *output_ << "<";
-        PrintVariables(*output_, ast_enum.type_dependencies, ", ", false, false, true);
-        *output_ << ">";
+      if (options_.compact_enums) {
+        PrintCompactAlternativeCheck(tag);
+        PrintVariables(*output_, checker_input, ", ", false, false, false);
+        *output_ << "))";
+        continue;
       }
+      *output_ << "(std::holds_alternative<";
+      print_constructor(constructor);
+      *output_ << ">(value) && std::get<";
+      print_constructor(constructor);
       *output_ << ">(value).check(";
+      PrintVariables(*output_, checker_input, ", ", false, false, false);
+      *output_ << "))";
+    }
+  };
+
+  // Rules with scalar patterns are dispatched by the decision tree, the rest are checked one by one
+  auto print_dispatch = [&](const std::function<void(size_t)> &print_rule) {
+    const auto &decision_tree = *type.decision_tree;
+    if (decision_tree.IsScalar()) {
+      PrintDecisionTree(decision_tree, decision_tree.GetRoot(), original_dependencies, print_rule, 4);
+    } else {
       first = true;
-      for (const auto &var : checker_input) {
+      for (size_t ind = 0; ind < original_enum.pattern_mapping.size(); ++ind) {
+        const auto &inputs = original_enum.pattern_mapping[ind].inputs;
         if (first) {
           first = false;
+          *output_ << "   ";
         } else {
-          *output_ << ", ";
+          *output_ << "    else";
+        }
+        bool last_condition = true;
+        for (size_t input_ind = 0; input_ind < inputs.size(); ++input_ind) {
+          if (std::holds_alternative<ast::Star>(inputs[input_ind])) {
+            continue;
+          }
+          if (last_condition) {
+            last_condition = false;
+            *output_ << " if (";
+          } else {
+            *output_ << " && ";
+          }
+          PrintEquals(original_dependencies[input_ind].name, std::get<ast::Value>(inputs[input_ind]));
+        }
+        *output_ << ((last_condition) ? "\n" : ")\n");
+        *output_ << "      return ";
+        print_rule(ind);
+        *output_ << ";\n";
+
+        // as soon as i got all stars no other cases are needed
+        if (last_condition) {
+          break;
         }
-        *output_ << var.name;
       }
-      *output_ << "))";
+    }
+    *output_ << "    return false;\n";
+  };
+  print_dispatch(print_rule_check);
+  *output_ << "  }\n";
+  if (options_.codecs) {
+    PrintEnumCodecs(checker_input);
+
+    // Constructors allowed by the dependencies are found before the constructor is decoded
+    auto print_rule_tags = [&](size_t ind) {
+      if (rule_begin[ind] == rule_begin[ind + 1]) {
+        *output_ << "false";
+      } else {
+        *output_ << "(tag_ >= " << rule_begin[ind] << " && tag_ < " << rule_begin[ind + 1] << ")";
+      }
+    };
+    *output_ << "  static bool has_constructor(std::size_t tag_";
+    PrintDecoderParameters(checker_input, true);
+    *output_ << ") {\n";
+    print_dispatch(print_rule_tags);
+    *output_ << "  }\n";
+
+    for (const bool with_allocator : GetDecoderOverloads()) {
+      *output_ << "  bool decode_checked(std::string_view &in";
+      PrintDecoderParameters(checker_input, true, with_allocator);
+      *output_ << ") {\n";
+      *output_ << "    std::size_t tag_ = 0;\n";
+      *output_ << "    return detail::decode_tag(in, value, tag_) && has_constructor(tag_";
+      PrintDecoderArguments(checker_input);
+      *output_ << ") &&\n";
+      *output_ << "           detail::decode_constructor_checked(in, tag_, value";
+      PrintDecoderArguments(checker_input, with_allocator);
+      *output_ << ");\n";
+      *output_ << "  }\n";
+    }
+  }
+
+  DLOG(INFO) << "Generating cpp extra_enum " << specialization.name << " ending";
+  *output_ << "};\n\n";
+}
+
+void CppCodeGenerator::PrintDecisionTree(
+    const patterns::DecisionTree &decision_tree,
+    const patterns::DecisionTree::Node &node,
+    const std::vector<ast::TypedVariable> &dependencies,
+    const std::function<void(size_t)> &print_rule_check,
+    size_t indent) {
+  if (std::holds_alternative<patterns::DecisionTree::Leaf>(node)) {
+    const auto &rules = std::get<patterns::DecisionTree::Leaf>(node).rules;
+    output_->Indent(indent) << "return ";
+    if (rules.empty()) {
+      *output_ << "false";
+    } else {
+      print_rule_check(rules.front());
     }
     *output_ << ";\n";
+    return;
+  }
 
-    // as soon as i got all stars no other cases are needed
-    if (last_condition) {
-      break;
+  const auto &node_switch = std::get<patterns::DecisionTree::Switch>(node);
+  const auto &name        = dependencies[node_switch.input].name;
+
+  // Integer dependencies are dispatched with switch, other types are compared one by one
+  const auto &first_key = node_switch.cases.front().key;
+  if (std::holds_alternative<int64_t>(first_key) || std::holds_alternative<uint64_t>(first_key)) {
+    const auto &type = dependencies[node_switch.input].type_expression;
+    output_->Indent(indent) << "switch (" << name << ") {\n";
+    for (const auto &node_case : node_switch.cases) {
+      if (!IsReachableCase(type, node_case.key)) {
+        continue;
+      }
+      output_->Indent(indent) << "case " << GetCaseLabel(node_case.key) << ":\n";
+      PrintDecisionTree(
+          decision_tree,
+          decision_tree.GetNode(node_case.next),
+          dependencies,
+          print_rule_check,
+          indent + 2);
+    }
+    output_->Indent(indent) << "default:\n";
+    PrintDecisionTree(
+        decision_tree,
+        decision_tree.GetNode(node_switch.fallback),
+        dependencies,
+        print_rule_check,
+        indent + 2);
+    output_->Indent(indent) << "}\n";
+    return;
+  }
+
+  // String dependencies are dispatched with switch on a hash, that has no collisions among the literals
+  const auto seed = FindPerfectHashSeed(node_switch.cases);
+  if (seed) {
+    output_->Indent(indent) << "switch (detail::string_hash(" << name << ", " << *seed << "ULL)) {\n";
+    for (const auto &node_case : node_switch.cases) {
+      const auto &literal = std::get<std::string>(node_case.key);
+      output_->Indent(indent) << "case " << StringHash(literal, *seed) << "ULL:\n";
+      output_->Indent(indent) << "  if (";
+      PrintEquals(name, node_case.value);
+      *output_ << ") {\n";
+      PrintDecisionTree(
+          decision_tree,
+          decision_tree.GetNode(node_case.next),
+          dependencies,
+          print_rule_check,
+          indent + 4);
+      output_->Indent(indent) << "  }\n";
+      output_->Indent(indent) << "  break;\n";
+    }
+    output_->Indent(indent) << "}\n";
+    PrintDecisionTree(
+        decision_tree,
+        decision_tree.GetNode(node_switch.fallback),
+        dependencies,
+        print_rule_check,
+        indent);
+    return;
+  }
+
+  output_->Indent(indent);
+  for (const auto &node_case : node_switch.cases) {
+    *output_ << "if (";
+    PrintEquals(name, node_case.value);
+    *output_ << ") {\n";
+    PrintDecisionTree(decision_tree, decision_tree.GetNode(node_case.next), dependencies, print_rule_check, indent + 2);
+    output_->Indent(indent) << "} else ";
+  }
+  *output_ << "{\n";
+  PrintDecisionTree(
+      decision_tree,
+      decision_tree.GetNode(node_switch.fallback),
+      dependencies,
+      print_rule_check,
+      indent + 2);
+  output_->Indent(indent) << "}\n";
+}
+
+void CppCodeGenerator::PrintEquals(const InternedString &name, const ast::Value &value) {
+  // String dependencies are `const char *`, so they are compared by content
+  if (std::holds_alternative<ast::ScalarValue<std::string>>(value)) {
+    *output_ << "detail::string_equal(" << name << ", ";
+    (*this)(value);
+    *output_ << ")";
+    return;
+  }
+  *output_ << name << " == ";
+  (*this)(value);
+}
+
+void CppCodeGenerator::PrintStructCodecs(
+    const std::vector<ast::TypedVariable> &fields,
+    const std::vector<std::pair<InternedString, std::vector<std::shared_ptr<const ast::Expression>>>> &checker_members,
+    const std::vector<ast::TypedVariable> &checker_input,
+    const std::vector<std::pair<InternedString, std::shared_ptr<const ast::Expression>>> &length_checks,
+    const std::unordered_set<InternedString> &cold_names) {
+  // Cold fields are read through their accessors and written through mutable ones
+  auto print_access = [&](const ast::TypedVariable &field, bool is_mutable) {
+    if (!cold_names.contains(field.name)) {
+      *output_ << field.name;
+    } else {
+      *output_ << (is_mutable ? "mutable_" : "") << field.name << "()";
+    }
+  };
+  // Fixed32 and Fixed64 share the C++ types with UInt32 and UInt64, so their codecs are chosen here
+  auto is_fixed = [](const ast::TypedVariable &field) {
+    const auto *type_expression = &field.type_expression;
+    if (ast::IsVecType(type_expression->identifier.name)) {
+      type_expression = &std::get<ast::TypeExpression>(*type_expression->parameters[0]);
+    }
+    const auto *builtin = ast::FindBuiltinType(type_expression->identifier.name);
+    return builtin != nullptr && builtin->fixed && builtin->kind == ast::BuiltinKind::Unsigned;
+  };
+
+  *output_ << "  void encode(std::string &out) const {\n";
+  for (const auto &field : fields) {
+    *output_ << (is_fixed(field) ? "    detail::encode_fixed(out, " : "    detail::encode(out, ");
+    print_access(field, false);
+    *output_ << ");\n";
+  }
+  *output_ << "  }\n";
+  // Dependencies of the fields and lengths of the vectors are computed from the fields decoded before
+  auto print_arguments = [&](const ast::TypedVariable &field) {
+    const auto length = std::find_if(length_checks.begin(), length_checks.end(), [&field](const auto &check) {
+      return check.first == field.name;
+    });
+    if (length != length_checks.end()) {
+      *output_ << ", ";
+      std::visit(*this, *length->second);
+    }
+    const auto member = std::find_if(checker_members.begin(), checker_members.end(), [&field](const auto &member) {
+      return member.first == field.name;
+    });
+    if (member != checker_members.end()) {
+      for (const auto &expression : member->second) {
+        *output_ << ", ";
+        std::visit(*this, *expression);
+      }
+    }
+  };
+
+  // Strings and vectors are constructed anew with the allocator, generated types get it in decode(), also through the
+  // arrays and vectors of them
+  auto element_type = [](const ast::TypedVariable &field) -> const ast::TypeExpression & {
+    if (ast::IsVecType(field.type_expression.identifier.name)) {
+      return std::get<ast::TypeExpression>(*field.type_expression.parameters[0]);
+    }
+    return field.type_expression;
+  };
+  auto is_reset = [&element_type](const ast::TypedVariable &field) {
+    const bool is_vector = ast::IsVecType(field.type_expression.identifier.name) &&
+                           field.type_expression.parameters.size() == 1;
+    return is_vector || element_type(field).identifier.name == InternedString("String");
+  };
+  auto takes_allocator = [&element_type](const ast::TypedVariable &field) {
+    return !ast::IsBuiltinType(element_type(field).identifier.name);
+  };
+  auto print_decoder = [&](std::string_view decoder, bool with_allocator) {
+    *output_ << "  bool " << decoder << "(std::string_view &in";
+    PrintDecoderParameters(checker_input, false, with_allocator);
+    *output_ << ") {\n";
+    for (const auto &field : fields) {
+      if (with_allocator && is_reset(field)) {
+        *output_ << "    detail::reset(";
+        print_access(field, true);
+        *output_ << ", alloc);\n";
+      }
     }
+    *output_ << "    return true";
+    for (const auto &field : fields) {
+      *output_ << (is_fixed(field) ? " && detail::decode_fixed(in, " : " && detail::" + std::string(decoder) + "(in, ");
+      print_access(field, true);
+      print_arguments(field);
+      if (with_allocator && takes_allocator(field)) {
+        *output_ << ", alloc";
+      }
+      *output_ << ")";
+    }
+    *output_ << ";\n";
+    *output_ << "  }\n";
+  };
+
+  // Fields are checked with the same dependencies as in check(), vectors are decoded with the lengths they must have
+  for (const bool with_allocator : GetDecoderOverloads()) {
+    print_decoder("decode", with_allocator);
+    print_decoder("decode_checked", with_allocator);
   }
-  *output_ << "    return false;\n";
+}
+
+void CppCodeGenerator::PrintEnumCodecs(const std::vector<ast::TypedVariable> &dependencies) {
+  *output_ << "  void encode(std::string &out) const {\n";
+  *output_ << "    detail::encode_variant(out, value);\n";
   *output_ << "  }\n";
+  for (const bool with_allocator : GetDecoderOverloads()) {
+    *output_ << "  bool decode(std::string_view &in";
+    PrintDecoderParameters(dependencies, true, with_allocator);
+    *output_ << ") {\n";
+    *output_ << "    return detail::decode_variant(in, value";
+    PrintDecoderArguments(dependencies, with_allocator);
+    *output_ << ");\n";
+    *output_ << "  }\n";
+  }
+}
 
-  DLOG(INFO) << "Generating cpp extra_enum " << ast_enum.identifier.name << " ending";
-  *output_ << "};\n\n";
+void CppCodeGenerator::PrintDecoderParameters(
+    const std::vector<ast::TypedVariable> &dependencies,
+    bool as_dependency,
+    bool with_allocator) {
+  for (const auto &dependency : dependencies) {
+    *output_ << ", ";
+    (*this)(dependency, as_dependency);
+  }
+  if (with_allocator) {
+    *output_ << ", const std::pmr::polymorphic_allocator<> &alloc";
+  }
+}
+
+void CppCodeGenerator::PrintDecoderArguments(const std::vector<ast::TypedVariable> &dependencies, bool with_allocator) {
+  for (const auto &dependency : dependencies) {
+    *output_ << ", " << dependency.name;
+  }
+  if (with_allocator) {
+    *output_ << ", alloc";
+  }
+}
+
+std::vector<bool> CppCodeGenerator::GetDecoderOverloads() const {
+  if (options_.pmr) {
+    return {false, true};
+  }
+  return {false};
+}
+
+uint64_t CppCodeGenerator::StringHash(const std::string &str, uint64_t seed) {
+  // FNV-1a, the same function is generated as detail::string_hash
+  uint64_t hash = kFnvOffsetBasis ^ seed;
+  for (char symbol : str) {
+    hash = (hash ^ static_cast<unsigned char>(symbol)) * kFnvPrime;
+  }
+  return hash;
+}
+
+std::optional<uint64_t> CppCodeGenerator::FindPerfectHashSeed(const std::vector<patterns::DecisionTree::Case> &cases) {
+  for (const auto &node_case : cases) {
+    // Literals with escape sequences are hashed differently at runtime, so they are compared one by one
+    if (!std::holds_alternative<std::string>(node_case.key) ||
+        std::get<std::string>(node_case.key).find('\\') != std::string::npos) {
+      return std::nullopt;
+    }
+  }
+  for (uint64_t seed = 0;; ++seed) {
+    std::unordered_set<uint64_t> hashes;
+    bool collision = false;
+    for (const auto &node_case : cases) {
+      collision |= !hashes.insert(StringHash(std::get<std::string>(node_case.key), seed)).second;
+    }
+    if (!collision) {
+      return seed;
+    }
+  }
+}
+
+void CppCodeGenerator::PrintCodecHelpers() {
+  *output_ << kCodecHelpers;
+  if (uses_sequences_) {
+    *output_ << kBulkVarintHelpers;
+    *output_ << kSequenceCodecHelpers;
+  }
+}
+
+void CppCodeGenerator::PrintCompactAlternativeCheck(size_t tag) {
+  *output_ << "(value.index() == " << tag << " && detail::get<" << tag << ">(value).check(";
+}
+
+void CppCodeGenerator::PrintTaggedUnionHelper() {
+  *output_ << kTaggedUnionHelper;
+}
+
+void CppCodeGenerator::PrintLayoutHelper() {
+  *output_ << kLayoutHelper;
+}
+
+void CppCodeGenerator::PrintColdStorageHelper() {
+  *output_ << kColdStorageHelper;
+}
+
+void CppCodeGenerator::PrintArenaHelper() {
+  *output_ << kArenaHelper;
+}
+
+void CppCodeGenerator::PrintStringHelpers() {
+  *output_ << "namespace detail {\n";
+  *output_ << "constexpr unsigned long long string_hash(const char *str, unsigned long long seed) {\n";
+  *output_ << "  unsigned long long hash = " << kFnvOffsetBasis << "ULL ^ seed;\n";
+  *output_ << "  for (; *str != '\\0'; ++str) {\n";
+  *output_ << "    hash = (hash ^ static_cast<unsigned char>(*str)) * " << kFnvPrime << "ULL;\n";
+  *output_ << "  }\n";
+  *output_ << "  return hash;\n";
+  *output_ << "}\n\n";
+  *output_ << "constexpr bool string_equal(const char *lhs, const char *rhs) {\n";
+  *output_ << "  for (; *lhs != '\\0' && *lhs == *rhs; ++lhs, ++rhs) {\n";
+  *output_ << "  }\n";
+  *output_ << "  return *lhs == *rhs;\n";
+  *output_ << "}\n";
+  *output_ << "} // namespace detail\n\n";
 }
 } // namespace dbuf::gen
@@ -3,41 +3,144 @@
 #include "core/codegen/cpp_gen.h"
 #include "core/codegen/kotlin_target/kotlin_gen.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
 #include <set>
-#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace dbuf::gen {
-ITargetCodeGenerator::ITargetCodeGenerator(const std::string &out_file) {
-  output_ = std::make_shared<std::ofstream>(std::ofstream(out_file));
-  if (!output_->is_open()) {
-    throw std::string("Cannot open file in the given path");
+namespace {
+// Errors are thrown as exceptions, strings and string literals
+std::string DescribeError(const std::exception_ptr &error) {
+  try {
+    std::rethrow_exception(error);
+  } catch (const std::exception &err) {
+    return err.what();
+  } catch (const std::string &err) {
+    return err;
+  } catch (const char *err) {
+    return err;
+  } catch (...) {
+    return "Unknown error";
   }
 }
+} // namespace
 
-void ListGenerators::Fill(std::vector<std::string> &formats, const std::string &path, const std::string &filename) {
+void ParallelFor(size_t count, size_t jobs, const std::function<void(size_t)> &body) {
+  std::vector<std::exception_ptr> errors(count);
+  std::atomic<size_t> next_index = 0;
+  auto worker                    = [&]() {
+    for (size_t ind = next_index++; ind < count; ind = next_index++) {
+      try {
+        body(ind);
+      } catch (...) {
+        errors[ind] = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  const size_t threads_count = std::min(jobs, count);
+  threads.reserve(threads_count);
+  for (size_t ind = 1; ind < threads_count; ++ind) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+ITargetCodeGenerator::ITargetCodeGenerator(std::string out_file)
+    : out_file_(std::move(out_file))
+    , output_(std::make_shared<CodeWriter>(CodeWriter::kOutputCapacity)) {}
+
+ITargetCodeGenerator::ITargetCodeGenerator(std::shared_ptr<CodeWriter> output)
+    : output_(std::move(output)) {}
+
+void ITargetCodeGenerator::Write() const {
+  if (out_file_.empty()) {
+    return;
+  }
+  output_->WriteToFile(out_file_);
+  for (const auto &[file, output] : extra_files_) {
+    std::filesystem::create_directories(std::filesystem::path(file).parent_path());
+    output->WriteToFile(file);
+  }
+}
+
+const std::string &ITargetCodeGenerator::GetOutFile() const {
+  return out_file_;
+}
+
+const CodeWriter &ITargetCodeGenerator::GetOutput() const {
+  return *output_;
+}
+
+uint64_t ITargetCodeGenerator::GetHash() const {
+  return output_->Hash();
+}
+
+const std::vector<std::pair<std::string, std::shared_ptr<CodeWriter>>> &ITargetCodeGenerator::GetExtraFiles() const {
+  return extra_files_;
+}
+
+void ListGenerators::Fill(
+    std::vector<std::string> &formats,
+    const std::string &path,
+    const std::string &filename,
+    const CppOptions &cpp_options) {
   if (!std::filesystem::is_directory(path)) {
     throw "Incorrect path: {}" + path;
   }
 
+  manifest_file_ = path + "/" + filename + ".manifest";
+  AddTargets(formats, path + "/" + filename, cpp_options);
+}
+
+void ListGenerators::Fill(std::vector<std::string> &formats, const CppOptions &cpp_options) {
+  AddTargets(formats, "", cpp_options);
+}
+
+const std::vector<std::shared_ptr<ITargetCodeGenerator>> &ListGenerators::GetTargets() const {
+  return targets_;
+}
+
+void ListGenerators::AddTargets(
+    std::vector<std::string> &formats,
+    const std::string &file_prefix,
+    const CppOptions &cpp_options) {
   std::set<std::string> added_formats;
   targets_.reserve(formats.size());
 
+  // Targets without a file keep the code in memory
+  auto out_file = [&file_prefix](const std::string &extension) {
+    return file_prefix.empty() ? std::string() : file_prefix + extension;
+  };
+
   for (std::string &format : formats) {
     if ((format == "cpp") || (format == "c++")) {
       if (!added_formats.contains("cpp")) {
-        std::stringstream full_path;
-        full_path << path << "/" << filename << ".h";
-        targets_.emplace_back(std::make_shared<CppCodeGenerator>(CppCodeGenerator(full_path.str())));
+        targets_.emplace_back(std::make_shared<CppCodeGenerator>(CppCodeGenerator(out_file(".h"), cpp_options)));
         added_formats.insert("cpp");
       } else {
         throw std::string("You can add only one c++ file");
       }
     } else if (format == "kt") {
       if (!added_formats.contains("kt")) {
-        std::stringstream full_path;
-        full_path << path << "/" << filename << ".kt";
-        targets_.emplace_back(std::make_shared<kotlin::CodeGenerator>(kotlin::CodeGenerator(full_path.str())));
+        targets_.emplace_back(std::make_shared<kotlin::CodeGenerator>(kotlin::CodeGenerator(out_file(".kt"))));
         added_formats.insert("kt");
       } else {
         throw std::string("You can add only one kt file");
@@ -48,9 +151,54 @@ void ListGenerators::Fill(std::vector<std::string> &formats, const std::string &
   }
 }
 
-void ListGenerators::Process(ast::AST *tree) {
+void ListGenerators::Process(const ir::Schema &schema, size_t jobs) {
+  // Targets only read the schema and share the jobs: with fewer jobs than targets the targets take turns on them,
+  // otherwise every target gets its part of the jobs for its types
+  jobs = std::max<size_t>(jobs, 1);
+  std::vector<std::exception_ptr> errors(targets_.size());
+  ParallelFor(targets_.size(), std::min(jobs, targets_.size()), [&](size_t ind) {
+    const size_t target_jobs = std::max<size_t>(jobs / targets_.size() + (ind < jobs % targets_.size() ? 1 : 0), 1);
+    try {
+      targets_[ind]->Generate(schema, target_jobs);
+      targets_[ind]->Write();
+    } catch (...) {
+      errors[ind] = std::current_exception();
+    }
+  });
+
+  // A single error keeps its type, errors of several targets are reported together
+  std::vector<std::string> messages;
+  std::exception_ptr first_error;
+  for (const auto &error : errors) {
+    if (error) {
+      first_error = first_error ? first_error : error;
+      messages.push_back(DescribeError(error));
+    }
+  }
+  if (messages.size() == 1) {
+    std::rethrow_exception(first_error);
+  }
+  if (!messages.empty()) {
+    std::string message;
+    for (const auto &target_message : messages) {
+      message += (message.empty() ? "" : "\n") + target_message;
+    }
+    throw message;
+  }
+
+  if (manifest_file_.empty()) {
+    return;
+  }
+  // Files are listed relative to the directory of the manifest
+  const auto directory = std::filesystem::path(manifest_file_).parent_path();
+  CodeWriter manifest;
   for (const auto &target : targets_) {
-    target->Generate(tree);
+    manifest.Format("{:016x} {}\n", target->GetHash(), std::filesystem::path(target->GetOutFile()).filename().string());
+    for (const auto &[file, output] : target->GetExtraFiles()) {
+      const auto relative_file = std::filesystem::path(file).lexically_relative(directory);
+      manifest.Format("{:016x} {}\n", output->Hash(), relative_file.string());
+    }
   }
+  manifest.WriteToFile(manifest_file_);
 }
 } // namespace dbuf::gen
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "core/interning/interned_string.h"
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace dbuf::gen {
+
+/**
+ * @brief In-memory buffer for the generated code, written to the file at once when generation is finished
+ *
+ */
+class CodeWriter {
+public:
+  // Capacity of the writers of whole output files, the buffers of single types grow as they need
+  static constexpr size_t kOutputCapacity = 1 << 16;
+
+  /**
+   * @brief Reserves capacity bytes for the buffer up front
+   *
+   */
+  explicit CodeWriter(size_t capacity = 0);
+
+  CodeWriter &operator<<(std::string_view str);
+  CodeWriter &operator<<(char symbol);
+  CodeWriter &operator<<(const InternedString &str);
+
+  template <typename T>
+    requires std::is_integral_v<T> && (!std::is_same_v<T, bool>) && (!std::is_same_v<T, char>)
+  CodeWriter &operator<<(T value) {
+    char digits[24];
+    auto result = std::to_chars(std::begin(digits), std::end(digits), value);
+    buffer_.append(digits, result.ptr);
+    return *this;
+  }
+
+  /**
+   * @brief Other values, like ast::Value or bool, are printed with their std::ostream operator
+   *
+   */
+  template <typename T>
+    requires(!std::is_convertible_v<const T &, std::string_view>) &&
+            (!std::is_integral_v<T> || std::is_same_v<T, bool>) &&
+            requires(std::ostream &os, const T &value) { os << value; }
+  CodeWriter &operator<<(const T &value) {
+    std::ostringstream stream;
+    stream << value;
+    buffer_ += stream.view();
+    return *this;
+  }
+
+  template <typename... Args>
+  CodeWriter &Format(std::format_string<Args...> format, Args &&...args) {
+    std::format_to(std::back_inserter(buffer_), format, std::forward<Args>(args)...);
+    return *this;
+  }
+
+  /**
+   * @brief Appends width spaces
+   *
+   */
+  CodeWriter &Indent(size_t width);
+
+  [[nodiscard]] const std::string &str() const;
+
+  /**
+   * @brief FNV-1a hash of the buffer
+   *
+   */
+  [[nodiscard]] uint64_t Hash() const;
+
+  /**
+   * @brief Writes the buffer to a temporary file next to the path and renames it, so the file is never half written
+   *
+   * The file is left untouched if it already has the same content, so its modification time doesn't change.
+   *
+   * @return true if the file was written
+   */
+  bool WriteToFile(const std::string &path) const;
+
+private:
+  [[nodiscard]] bool HasSameContent(const std::string &path) const;
+
+  static constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+  static constexpr uint64_t kFnvPrime       = 1099511628211ULL;
+  static const std::string_view kSpaces;
+
+  std::string buffer_;
+};
+
+} // namespace dbuf::gen
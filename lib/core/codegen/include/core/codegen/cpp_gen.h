@@ -1,26 +1,35 @@
 #pragma once
 
+#include "core/codegen/code_writer.h"
 #include "core/codegen/generation.h"
+#include "core/ir/schema.h"
+#include "core/patterns/decision_tree.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace dbuf::gen {
 
 class CppCodeGenerator : public ITargetCodeGenerator {
 public:
-  explicit CppCodeGenerator(const std::string &out_file)
-      : ITargetCodeGenerator(out_file) {}
+  /**
+   * @param options with split headers every type is written to its own header in the directory named after the output
+   * file, and the output file includes all of them
+   */
+  explicit CppCodeGenerator(const std::string &out_file, const CppOptions &options = {})
+      : ITargetCodeGenerator(out_file)
+      , options_(options) {}
 
-  void Generate(const ast::AST *tree) override;
-
-  void operator()(const ast::Message &ast_message, const std::vector<ast::TypedVariable> &checker_input);
-
-  void operator()(const ast::Message &ast_message);
-
-  void operator()(const ast::Enum &ast_enum, const std::vector<ast::TypedVariable> &checker_input);
-
-  void operator()(const ast::Enum &ast_enum);
+  void Generate(const ir::Schema &schema, size_t jobs) override;
 
   void operator()(const ast::TypedVariable &variable, bool as_dependency = false);
 
@@ -39,23 +48,308 @@ public:
   void operator()(const ast::Star &star);
 
   void PrintVariables(
-      std::basic_ostream<char> &out,
+      CodeWriter &out,
       const std::vector<ast::TypedVariable> &variables,
       std::string &&delimeter,
       bool with_types,
       bool add_last_delimeter,
       bool as_dependency);
 
-  bool CheckForTriggers(const std::unordered_set<InternedString> &trigger_names, const ast::Expression &expr);
+private:
+  enum class StaticValueKind {
+    kNone,
+    kString,
+    kEnum,
+  };
+
+  /**
+   * @brief Generator of a part of the code with the schema and options of the parent
+   *
+   */
+  CppCodeGenerator(std::shared_ptr<CodeWriter> output, const CppCodeGenerator &parent)
+      : ITargetCodeGenerator(std::move(output))
+      , options_(parent.options_)
+      , schema_(parent.schema_)
+      , cold_fields_(parent.cold_fields_)
+      , allocator_aware_types_(parent.allocator_aware_types_)
+      , uses_fixed_width_types_(parent.uses_fixed_width_types_)
+      , uses_sequences_(parent.uses_sequences_) {}
+
+  /**
+   * @brief Finds the fields annotated as cold, that can be moved out of their structs
+   *
+   * Types used as dependencies keep their fields inline, since their values are template parameters. Fields read by
+   * dependency expressions stay inline too, as they are accessed as members.
+   */
+  void CollectColdFields();
+
+  /**
+   * @brief Finds the structs that take allocators with --pmr, the ones with strings, vectors or such structs inline
+   *
+   * Enums are std::variant or detail::tagged_union, that don't take allocators, so their constructors get the
+   * allocator in decode() instead.
+   */
+  void CollectAllocatorAwareTypes();
+
+  /**
+   * @brief Whether the member of the field is constructed with the allocator of its struct
+   *
+   */
+  [[nodiscard]] bool IsAllocatorAware(const ir::Field &field) const;
+
+  /**
+   * @brief Whether the options need helpers in namespace detail, besides the ones of string patterns
+   *
+   */
+  [[nodiscard]] bool HasRuntimeHelpers() const;
+
+  /**
+   * @brief Prints standard headers used by the generated code
+   *
+   */
+  void PrintStandardIncludes();
+
+  void PrintType(const ir::Type &type);
 
-  void CreateHiddenTypes(
+  /**
+   * @brief Prints a header per type with all its specializations, and the umbrella header into the output
+   *
+   */
+  void GenerateHeaders(const ir::Schema &schema, size_t jobs);
+
+  /**
+   * @brief Prints the type with its hidden specializations, that are used by the types including the header
+   *
+   */
+  void PrintHeader(const ir::Type &type);
+
+  /**
+   * @brief Prints declarations of the types, that don't take messages as template parameters
+   *
+   */
+  void PrintForwardDeclarations();
+
+  /**
+   * @brief Whether runtime checks of the type compare strings with the generated helpers
+   *
+   */
+  [[nodiscard]] static bool HasStringPatterns(const ir::Type &type);
+
+  /**
+   * @brief Specializations printed first by every type, including its declared one, when types are printed one by one
+   *
+   */
+  [[nodiscard]] std::vector<std::vector<ir::SpecializationId>> PlanTypes() const;
+
+  void PlanSpecialization(
+      ir::SpecializationId id,
+      std::vector<bool> &planned,
+      std::vector<ir::SpecializationId> &specializations) const;
+
+  /**
+   * @brief Parameters with string and enum values are printed as static members of the struct
+   *
+   */
+  [[nodiscard]] StaticValueKind GetStaticValueKind(const ast::Expression &expr) const;
+
+  /**
+   * @brief Prints the specialization unless it is already printed, hidden types are printed before their first use
+   *
+   */
+  void PrintSpecialization(ir::SpecializationId id);
+
+  void PrintStruct(
+      const InternedString &name,
+      const std::vector<ast::TypedVariable> &type_dependencies,
+      const std::vector<ir::Field> &fields,
+      const std::vector<ast::TypedVariable> &checker_input);
+
+  /**
+   * @brief Prints the default constructor and the constructor taking the fields in the order of declaration
+   *
+   */
+  void PrintLayoutConstructors(
+      const InternedString &name,
       const std::vector<ast::TypedVariable> &fields,
-      std::unordered_set<InternedString> trigger_names = {});
+      const std::vector<ast::TypedVariable> &layout_fields);
 
-private:
-  std::unordered_set<InternedString> created_hidden_types_;
-  const ast::AST *tree_;
-  int string_counter_ = 0;
-  int enum_counter_   = 0;
+  /**
+   * @brief Prints allocator_type and the allocator-extended constructors, that pass the allocator to its users
+   *
+   * Other members are value-initialized, copied or moved, and the default constructor is printed unless the layout
+   * constructors print it.
+   */
+  void PrintAllocatorConstructors(
+      const InternedString &name,
+      const std::vector<ir::Field> &fields,
+      const std::vector<size_t> &order,
+      bool has_cold_fields,
+      bool print_default);
+
+  /**
+   * @brief Prints the accessor of the cold field and the mutable one, that allocates the cold fields on first use
+   *
+   */
+  void PrintColdAccessors(const ast::TypedVariable &field);
+
+  /**
+   * @brief Alignment of the type in the generated code, estimated for the platform of the compiler
+   *
+   * Members are ordered by decreasing alignment, the generated static_assert checks the estimate on the target.
+   */
+  size_t GetAlignment(const ir::Field &field);
+  size_t GetAlignment(ir::SpecializationId id);
+
+  /**
+   * @brief Whether the alignment of the type is the same on every target, only such layouts are checked
+   *
+   * Strings, vectors, enums and cold fields depend on the standard library and the size of pointers.
+   */
+  bool IsAlignmentExact(const ir::Field &field);
+  bool IsAlignmentExact(ir::SpecializationId id);
+
+  /**
+   * @brief Type of the elements of a sequence as it is printed in a template argument
+   *
+   */
+  std::string GetElementType(const ast::TypeExpression &element);
+
+  /**
+   * @brief Prints enum with all dependencies known at compile time as template specializations for its rules
+   *
+   */
+  void PrintEnum(const ir::Specialization &specialization);
+
+  /**
+   * @brief Prints enum with dependencies known only at runtime, that are checked in check()
+   *
+   */
+  void PrintRuntimeEnum(const ir::Specialization &specialization);
+
+  /**
+   * @brief Prints runtime dispatch of dependencies along the decision tree, every leaf returns the check of its rule
+   *
+   */
+  void PrintDecisionTree(
+      const patterns::DecisionTree &decision_tree,
+      const patterns::DecisionTree::Node &node,
+      const std::vector<ast::TypedVariable> &dependencies,
+      const std::function<void(size_t)> &print_rule_check,
+      size_t indent);
+
+  void PrintEquals(const InternedString &name, const ast::Value &value);
+
+  /**
+   * @brief Prints encode() and decode() of the struct, that write the fields one after another
+   *
+   * Dependencies are never written, they are computed from the template parameters and the fields of the enclosing
+   * structs, which are decoded before. Lengths of vectors aren't written either, decode() and decode_checked() take the
+   * runtime dependencies to compute them. decode_checked() also checks every field as soon as it is decoded, so
+   * check() is not needed after it. With --pmr both have overloads taking an allocator, that construct the strings
+   * and vectors anew with it and pass it on to the fields of generated types.
+   */
+  void PrintStructCodecs(
+      const std::vector<ast::TypedVariable> &fields,
+      const std::vector<std::pair<InternedString, std::vector<std::shared_ptr<const ast::Expression>>>>
+          &checker_members,
+      const std::vector<ast::TypedVariable> &checker_input,
+      const std::vector<std::pair<InternedString, std::shared_ptr<const ast::Expression>>> &length_checks,
+      const std::unordered_set<InternedString> &cold_names);
+
+  /**
+   * @brief Prints encode() and decode() of the enum, that write the index of the constructor before its fields
+   *
+   * decode() passes the runtime dependencies on to the constructors.
+   */
+  void PrintEnumCodecs(const std::vector<ast::TypedVariable> &dependencies = {});
+
+  /**
+   * @brief Prints runtime dependencies as the trailing parameters and arguments of decode() and decode_checked()
+   *
+   * The allocator of the overloads printed with --pmr goes after the dependencies.
+   */
+  void PrintDecoderParameters(
+      const std::vector<ast::TypedVariable> &dependencies,
+      bool as_dependency,
+      bool with_allocator = false);
+  void PrintDecoderArguments(const std::vector<ast::TypedVariable> &dependencies, bool with_allocator = false);
+
+  /**
+   * @brief Whether decoders are printed without the allocator and with it, the latter only with --pmr
+   *
+   */
+  [[nodiscard]] std::vector<bool> GetDecoderOverloads() const;
+
+  /**
+   * @brief Prints generic encode() and decode() with overloads for builtin types
+   *
+   */
+  void PrintCodecHelpers();
+
+  /**
+   * @brief Prints dbuf::Arena, the monotonic buffer passed to constructors and decoders, and detail::reset
+   *
+   */
+  void PrintArenaHelper();
+
+  /**
+   * @brief Prints detail::tagged_union, the compact replacement of std::variant for enums
+   *
+   * The tag is the smallest unsigned type that fits the constructors, and enums of field-less constructors store only
+   * the tag. Visiting, copying and destroying go through jump tables indexed by the tag.
+   */
+  void PrintTaggedUnionHelper();
+
+  /**
+   * @brief Prints detail::min_struct_size used by the static_asserts on sizes of reordered structs
+   *
+   */
+  void PrintLayoutHelper();
+
+  /**
+   * @brief Prints detail::cold_storage, the lazily allocated holder of cold fields
+   *
+   */
+  void PrintColdStorageHelper();
+
+  /**
+   * @brief Prints the opening of the check of the constructor by its tag, up to the arguments of its check()
+   *
+   */
+  void PrintCompactAlternativeCheck(size_t tag);
+
+  /**
+   * @brief Prints constexpr string_hash and string_equal used by runtime checks of string dependencies
+   *
+   */
+  void PrintStringHelpers();
+
+  static uint64_t StringHash(const std::string &str, uint64_t seed);
+
+  /**
+   * @brief Finds seed of StringHash without collisions among string literals of the cases
+   *
+   * @return std::nullopt if the cases are not strings or can't be hashed at compile time
+   */
+  static std::optional<uint64_t> FindPerfectHashSeed(const std::vector<patterns::DecisionTree::Case> &cases);
+
+  static constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+  static constexpr uint64_t kFnvPrime       = 1099511628211ULL;
+
+  static constexpr std::string_view kForwardHeader = "fwd.h";
+  static constexpr std::string_view kHelpersHeader = "detail.h";
+
+  CppOptions options_;
+  const ir::Schema *schema_ = nullptr;
+  std::vector<bool> printed_specializations_;
+  std::unordered_set<const ast::TypedVariable *> cold_fields_;
+  // Names of structs with allocator_type and allocator-extended constructors
+  std::unordered_set<InternedString> allocator_aware_types_;
+  // Fixed-width types are std::intN_t and std::uintN_t from <cstdint>
+  bool uses_fixed_width_types_ = false;
+  // Sequences are std::array and std::vector, checked with std::all_of
+  bool uses_sequences_ = false;
+  std::unordered_map<ir::SpecializationId, size_t> alignments_;
+  std::unordered_map<ir::SpecializationId, bool> exact_alignments_;
 };
 } // namespace dbuf::gen
\ No newline at end of file
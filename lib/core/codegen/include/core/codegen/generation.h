@@ -1,30 +1,123 @@
 #pragma once
 
 #include "core/ast/ast.h"
+#include "core/codegen/code_writer.h"
+#include "core/ir/schema.h"
 
-#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace dbuf::gen {
 
+/**
+ * @brief Calls body for every index in [0, count) on up to jobs threads
+ *
+ * Exceptions thrown by body are rethrown in the calling thread, the one with the smallest index.
+ */
+void ParallelFor(size_t count, size_t jobs, const std::function<void(size_t)> &body);
+
+/**
+ * @brief Options of the C++ target
+ *
+ */
+struct CppOptions {
+  // Every type is written to its own header, included by the output file
+  bool split_headers = false;
+  // Structs get encode() and decode() for the binary format
+  bool codecs = false;
+  // Strings are std::pmr::string and dbuf::Arena is generated to allocate them from one buffer
+  bool pmr = false;
+  // Enums are detail::tagged_union instead of std::variant
+  bool compact_enums = false;
+  // Members of structs are ordered by alignment to minimize padding
+  bool reorder_fields = false;
+};
+
 class ITargetCodeGenerator {
 public:
-  virtual void Generate(const ast::AST *tree) = 0;
+  /**
+   * @brief Generates code for all types of the schema
+   *
+   * @param jobs number of threads, types are rendered in parallel and concatenated in order if more than 1
+   */
+  virtual void Generate(const ir::Schema &schema, size_t jobs) = 0;
+
+  /**
+   * @brief Writes the generated code to the output file and the extra files, unless they already have the same content
+   *
+   */
+  void Write() const;
+
+  /**
+   * @brief Output file, empty if the code is only kept in memory
+   *
+   */
+  [[nodiscard]] const std::string &GetOutFile() const;
+
+  [[nodiscard]] const CodeWriter &GetOutput() const;
+
+  /**
+   * @brief Hash of the generated code
+   *
+   */
+  [[nodiscard]] uint64_t GetHash() const;
+
+  /**
+   * @brief Files generated besides the output file, like per-type headers, with their paths
+   *
+   */
+  [[nodiscard]] const std::vector<std::pair<std::string, std::shared_ptr<CodeWriter>>> &GetExtraFiles() const;
 
   virtual ~ITargetCodeGenerator() = default;
 
 protected:
-  explicit ITargetCodeGenerator(const std::string &out_file);
+  explicit ITargetCodeGenerator(std::string out_file);
+
+  /**
+   * @brief Generator of a part of the file, that is written by another generator
+   *
+   */
+  explicit ITargetCodeGenerator(std::shared_ptr<CodeWriter> output);
 
-  std::shared_ptr<std::ofstream> output_;
+  std::string out_file_;
+  std::shared_ptr<CodeWriter> output_;
+  std::vector<std::pair<std::string, std::shared_ptr<CodeWriter>>> extra_files_;
 };
 
 class ListGenerators {
 public:
-  void Fill(std::vector<std::string> &formats, const std::string &path, const std::string &filename);
+  void Fill(
+      std::vector<std::string> &formats,
+      const std::string &path,
+      const std::string &filename,
+      const CppOptions &cpp_options = {});
 
-  void Process(ast::AST *tree);
+  /**
+   * @brief Adds targets that keep the generated code in memory instead of writing files
+   *
+   */
+  void Fill(std::vector<std::string> &formats, const CppOptions &cpp_options = {});
+
+  /**
+   * @brief Runs all targets concurrently and writes the manifest with hashes of the generated files
+   *
+   * Errors of all targets are reported, a single one is rethrown as is and several are joined in one string.
+   *
+   * @param jobs number of threads shared by the targets
+   */
+  void Process(const ir::Schema &schema, size_t jobs = 1);
+
+  [[nodiscard]] const std::vector<std::shared_ptr<ITargetCodeGenerator>> &GetTargets() const;
 
 private:
+  void AddTargets(std::vector<std::string> &formats, const std::string &file_prefix, const CppOptions &cpp_options);
+
   std::vector<std::shared_ptr<ITargetCodeGenerator>> targets_;
+  std::string manifest_file_;
 };
 } // namespace dbuf::gen
@@ -3,13 +3,16 @@
 #include "core/ast/ast.h"
 #include "core/codegen/generation.h"
 #include "core/codegen/kotlin_target/kotlin_printer.h"
+#include "core/ir/schema.h"
+
+#include <cstddef>
 
 namespace dbuf::gen::kotlin {
 
 class CodeGenerator : public ITargetCodeGenerator {
 public:
   explicit CodeGenerator(const std::string &out_file);
-  void Generate(const ast::AST *tree) override;
+  void Generate(const ir::Schema &schema, size_t jobs) override;
 
 private:
   Printer printer_;
@@ -3,10 +3,13 @@
 #include "core/ast/ast.h"
 #include "core/codegen/kotlin_target/kotlin_printer.h"
 #include "core/interning/interned_string.h"
+#include "core/ir/schema.h"
+#include "core/patterns/decision_tree.h"
 
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace dbuf::gen::kotlin {
 
@@ -233,13 +236,13 @@ private:
  */
 class MessageCheck : public PrintableObject {
 public:
-  MessageCheck(const ast::Message &message, const ast::AST *tree);
+  MessageCheck(const ir::Type &type, const ir::Schema &schema);
   void Print(Printer &printer) const override;
   ~MessageCheck() override = default;
 
 private:
-  const ast::Message &message_;
-  const ast::AST *tree_;
+  const ir::Type &type_;
+  const ir::Schema &schema_;
 };
 
 /**
@@ -379,13 +382,13 @@ private:
  */
 class PrintableMessage : public PrintableObject {
 public:
-  PrintableMessage(const ast::Message &message, const ast::AST *tree);
+  PrintableMessage(const ir::Type &type, const ir::Schema &schema);
   void Print(Printer &printer) const override;
   ~PrintableMessage() override = default;
 
 private:
-  const ast::Message &message_;
-  const ast::AST *tree_;
+  const ir::Type &type_;
+  const ir::Schema &schema_;
 };
 
 /**
@@ -394,13 +397,13 @@ private:
  */
 class ConstructorCheck : public PrintableObject {
 public:
-  ConstructorCheck(const ast::Constructor &constructor_, const ast::AST *tree);
+  ConstructorCheck(const ir::Constructor &constructor, const ir::Schema &schema);
   void Print(Printer &printer) const override;
   ~ConstructorCheck() override = default;
 
 private:
-  const ast::Constructor &constructor_;
-  const ast::AST *tree_;
+  const ir::Constructor &constructor_;
+  const ir::Schema &schema_;
 };
 
 /**
@@ -458,17 +461,14 @@ private:
  */
 class PrintableConstructor : public PrintableObject {
 public:
-  PrintableConstructor(
-      const ast::DependentType &dependent_type,
-      const ast::Constructor &constructor,
-      const ast::AST *tree);
+  PrintableConstructor(const ast::Enum &ast_enum, const ir::Constructor &constructor, const ir::Schema &schema);
   void Print(Printer &printer) const override;
   ~PrintableConstructor() override = default;
 
 private:
-  const ast::DependentType &dependent_type_;
-  const ast::Constructor &constructor_;
-  const ast::AST *tree_;
+  const ast::Enum &ast_enum_;
+  const ir::Constructor &constructor_;
+  const ir::Schema &schema_;
 };
 
 /**
@@ -507,19 +507,52 @@ private:
   const ast::DependentType &dependent_type_;
 };
 
+/**
+ * @brief Prints checks of constructors allowed by one enum rule
+ *
+ */
+class EnumRuleOutputs : public PrintableObject {
+public:
+  explicit EnumRuleOutputs(const std::vector<ast::Constructor> &outputs);
+  void Print(Printer &printer) const override;
+  ~EnumRuleOutputs() override = default;
+
+private:
+  const std::vector<ast::Constructor> &outputs_;
+};
+
+/**
+ * @brief Prints enum rules compiled into a decision tree as nested `when`
+ *
+ */
+class EnumDecisionTree : public PrintableObject {
+public:
+  EnumDecisionTree(
+      const ast::Enum &ast_enum,
+      const patterns::DecisionTree &decision_tree,
+      const patterns::DecisionTree::Node &node);
+  void Print(Printer &printer) const override;
+  ~EnumDecisionTree() override = default;
+
+private:
+  const ast::Enum &ast_enum_;
+  const patterns::DecisionTree &decision_tree_;
+  const patterns::DecisionTree::Node &node_;
+};
+
 /**
  * @brief Prints method `fun check()` for enum class
  *
  */
 class EnumCheck : public PrintableObject {
 public:
-  EnumCheck(const ast::Enum &ast_enum, const ast::AST *tree);
+  EnumCheck(const ir::Type &type, const ir::Schema &schema);
   void Print(Printer &printer) const override;
   ~EnumCheck() override = default;
 
 private:
-  const ast::Enum &ast_enum_;
-  const ast::AST *tree_;
+  const ir::Type &type_;
+  const ir::Schema &schema_;
 };
 
 /**
@@ -613,7 +646,7 @@ private:
  */
 class PrintableEnum : public PrintableObject {
 public:
-  PrintableEnum(const ast::Enum &ast_enum, const ast::AST *tree);
+  PrintableEnum(const ir::Type &type, const ir::Schema &schema);
   void Print(Printer &printer) const override;
   ~PrintableEnum() override = default;
 
@@ -624,8 +657,8 @@ public:
   static const std::string_view kPropertyName;
 
 private:
-  const ast::Enum &ast_enum_;
-  const ast::AST *tree_;
+  const ir::Type &type_;
+  const ir::Schema &schema_;
 };
 
 } // namespace dbuf::gen::kotlin
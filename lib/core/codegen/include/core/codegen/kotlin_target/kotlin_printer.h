@@ -1,10 +1,9 @@
 #pragma once
 
+#include "core/codegen/code_writer.h"
 #include "core/codegen/kotlin_target/kotlin_error.h"
 
-#include <iostream>
 #include <memory>
-#include <ostream>
 #include <string_view>
 
 namespace dbuf::gen::kotlin {
@@ -24,7 +23,10 @@ public:
 
 class Printer {
 public:
-  explicit Printer(std::shared_ptr<std::ostream> output);
+  /**
+   * @param with_header prints package and autogeneration warning, that are not needed for a part of the file
+   */
+  explicit Printer(std::shared_ptr<CodeWriter> output, bool with_header = true);
 
   void AddIndent();
   void RemoveIndent();
@@ -33,9 +35,7 @@ public:
   template <typename T>
   void Print(const T &message) {
     if (need_indent_) {
-      for (unsigned int i = 0; i < indent_count_ * kIndentLength; ++i) {
-        *output_ << " ";
-      }
+      output_->Indent(indent_count_ * kIndentLength);
       need_indent_ = false;
     }
     *output_ << message;
@@ -45,9 +45,7 @@ public:
     requires std::is_base_of_v<PrintableObject, T>
   void Print(const T &printable) {
     if (need_indent_) {
-      for (unsigned int i = 0; i < indent_count_ * kIndentLength; ++i) {
-        *output_ << " ";
-      }
+      output_->Indent(indent_count_ * kIndentLength);
       need_indent_ = false;
     }
     printable.Print(*this);
@@ -77,7 +75,7 @@ private:
   static const std::string_view kDontChangeMessage;
   static const unsigned int kIndentLength;
 
-  std::shared_ptr<std::ostream> output_;
+  std::shared_ptr<CodeWriter> output_;
 
   unsigned int indent_count_ = 0;
   bool need_indent_          = false;
@@ -1,10 +1,15 @@
 #include "core/codegen/kotlin_target/kotlin_gen.h"
 
 #include "core/ast/ast.h"
+#include "core/codegen/code_writer.h"
 #include "core/codegen/kotlin_target/kotlin_objects.h"
 #include "core/codegen/kotlin_target/kotlin_printer.h"
+#include "core/ir/schema.h"
 
+#include <cstddef>
 #include <format>
+#include <memory>
+#include <vector>
 
 namespace dbuf::gen::kotlin {
 
@@ -12,17 +17,32 @@ CodeGenerator::CodeGenerator(const std::string &out_file)
     : ITargetCodeGenerator(out_file)
     , printer_(output_) {}
 
-void CodeGenerator::Generate(const ast::AST *tree) {
-  for (const auto &t : tree->visit_order) {
-    if (std::holds_alternative<ast::Message>(tree->types.at(t))) {
-      const auto &message = std::get<ast::Message>(tree->types.at(t));
-      printer_ << PrintableMessage(message, tree);
-    } else if (std::holds_alternative<ast::Enum>(tree->types.at(t))) {
-      const auto &ast_enum = std::get<ast::Enum>(tree->types.at(t));
-      printer_ << PrintableEnum(ast_enum, tree);
+void CodeGenerator::Generate(const ir::Schema &schema, size_t jobs) {
+  const auto &types = schema.GetTypes();
+  auto print_type   = [&schema](Printer &printer, const ir::Type &type) {
+    if (type.IsEnum()) {
+      printer << PrintableEnum(type, schema);
     } else {
-      throw std::string("kotlin code generation: unknow variant of AST.types.second");
+      printer << PrintableMessage(type, schema);
     }
+  };
+
+  if (jobs <= 1) {
+    for (const auto &type : types) {
+      print_type(printer_, type);
+    }
+    return;
+  }
+
+  // Types don't share any state, so every type is printed into its own buffer
+  std::vector<std::shared_ptr<CodeWriter>> buffers(types.size());
+  ParallelFor(types.size(), jobs, [&](size_t ind) {
+    buffers[ind] = std::make_shared<CodeWriter>();
+    Printer printer(buffers[ind], false);
+    print_type(printer, types[ind]);
+  });
+  for (const auto &buffer : buffers) {
+    *output_ << buffer->str();
   }
 }
 
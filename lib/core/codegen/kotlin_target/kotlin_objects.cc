@@ -1,5 +1,6 @@
 #include "core/codegen/kotlin_target/kotlin_objects.h"
 
+#include "core/ast/builtin_types.h"
 #include "core/codegen/kotlin_target/kotlin_error.h"
 
 #include <vector>
@@ -12,6 +13,17 @@ const std::unordered_map<std::string_view, std::string_view> kTypeMap = {
     {"Int", "Long"},
     {"Unsigned", "ULong"},
     {"String", "String"},
+    {"Int8", "Byte"},
+    {"Int16", "Short"},
+    {"Int32", "Int"},
+    {"Int64", "Long"},
+    {"UInt8", "UByte"},
+    {"UInt16", "UShort"},
+    {"UInt32", "UInt"},
+    {"UInt64", "ULong"},
+    {"Fixed32", "UInt"},
+    {"Fixed64", "ULong"},
+    {"Float32", "Float"},
 };
 
 const std::unordered_map<std::string_view, std::string_view> kDefaultValues = {
@@ -20,6 +32,29 @@ const std::unordered_map<std::string_view, std::string_view> kDefaultValues = {
     {"Int", "0L"},
     {"Unsigned", "0UL"},
     {"String", "\"\""},
+    {"Int8", "0"},
+    {"Int16", "0"},
+    {"Int32", "0"},
+    {"Int64", "0L"},
+    {"UInt8", "0u"},
+    {"UInt16", "0u"},
+    {"UInt32", "0u"},
+    {"UInt64", "0UL"},
+    {"Fixed32", "0u"},
+    {"Fixed64", "0UL"},
+    {"Float32", "0.0f"},
+};
+
+// Literals are Long, ULong or Double, so they are converted to the narrower types before comparisons
+const std::unordered_map<std::string_view, std::string_view> kConversions = {
+    {"Int8", "toByte"},
+    {"Int16", "toShort"},
+    {"Int32", "toInt"},
+    {"UInt8", "toUByte"},
+    {"UInt16", "toUShort"},
+    {"UInt32", "toUInt"},
+    {"Fixed32", "toUInt"},
+    {"Float32", "toFloat"},
 };
 
 const std::string_view DependencyCheck::kErrorMessage = "dependency B of A (is ${A.B}) should be ${C}";
@@ -39,6 +74,19 @@ std::string_view GetType(const dbuf::InternedString &type) {
   return type.GetString();
 }
 
+/**
+ * @brief Prints `expression` as a value of builtin `type`, converting it if the type is narrower than the literals
+ *
+ */
+void PrintConverted(Printer &printer, const dbuf::InternedString &type, const ast::Expression &expression) {
+  const auto conversion = kConversions.find(type.GetString());
+  if (conversion == kConversions.end()) {
+    printer << PrintableExpression(expression);
+  } else {
+    printer << "(" << PrintableExpression(expression) << ")." << conversion->second << "()";
+  }
+}
+
 /**
  * @brief Prints `ast::Value` to `printer`
  *
@@ -102,32 +150,60 @@ void AddTypeChecks(Printer &printer, const ast::TypedVariable &property, const a
   }
 }
 
+/**
+ * @brief Prints the check of the size of the list `Vec T n` and type checks of its elements
+ *
+ */
+void AddSequenceChecks(Printer &printer, const ir::Field &property, const ir::Schema &schema) {
+  // Size of a list is Int, so the length is converted before the comparison
+  const ast::Identifier size_type {{}, {InternedString("Int32")}};
+  const auto &parameters = property.variable->type_expression.parameters;
+  printer << DependencyCheck(property.variable->name, InternedString("size"), size_type, *parameters[1]);
+  printer.NewLine();
+
+  const auto &element = std::get<ast::TypeExpression>(*parameters[0]);
+  if (!property.element_type || element.parameters.empty()) {
+    return;
+  }
+  printer << property.variable->name << ".forEach ";
+  BracesScope scope(printer);
+  const ast::TypedVariable item {{InternedString("it")}, element};
+  const auto &element_type = schema.GetType(*property.element_type);
+  if (element_type.IsEnum()) {
+    AddTypeChecks(printer, item, element_type.AsEnum());
+  } else {
+    AddTypeChecks(printer, item, element_type.AsMessage());
+  }
+}
+
 /**
  * @brief Prints all type checks for all `properties` and their dependent fields
  *
  */
 void AddAllTypeChecks(
     Printer &printer,
-    const std::vector<ast::TypedVariable> &properties,
-    const ast::AST *tree,
+    const std::vector<ir::Field> &properties,
+    const ir::Schema &schema,
     bool last = false) {
   bool printed = false;
   for (const auto &property : properties) {
-    const auto &type = property.type_expression.identifier.name;
-    if (kTypeMap.find(type.GetString()) != kTypeMap.end()) {
+    if (ast::IsVecType(property.variable->type_expression.identifier.name)) {
+      printed = true;
+      AddSequenceChecks(printer, property, schema);
       continue;
     }
-    if (property.type_expression.parameters.empty()) {
+    if (!property.type) {
+      continue;
+    }
+    if (property.variable->type_expression.parameters.empty()) {
       continue;
     }
     printed                         = true;
-    const auto &corresponded_object = tree->types.at(type);
-    if (std::holds_alternative<ast::Message>(corresponded_object)) {
-      AddTypeChecks(printer, property, std::get<ast::Message>(corresponded_object));
-    } else if (std::holds_alternative<ast::Enum>(corresponded_object)) {
-      AddTypeChecks(printer, property, std::get<ast::Enum>(corresponded_object));
+    const auto &corresponded_object = schema.GetType(*property.type);
+    if (corresponded_object.IsEnum()) {
+      AddTypeChecks(printer, *property.variable, corresponded_object.AsEnum());
     } else {
-      throw KotlinError("unknow variant of ast.types.second");
+      AddTypeChecks(printer, *property.variable, corresponded_object.AsMessage());
     }
   }
   if (printed && !last) {
@@ -193,6 +269,11 @@ PrintableVariable::PrintableVariable(const ast::TypedVariable &typed_variable)
 void PrintableVariable::Print(Printer &printer) const {
   const auto &name = typed_variable_.name;
   const auto &type = typed_variable_.type_expression.identifier.name;
+  if (ast::IsVecType(type)) {
+    const auto &element = std::get<ast::TypeExpression>(*typed_variable_.type_expression.parameters[0]);
+    printer << name << ": List<" << GetType(element.identifier.name) << ">";
+    return;
+  }
   printer << name << ": " << GetType(type);
 }
 
@@ -311,7 +392,8 @@ SmartEqual::SmartEqual(const ast::Identifier &indentifiable, bool not_expression
     : indentifiable_(indentifiable)
     , not_expression_(not_expression) {}
 void SmartEqual::Print(Printer &printer) const {
-  if (kTypeMap.find(indentifiable_.name.GetString()) != kTypeMap.end()) {
+  // Lists compare their elements with equals()
+  if (kTypeMap.find(indentifiable_.name.GetString()) != kTypeMap.end() || ast::IsVecType(indentifiable_.name)) {
     if (not_expression_) {
       printer << " != ";
     } else {
@@ -336,8 +418,9 @@ DependencyCheck::DependencyCheck(
     , dependency_type_(dependency_type)
     , expression_(expression) {}
 void DependencyCheck::Print(Printer &printer) const {
-  printer << "check(" << dependency_name_ << "." << dependency_property_ << SmartEqual(dependency_type_)
-          << PrintableExpression(expression_) << ") {\"";
+  printer << "check(" << dependency_name_ << "." << dependency_property_ << SmartEqual(dependency_type_);
+  PrintConverted(printer, dependency_type_.name, expression_);
+  printer << ") {\"";
   for (const auto &ch : kErrorMessage) {
     if (ch == 'A') {
       printer << dependency_name_;
@@ -366,17 +449,18 @@ void InitCheck::Print(Printer &printer) const {
   printer << "\"}";
 }
 
-MessageCheck::MessageCheck(const ast::Message &message, const ast::AST *tree)
-    : message_(message)
-    , tree_(tree) {}
+MessageCheck::MessageCheck(const ir::Type &type, const ir::Schema &schema)
+    : type_(type)
+    , schema_(schema) {}
 void MessageCheck::Print(Printer &printer) const {
   printer << "fun check() ";
   BracesScope scope(printer);
 
-  AddAllTypeChecks(printer, message_.type_dependencies, tree_, message_.fields.empty());
-  if (!message_.fields.empty()) {
-    AddAllInitChecks(printer, message_.fields);
-    AddAllTypeChecks(printer, message_.fields, tree_, true);
+  const auto &message = type_.AsMessage();
+  AddAllTypeChecks(printer, type_.dependencies, schema_, message.fields.empty());
+  if (!message.fields.empty()) {
+    AddAllInitChecks(printer, message.fields);
+    AddAllTypeChecks(printer, schema_.GetSpecialization(type_.declared).fields, schema_, true);
   }
 }
 
@@ -469,7 +553,8 @@ void ClassToStringImpl::Print(Printer &printer) const {
   printer << "}\"" << NewLine;
 }
 void ClassToStringImpl::PrintValue(SeparatablePrinter<const char *> &sprinter, const ast::TypedVariable &variable) {
-  if (kTypeMap.find(variable.type_expression.identifier.name.GetString()) != kTypeMap.end()) {
+  const auto &type = variable.type_expression.identifier.name;
+  if (kTypeMap.find(type.GetString()) != kTypeMap.end() || ast::IsVecType(type)) {
     sprinter << "$" << variable.name;
   } else {
     sprinter << "${" << variable.name << ".toString(depth-1U)}";
@@ -536,33 +621,34 @@ void MessageCompanion::Print(Printer &printer) const {
   printer << MakeMessageCompanion(message_);
 }
 
-PrintableMessage::PrintableMessage(const ast::Message &message, const ast::AST *tree)
-    : message_(message)
-    , tree_(tree) {}
+PrintableMessage::PrintableMessage(const ir::Type &type, const ir::Schema &schema)
+    : type_(type)
+    , schema_(schema) {}
 void PrintableMessage::Print(Printer &printer) const {
-  printer << "class " << message_.identifier.name << Constructor(message_) << " ";
+  const auto &message = type_.AsMessage();
+  printer << "class " << message.identifier.name << Constructor(message) << " ";
   BracesScope scope(printer);
-  printer << Properties(message_);
-  printer << SecondaryConstructor(message_, message_) << NewLine;
-  printer << MessageCheck(message_, tree_) << NewLine;
-  printer << ClassEquals(message_, message_, message_) << NewLine;
+  printer << Properties(message);
+  printer << SecondaryConstructor(message, message) << NewLine;
+  printer << MessageCheck(type_, schema_) << NewLine;
+  printer << ClassEquals(message, message, message) << NewLine;
   printer << ClassToString() << NewLine;
-  printer << ClassToStringImpl(message_, message_, message_) << NewLine;
-  printer << ClassSameFields(message_, message_) << NewLine;
+  printer << ClassToStringImpl(message, message, message) << NewLine;
+  printer << ClassSameFields(message, message) << NewLine;
   printer << ClassNotSameFields() << NewLine;
-  printer << MessageCompanion(message_);
+  printer << MessageCompanion(message);
   scope.Close();
   printer.NewLine();
 }
 
-ConstructorCheck::ConstructorCheck(const ast::Constructor &constructor, const ast::AST *tree)
+ConstructorCheck::ConstructorCheck(const ir::Constructor &constructor, const ir::Schema &schema)
     : constructor_(constructor)
-    , tree_(tree) {}
+    , schema_(schema) {}
 void ConstructorCheck::Print(Printer &printer) const {
   printer << "fun check() ";
   BracesScope scope(printer);
-  AddAllInitChecks(printer, constructor_.fields);
-  AddAllTypeChecks(printer, constructor_.fields, tree_, true);
+  AddAllInitChecks(printer, constructor_.constructor->fields);
+  AddAllTypeChecks(printer, constructor_.fields, schema_, true);
 }
 
 DefaultConstructorCompanion::DefaultConstructorCompanion(
@@ -627,27 +713,25 @@ void ConstructorCompanion::Print(Printer &printer) const {
 }
 
 PrintableConstructor::PrintableConstructor(
-    const ast::DependentType &dependent_type,
-    const ast::Constructor &constructor,
-    const ast::AST *tree)
-    : dependent_type_(dependent_type)
+    const ast::Enum &ast_enum,
+    const ir::Constructor &constructor,
+    const ir::Schema &schema)
+    : ast_enum_(ast_enum)
     , constructor_(constructor)
-    , tree_(tree) {}
+    , schema_(schema) {}
 void PrintableConstructor::Print(Printer &printer) const {
-  printer << "class " << constructor_.identifier.name << Constructor(dependent_type_) << " ";
+  const auto &constructor = *constructor_.constructor;
+  printer << "class " << constructor.identifier.name << Constructor(ast_enum_) << " ";
   BracesScope scope(printer);
-  printer << Properties(constructor_);
-  printer << SecondaryConstructor(constructor_, dependent_type_) << NewLine;
-  printer << ConstructorCheck(constructor_, tree_) << NewLine;
-  printer << ClassEquals(constructor_, constructor_, dependent_type_) << NewLine;
+  printer << Properties(constructor);
+  printer << SecondaryConstructor(constructor, ast_enum_) << NewLine;
+  printer << ConstructorCheck(constructor_, schema_) << NewLine;
+  printer << ClassEquals(constructor, constructor, ast_enum_) << NewLine;
   printer << ClassToString() << NewLine;
-  printer << ClassToStringImpl(constructor_, constructor_, dependent_type_) << NewLine;
-  printer << ClassSameFields(constructor_, constructor_) << NewLine;
+  printer << ClassToStringImpl(constructor, constructor, ast_enum_) << NewLine;
+  printer << ClassSameFields(constructor, constructor) << NewLine;
   printer << ClassNotSameFields() << NewLine;
-  printer << ConstructorCompanion(
-      constructor_,
-      dependent_type_,
-      tree_->constructor_to_type.at(constructor_.identifier.name));
+  printer << ConstructorCompanion(constructor, ast_enum_, ast_enum_.identifier.name);
   scope.Close();
   printer.NewLine();
 }
@@ -656,7 +740,8 @@ EnumStatement::EnumStatement(const ast::TypedVariable &target, const ast::Value
     : target_(target)
     , expect_(expect) {}
 void EnumStatement::Print(Printer &printer) const {
-  printer << target_.name << " == " << PrintableExpression(expect_);
+  printer << target_.name << " == ";
+  PrintConverted(printer, target_.type_expression.identifier.name, expect_);
 }
 
 EnumRuleCheck::EnumRuleCheck(const ast::Enum::Rule &rule, const ast::DependentType &dependent_type)
@@ -687,36 +772,81 @@ void EnumRuleCheck::Print(Printer &printer) const {
   pscope.Close();
   printer << " ";
   BracesScope bscope(printer);
-  if (rule_.outputs.empty()) {
-    printer << "check(false) {\"" << kErrorMessage << "\"}";
+  printer << EnumRuleOutputs(rule_.outputs);
+  bscope.Close();
+}
+
+EnumRuleOutputs::EnumRuleOutputs(const std::vector<ast::Constructor> &outputs)
+    : outputs_(outputs) {}
+void EnumRuleOutputs::Print(Printer &printer) const {
+  const auto &error_msg = EnumRuleCheck::kErrorMessage;
+  if (outputs_.empty()) {
+    printer << "check(false) {\"" << error_msg << "\"}";
     printer.NewLine();
   } else {
     const auto &property = PrintableEnum::kPropertyName;
     SeparatablePrinter sprinter(printer, "else ");
-    for (const auto &constructor : rule_.outputs) {
+    for (const auto &constructor : outputs_) {
       sprinter << "if (" << property << " is " << constructor.identifier.name << ") ";
       sprinter << "(" << property << " as " << constructor.identifier.name << ").check()" << NewLine;
       sprinter << Separate;
     }
     printer << "else ";
-    printer << "check(false) {\"" << kErrorMessage << "\"}" << NewLine;
+    printer << "check(false) {\"" << error_msg << "\"}" << NewLine;
   }
   printer << "return" << NewLine;
-  bscope.Close();
 }
 
-EnumCheck::EnumCheck(const ast::Enum &ast_enum, const ast::AST *tree)
+EnumDecisionTree::EnumDecisionTree(
+    const ast::Enum &ast_enum,
+    const patterns::DecisionTree &decision_tree,
+    const patterns::DecisionTree::Node &node)
     : ast_enum_(ast_enum)
-    , tree_(tree) {}
+    , decision_tree_(decision_tree)
+    , node_(node) {}
+void EnumDecisionTree::Print(Printer &printer) const {
+  if (std::holds_alternative<patterns::DecisionTree::Leaf>(node_)) {
+    static const std::vector<ast::Constructor> kNoConstructors;
+    const auto &rules = std::get<patterns::DecisionTree::Leaf>(node_).rules;
+    printer << EnumRuleOutputs(rules.empty() ? kNoConstructors : ast_enum_.pattern_mapping[rules.front()].outputs);
+    return;
+  }
+
+  const auto &node_switch = std::get<patterns::DecisionTree::Switch>(node_);
+  const auto &dependency  = ast_enum_.type_dependencies[node_switch.input];
+  printer << "when (" << dependency.name << ") ";
+  BracesScope when_scope(printer);
+  // Labels are converted to the type of the dependency, like in EnumStatement
+  for (const auto &node_case : node_switch.cases) {
+    PrintConverted(printer, dependency.type_expression.identifier.name, node_case.value);
+    printer << " -> ";
+    BracesScope case_scope(printer);
+    printer << EnumDecisionTree(ast_enum_, decision_tree_, decision_tree_.GetNode(node_case.next));
+  }
+  printer << "else -> ";
+  BracesScope else_scope(printer);
+  printer << EnumDecisionTree(ast_enum_, decision_tree_, decision_tree_.GetNode(node_switch.fallback));
+}
+
+EnumCheck::EnumCheck(const ir::Type &type, const ir::Schema &schema)
+    : type_(type)
+    , schema_(schema) {}
 void EnumCheck::Print(Printer &printer) const {
+  const auto &ast_enum = type_.AsEnum();
   printer << "fun check() ";
   BracesScope scope(printer);
-  AddAllTypeChecks(printer, ast_enum_.type_dependencies, tree_);
+  AddAllTypeChecks(printer, type_.dependencies, schema_);
   printer << InitCheck(PrintableEnum::kPropertyName);
   printer.NewLine();
   printer.NewLine();
-  for (const auto &rule : ast_enum_.pattern_mapping) {
-    printer << EnumRuleCheck(rule, ast_enum_);
+  // Rules with scalar patterns are dispatched by the decision tree, the rest are checked one by one
+  const auto &decision_tree = *type_.decision_tree;
+  if (decision_tree.IsScalar()) {
+    printer << EnumDecisionTree(ast_enum, decision_tree, decision_tree.GetRoot());
+  } else {
+    for (const auto &rule : ast_enum.pattern_mapping) {
+      printer << EnumRuleCheck(rule, ast_enum);
+    }
   }
   printer << "check(false) {\"" << EnumRuleCheck::kErrorMessage << "\"}" << NewLine;
 }
@@ -842,26 +972,25 @@ void EnumCompanion::Print(Printer &printer) const {
   printer << DefaultEnumCompanion(ast_enum_);
 }
 
-PrintableEnum::PrintableEnum(const ast::Enum &ast_enum, const ast::AST *tree)
-    : ast_enum_(ast_enum)
-    , tree_(tree) {}
+PrintableEnum::PrintableEnum(const ir::Type &type, const ir::Schema &schema)
+    : type_(type)
+    , schema_(schema) {}
 void PrintableEnum::Print(Printer &printer) const {
-  for (const auto &rule : ast_enum_.pattern_mapping) {
-    for (const auto &constructor : rule.outputs) {
-      printer << PrintableConstructor(ast_enum_, constructor, tree_);
-    }
+  const auto &ast_enum = type_.AsEnum();
+  for (const auto &constructor : schema_.GetSpecialization(type_.declared).constructors) {
+    printer << PrintableConstructor(ast_enum, constructor, schema_);
   }
-  printer << "class " << ast_enum_.identifier.name << Constructor(ast_enum_) << " ";
+  printer << "class " << ast_enum.identifier.name << Constructor(ast_enum) << " ";
   BracesScope scope(printer);
   printer << "lateinit var " << kPropertyName << ": Any" << NewLine << NewLine;
-  printer << EnumSecondaryConstructor(ast_enum_) << NewLine;
-  printer << EnumCheck(ast_enum_, tree_) << NewLine;
-  printer << EnumEquals(ast_enum_) << NewLine;
+  printer << EnumSecondaryConstructor(ast_enum) << NewLine;
+  printer << EnumCheck(type_, schema_) << NewLine;
+  printer << EnumEquals(ast_enum) << NewLine;
   printer << ClassToString() << NewLine;
-  printer << EnumToStringImpl(ast_enum_) << NewLine;
-  printer << EnumSameFields(ast_enum_) << NewLine;
+  printer << EnumToStringImpl(ast_enum) << NewLine;
+  printer << EnumSameFields(ast_enum) << NewLine;
   printer << ClassNotSameFields() << NewLine;
-  printer << EnumCompanion(ast_enum_);
+  printer << EnumCompanion(ast_enum);
   scope.Close();
   printer.NewLine();
 }
@@ -6,10 +6,12 @@ const std::string_view Printer::kDontChangeMessage = "This file is autogenerated
 const std::string_view Printer::kPackageName       = "dbuf";
 const unsigned int Printer::kIndentLength          = 4;
 
-Printer::Printer(std::shared_ptr<std::ostream> output)
+Printer::Printer(std::shared_ptr<CodeWriter> output, bool with_header)
     : output_(std::move(output)) {
-  *output_ << "package " << kPackageName << "\n\n";
-  *output_ << "// " << kDontChangeMessage << "\n\n";
+  if (with_header) {
+    *output_ << "package " << kPackageName << "\n\n";
+    *output_ << "// " << kDontChangeMessage << "\n\n";
+  }
   need_indent_ = true;
 }
 
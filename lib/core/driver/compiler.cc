@@ -0,0 +1,265 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#include "core/driver/compiler.h"
+
+#include "core/ast/ast.h"
+#include "core/checker/checker.h"
+#include "core/checker/expression_comparator.h"
+#include "core/codegen/generation.h"
+#include "core/codegen/kotlin_target/kotlin_error.h"
+#include "core/interning/interned_string.h"
+#include "core/ir/reachability.h"
+#include "core/ir/schema.h"
+#include "core/parser/parse_helper.h"
+#include "dbuf.tab.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace dbuf {
+
+namespace {
+
+std::vector<Compiler::Diagnostic> ToDiagnostics(Compiler::Diagnostic::Stage stage, const checker::ErrorList &errors) {
+  std::vector<Compiler::Diagnostic> diagnostics;
+  diagnostics.reserve(errors.size());
+  for (const auto &error : errors) {
+    diagnostics.push_back({stage, error.message});
+  }
+  return diagnostics;
+}
+
+/**
+ * @brief Runs a check of the schema, an exception thrown by it is returned as its only error
+ *
+ */
+template <typename Check>
+checker::ErrorList RunCheck(const Check &check) {
+  try {
+    return check();
+  } catch (const std::exception &err) {
+    return {{err.what()}};
+  }
+}
+
+std::vector<Compiler::Diagnostic> GetParseDiagnostics(const parser::ParseHelper &parse_helper) {
+  std::vector<Compiler::Diagnostic> diagnostics;
+  for (const auto &error : parse_helper.GetErrors()) {
+    diagnostics.push_back({Compiler::Diagnostic::Stage::kParsing, error});
+  }
+  return diagnostics;
+}
+
+/**
+ * @brief Prints the definition of the type and returns the types it uses
+ *
+ */
+std::set<InternedString> DescribeType(const ast::Message &message, const ast::AST &ast, std::ostream &out) {
+  out << "message " << message.identifier.name;
+  for (const auto &dependency : message.type_dependencies) {
+    out << " (" << dependency << ")";
+  }
+  for (const auto &field : message.fields) {
+    out << " " << field << ";";
+  }
+  return ir::GetUsedTypes(message, ast);
+}
+
+std::set<InternedString> DescribeType(const ast::Enum &ast_enum, const ast::AST &ast, std::ostream &out) {
+  out << "enum " << ast_enum.identifier.name;
+  for (const auto &dependency : ast_enum.type_dependencies) {
+    out << " (" << dependency << ")";
+  }
+  for (const auto &rule : ast_enum.pattern_mapping) {
+    out << " " << rule.inputs << " =>";
+    for (const auto &constructor : rule.outputs) {
+      out << " " << constructor.identifier.name << " {";
+      for (const auto &field : constructor.fields) {
+        out << " " << field << ";";
+      }
+      out << " }";
+    }
+  }
+  return ir::GetUsedTypes(ast_enum, ast);
+}
+
+} // namespace
+
+Compiler::Compiler() = default;
+
+Compiler::~Compiler() = default;
+
+std::unordered_map<InternedString, uint64_t> Compiler::GetFingerprints(const ast::AST &ast) {
+  // Fingerprint of a type covers its definition and the fingerprints of all types it uses, so it changes
+  // together with any of its transitive dependencies
+  std::unordered_map<InternedString, uint64_t> fingerprints;
+  for (const auto &name : ast.visit_order) {
+    std::ostringstream description;
+    auto used_types = std::visit(
+        [&](const auto &type) { return DescribeType(type, ast, description); },
+        ast.types.at(name));
+    used_types.erase(name);
+    for (const auto &used_type : used_types) {
+      auto iter = fingerprints.find(used_type);
+      if (iter != fingerprints.end()) {
+        description << " " << used_type << ":" << iter->second;
+      }
+    }
+    fingerprints.emplace(name, std::hash<std::string>()(description.str()));
+  }
+  return fingerprints;
+}
+
+std::vector<InternedString> Compiler::GetUncheckedTypes(const ast::AST &ast) {
+  const auto fingerprints = GetFingerprints(ast);
+  // Types removed from the schema are forgotten. z3 never releases datatypes, so all of them are declared again once
+  // the previous definitions outnumber the current ones
+  std::erase_if(checked_types_, [&fingerprints](const auto &type) { return !fingerprints.contains(type.first); });
+  if (!z3_stuff_ || z3_stuff_->declarations_ > kMaxDeclarationsPerType * std::max(fingerprints.size(), size_t {16})) {
+    z3_stuff_ = std::make_unique<checker::Z3stuff>();
+    checked_types_.clear();
+  }
+
+  // Only the changed types and their dependents have new fingerprints, the rest keep their datatypes
+  std::vector<InternedString> unchecked;
+  for (const auto &name : ast.visit_order) {
+    auto iter = checked_types_.find(name);
+    if (iter == checked_types_.end() || iter->second != fingerprints.at(name)) {
+      checked_types_.insert_or_assign(name, fingerprints.at(name));
+      unchecked.push_back(name);
+    }
+  }
+  return unchecked;
+}
+
+std::vector<Compiler::Diagnostic> Compiler::Compile(std::string_view source, std::vector<Output> &outputs) {
+  return Compile(source, outputs, Options {});
+}
+
+std::vector<Compiler::Diagnostic>
+Compiler::Compile(std::string_view source, std::vector<Output> &outputs, const Options &options) {
+  using Stage = Diagnostic::Stage;
+
+  // Split headers are extra files, that outputs in memory have no place for
+  if (options.cpp.split_headers) {
+    return {{Stage::kOptions, "Headers can be split only when they are written to files"}};
+  }
+  std::vector<std::string> formats;
+  formats.reserve(outputs.size());
+  for (const auto &output : outputs) {
+    formats.push_back(output.format);
+  }
+  gen::ListGenerators generators;
+  try {
+    generators.Fill(formats, options.cpp);
+  } catch (const std::string &err) {
+    return {{Stage::kOptions, err}};
+  }
+
+  ast::AST ast;
+  std::istringstream in(std::string {source});
+  std::ostringstream lexer_output;
+  parser::ParseHelper parse_helper(in, lexer_output, &ast);
+  try {
+    parse_helper.Parse();
+  } catch (const parser::Parser::syntax_error &err) {
+    auto diagnostics = GetParseDiagnostics(parse_helper);
+    std::ostringstream message;
+    message << "Error: " << err.what() << " at " << err.location;
+    diagnostics.push_back({Stage::kParsing, message.str()});
+    return diagnostics;
+  } catch (const char *err) {
+    auto diagnostics = GetParseDiagnostics(parse_helper);
+    if (diagnostics.empty()) {
+      diagnostics.push_back({Stage::kParsing, err});
+    }
+    return diagnostics;
+  }
+
+  auto errors = RunCheck([&ast] { return checker::Checker::CheckNameResolution(ast); });
+  if (!errors.empty()) {
+    return ToDiagnostics(Stage::kNameResolution, errors);
+  }
+  errors = RunCheck([&ast] { return checker::Checker::CheckPositivity(ast); });
+  if (!errors.empty()) {
+    return ToDiagnostics(Stage::kPositivity, errors);
+  }
+  // Types that passed the type check in previous compilations with the same definitions are not checked again
+  const auto unchecked_types = GetUncheckedTypes(ast);
+  // Substitution errors of the checker are thrown
+  errors = RunCheck([&] { return checker::Checker::CheckTypeResolution(ast, unchecked_types, *z3_stuff_); });
+  if (!errors.empty()) {
+    // Datatypes of the failed check are not trusted, so these types are checked again by the next compilation
+    for (const auto &name : unchecked_types) {
+      checked_types_.erase(name);
+    }
+    return ToDiagnostics(Stage::kTypeChecking, errors);
+  }
+
+  if (!options.roots.empty()) {
+    const std::vector<InternedString> root_types(options.roots.begin(), options.roots.end());
+    const auto unknown_roots = ir::PruneUnreachableTypes(ast, root_types);
+    if (!unknown_roots.empty()) {
+      std::vector<Diagnostic> diagnostics;
+      for (const auto &root : unknown_roots) {
+        diagnostics.push_back({Stage::kOptions, "Unknown root type: " + root.GetString()});
+      }
+      return diagnostics;
+    }
+  }
+
+  ir::Schema::Options schema_options;
+  schema_options.merge_specializations = options.merge_specializations;
+  std::vector<Diagnostic> unknown_merged_types;
+  for (const auto &name : options.merged_types) {
+    InternedString type_name(name);
+    if (!ast.types.contains(type_name)) {
+      unknown_merged_types.push_back({Stage::kOptions, "Unknown merged type: " + name});
+    }
+    schema_options.merged_types.insert(type_name);
+  }
+  if (!unknown_merged_types.empty()) {
+    return unknown_merged_types;
+  }
+
+  try {
+    const ir::Schema schema(ast, std::move(schema_options));
+    generators.Process(schema, options.jobs);
+  } catch (const gen::kotlin::KotlinError &err) {
+    return {{Stage::kGeneration, err.what()}};
+  } catch (const std::exception &err) {
+    return {{Stage::kGeneration, err.what()}};
+  } catch (const std::string &err) {
+    return {{Stage::kGeneration, err}};
+  } catch (const char *err) {
+    return {{Stage::kGeneration, err}};
+  }
+
+  const auto &targets = generators.GetTargets();
+  for (size_t ind = 0; ind < outputs.size(); ++ind) {
+    outputs[ind].code = targets[ind]->GetOutput().str();
+  }
+  return {};
+}
+
+} // namespace dbuf
@@ -14,6 +14,9 @@ the Free Software Foundation, either version 3 of the License, or
 #include "core/checker/checker.h"
 #include "core/codegen/generation.h"
 #include "core/codegen/kotlin_target/kotlin_error.h"
+#include "core/interning/interned_string.h"
+#include "core/ir/reachability.h"
+#include "core/ir/schema.h"
 #include "core/parser/parse_helper.h"
 #include "dbuf.tab.hpp"
 
@@ -22,11 +25,24 @@ the Free Software Foundation, either version 3 of the License, or
 #include <cstdlib>
 #include <exception>
 #include <fstream>
+#include <iostream>
+#include <utility>
 #include <vector>
 
 namespace dbuf {
 
-int Driver::Run(const std::string &input_filename, const std::string &path, std::vector<std::string> &output_formats) {
+int Driver::Run(
+    const std::string &input_filename,
+    const std::string &path,
+    std::vector<std::string> &output_formats) {
+  return Run(input_filename, path, output_formats, Options {});
+}
+
+int Driver::Run(
+    const std::string &input_filename,
+    const std::string &path,
+    std::vector<std::string> &output_formats,
+    const Options &options) {
   std::ifstream in_file(input_filename);
   if (!in_file.good()) {
     return EXIT_FAILURE;
@@ -38,7 +54,7 @@ int Driver::Run(const std::string &input_filename, const std::string &path, std:
 
   gen::ListGenerators generators;
   try {
-    generators.Fill(output_formats, path, filename);
+    generators.Fill(output_formats, path, filename, options.cpp);
   } catch (std::string &err) {
     std::cerr << err << std::endl;
     return EXIT_FAILURE;
@@ -49,9 +65,15 @@ int Driver::Run(const std::string &input_filename, const std::string &path, std:
   try {
     parse_helper.Parse();
   } catch (const parser::Parser::syntax_error &err) {
+    for (const auto &error : parse_helper.GetErrors()) {
+      std::cerr << error << std::endl;
+    }
     std::cerr << "Uncaught syntax error: " << err.what() << std::endl;
     return EXIT_FAILURE;
   } catch (const char *err) {
+    for (const auto &error : parse_helper.GetErrors()) {
+      std::cerr << error << std::endl;
+    }
     std::cerr << "Parsing error: " << err << std::endl;
     return EXIT_FAILURE;
   } catch (...) {
@@ -63,11 +85,43 @@ int Driver::Run(const std::string &input_filename, const std::string &path, std:
     return EXIT_FAILURE;
   }
 
+  // Only the requested types and the types they use are generated, all of them are checked anyway
+  if (!options.roots.empty()) {
+    const std::vector<InternedString> root_types(options.roots.begin(), options.roots.end());
+    const auto unknown_roots = ir::PruneUnreachableTypes(ast, root_types);
+    if (!unknown_roots.empty()) {
+      for (const auto &root : unknown_roots) {
+        std::cerr << "Unknown root type: " << root << std::endl;
+      }
+      return EXIT_FAILURE;
+    }
+  }
+
+  ir::Schema::Options schema_options;
+  schema_options.merge_specializations = options.merge_specializations;
+  for (const auto &name : options.merged_types) {
+    InternedString type_name(name);
+    if (!ast.types.contains(type_name)) {
+      std::cerr << "Unknown merged type: " << name << std::endl;
+      return EXIT_FAILURE;
+    }
+    schema_options.merged_types.insert(type_name);
+  }
+
+  // Both generators use the schema resolved once after the checks
+  const ir::Schema schema(ast, std::move(schema_options));
+  if (options.print_stats) {
+    std::cout << "Types: " << schema.GetTypes().size()
+              << ", hidden specializations: " << schema.GetHiddenSpecializationsCount() << std::endl;
+  }
   try {
-    generators.Process(&ast);
+    generators.Process(schema, options.jobs);
   } catch (const gen::kotlin::KotlinError &err) {
     std::cerr << err.what() << std::endl;
     return EXIT_FAILURE;
+  } catch (const std::string &err) {
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
   } catch (const char *err) {
     std::cerr << err << std::endl;
     return EXIT_FAILURE;
@@ -0,0 +1,119 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#pragma once
+
+#include "core/ast/ast.h"
+#include "core/codegen/generation.h"
+#include "core/interning/interned_string.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dbuf {
+
+namespace checker {
+struct Z3stuff;
+} // namespace checker
+
+/**
+ * @brief Compiles schemas from memory into memory, for use as a library
+ *
+ * Interned strings are released together with the AST and the outputs of a compilation, so one compiler can be used
+ * for many schemas. Compilations of one compiler must not run concurrently.
+ *
+ * The compiler keeps the z3 datatypes of the types that passed the type check. Only the types whose definitions or
+ * transitive dependencies changed are checked again, against the kept datatypes of the rest.
+ */
+class Compiler {
+public:
+  Compiler();
+  ~Compiler();
+
+  Compiler(const Compiler &)            = delete;
+  Compiler &operator=(const Compiler &) = delete;
+
+  struct Diagnostic {
+    enum class Stage {
+      kOptions,
+      kParsing,
+      kNameResolution,
+      kPositivity,
+      kTypeChecking,
+      kGeneration,
+    };
+
+    Stage stage;
+    std::string message;
+  };
+
+  /**
+   * @brief Buffer for the generated code of one format, like "cpp" or "kt"
+   *
+   */
+  struct Output {
+    std::string format;
+    std::string code;
+  };
+
+  /**
+   * @brief Options of the generated code, the same as Driver::Options
+   *
+   * The generated code is kept in memory, so C++ headers can't be split.
+   */
+  struct Options {
+    // Number of threads used for code generation
+    size_t jobs = 1;
+    // Types to generate together with the types they use, all types if empty
+    std::vector<std::string> roots = {};
+    // Layout and features of the generated C++ code
+    gen::CppOptions cpp = {};
+    // Every type has at most one hidden specialization, see ir::Schema::Options
+    bool merge_specializations = false;
+    // Types with at most one hidden specialization
+    std::vector<std::string> merged_types = {};
+  };
+
+  /**
+   * @brief Checks the schema and generates code for every requested output
+   *
+   * @param outputs formats to generate, their code is filled only if the compilation succeeds
+   * @return diagnostics of the first failed stage, empty on success
+   */
+  std::vector<Diagnostic> Compile(std::string_view source, std::vector<Output> &outputs);
+  std::vector<Diagnostic> Compile(std::string_view source, std::vector<Output> &outputs, const Options &options);
+
+private:
+  // Declarations of datatypes per type in the schema, after which the z3 state is created again
+  static constexpr size_t kMaxDeclarationsPerType = 8;
+
+  /**
+   * @brief Hashes of the definitions of the types together with the hashes of the types they use
+   *
+   */
+  static std::unordered_map<InternedString, uint64_t> GetFingerprints(const ast::AST &ast);
+
+  /**
+   * @brief Types that need the type check in visit order, they are remembered as checked with their fingerprints
+   *
+   */
+  std::vector<InternedString> GetUncheckedTypes(const ast::AST &ast);
+
+  std::unique_ptr<checker::Z3stuff> z3_stuff_;
+  // Fingerprint of every type whose z3 datatype is kept in z3_stuff_
+  std::unordered_map<InternedString, uint64_t> checked_types_;
+};
+
+} // namespace dbuf
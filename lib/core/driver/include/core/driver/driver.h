@@ -10,6 +10,9 @@ the Free Software Foundation, either version 3 of the License, or
 */
 #pragma once
 
+#include "core/codegen/generation.h"
+
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -17,7 +20,29 @@ namespace dbuf {
 
 class Driver {
 public:
-  static int Run(const std::string &input_filename, const std::string &path, std::vector<std::string> &output_formats);
+  struct Options {
+    // Number of threads used for code generation
+    size_t jobs = 1;
+    // Types to generate together with the types they use, all types if empty
+    std::vector<std::string> roots = {};
+    // Layout and features of the generated C++ code
+    gen::CppOptions cpp = {};
+    // Every type has at most one hidden specialization, see ir::Schema::Options
+    bool merge_specializations = false;
+    // Types with at most one hidden specialization
+    std::vector<std::string> merged_types = {};
+    // Prints the number of generated types and specializations
+    bool print_stats = false;
+  };
+
+  static int
+  Run(const std::string &input_filename, const std::string &path, std::vector<std::string> &output_formats);
+
+  static int Run(
+      const std::string &input_filename,
+      const std::string &path,
+      std::vector<std::string> &output_formats,
+      const Options &options);
 };
 
 } // namespace dbuf
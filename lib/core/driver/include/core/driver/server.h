@@ -0,0 +1,75 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#pragma once
+
+#include "core/driver/compiler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace dbuf {
+
+/**
+ * @brief Compiler daemon, that keeps the compiler warm between requests on a unix domain socket
+ *
+ * A request is the list of formats separated by spaces on the first line, followed by the schema, up to the end of
+ * the stream. The first line may also hold the generation flags of the command line, like `--codecs` or
+ * `--merge=Foo`, that are added to the options the server was started with for this request. The response lists diagnostics as `diagnostic <stage> <size>\n<message>` and, on success, the generated
+ * code as `output <format> <size>\n<code>`, and ends with `end\n`. A request with `stop` on the first line stops the
+ * server.
+ *
+ * Every connection is read and answered by its own thread, so a slow client doesn't delay the others, while the
+ * compilations themselves run one at a time on the shared compiler.
+ */
+class Server {
+public:
+  explicit Server(std::string socket_path, Compiler::Options options = {});
+
+  /**
+   * @brief Serves requests until the stop request, and waits for the connections being served
+   *
+   */
+  int Run();
+
+  /**
+   * @brief Compiles the request and returns the response
+   *
+   */
+  std::string HandleRequest(std::string_view request);
+
+private:
+  static constexpr int kBacklog = 16;
+  // Longest wait for a client to send or receive data
+  static constexpr int kTimeoutSeconds = 10;
+
+  /**
+   * @brief Reads the request from the connection, answers it and closes the connection
+   *
+   */
+  void Serve(int connection);
+
+  std::string socket_path_;
+  // Options of every request, before the flags of the request are added
+  Compiler::Options options_;
+  std::mutex compiler_mutex_;
+  Compiler compiler_;
+  std::atomic<bool> stopped_ = false;
+  int listener_              = -1;
+
+  std::mutex connections_mutex_;
+  std::condition_variable connections_done_;
+  size_t connections_ = 0;
+};
+
+} // namespace dbuf
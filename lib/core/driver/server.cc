@@ -0,0 +1,219 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#include "core/driver/server.h"
+
+#include "core/driver/compiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace dbuf {
+
+namespace {
+
+// Returns nothing if the read times out or fails
+std::optional<std::string> ReadAll(int connection) {
+  std::string data;
+  char buffer[1 << 16];
+  while (true) {
+    const ssize_t size = read(connection, buffer, sizeof(buffer));
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size < 0) {
+      return std::nullopt;
+    }
+    if (size == 0) {
+      return data;
+    }
+    data.append(buffer, size);
+  }
+}
+
+void WriteAll(int connection, std::string_view data) {
+  while (!data.empty()) {
+    const ssize_t size = send(connection, data.data(), data.size(), MSG_NOSIGNAL);
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size <= 0) {
+      return;
+    }
+    data.remove_prefix(size);
+  }
+}
+
+// Adds a generation flag of the request header to the options, returns the error if the flag is unknown
+std::optional<std::string> ApplyFlag(std::string_view flag, Compiler::Options &options) {
+  constexpr std::string_view kMerge = "--merge=";
+  constexpr std::string_view kRoot  = "--root=";
+  if (flag == "--codecs") {
+    options.cpp.codecs = true;
+  } else if (flag == "--pmr") {
+    options.cpp.pmr = true;
+  } else if (flag == "--compact-enums") {
+    options.cpp.compact_enums = true;
+  } else if (flag == "--reorder-fields") {
+    options.cpp.reorder_fields = true;
+  } else if (flag == "--merge-specializations") {
+    options.merge_specializations = true;
+  } else if (flag.starts_with(kMerge)) {
+    options.merged_types.emplace_back(flag.substr(kMerge.size()));
+  } else if (flag.starts_with(kRoot)) {
+    options.roots.emplace_back(flag.substr(kRoot.size()));
+  } else {
+    return "Unknown flag: " + std::string(flag);
+  }
+  return std::nullopt;
+}
+
+} // namespace
+
+Server::Server(std::string socket_path, Compiler::Options options)
+    : socket_path_(std::move(socket_path))
+    , options_(std::move(options)) {}
+
+int Server::Run() {
+  sockaddr_un address {};
+  address.sun_family = AF_UNIX;
+  if (socket_path_.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path is too long: " << socket_path_ << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::memcpy(address.sun_path, socket_path_.c_str(), socket_path_.size() + 1);
+
+  const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    std::cerr << "Cannot create socket: " << std::strerror(errno) << std::endl;
+    return EXIT_FAILURE;
+  }
+  // A socket left by a previous server is replaced, anything else at the path is kept
+  struct stat status {};
+  if (lstat(socket_path_.c_str(), &status) == 0) {
+    if (!S_ISSOCK(status.st_mode)) {
+      std::cerr << "Cannot listen on " << socket_path_ << ": the path exists and is not a socket" << std::endl;
+      close(listener);
+      return EXIT_FAILURE;
+    }
+    unlink(socket_path_.c_str());
+  }
+  if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listener, kBacklog) < 0) {
+    std::cerr << "Cannot listen on " << socket_path_ << ": " << std::strerror(errno) << std::endl;
+    close(listener);
+    return EXIT_FAILURE;
+  }
+
+  listener_ = listener;
+  while (!stopped_) {
+    const int connection = accept(listener, nullptr, nullptr);
+    if (connection < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // The stop request shuts the listener down to interrupt accept()
+      if (!stopped_) {
+        std::cerr << "Cannot accept connection: " << std::strerror(errno) << std::endl;
+      }
+      break;
+    }
+    // A client that stops sending or reading is disconnected instead of holding its thread forever
+    const timeval timeout {.tv_sec = kTimeoutSeconds, .tv_usec = 0};
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    {
+      const std::lock_guard lock(connections_mutex_);
+      ++connections_;
+    }
+    std::thread([this, connection] { Serve(connection); }).detach();
+  }
+
+  {
+    std::unique_lock lock(connections_mutex_);
+    connections_done_.wait(lock, [this] { return connections_ == 0; });
+  }
+  close(listener);
+  unlink(socket_path_.c_str());
+  return stopped_ ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void Server::Serve(int connection) {
+  const auto request = ReadAll(connection);
+  if (request) {
+    WriteAll(connection, HandleRequest(*request));
+  }
+  close(connection);
+
+  const std::lock_guard lock(connections_mutex_);
+  if (--connections_ == 0) {
+    connections_done_.notify_all();
+  }
+}
+
+std::string Server::HandleRequest(std::string_view request) {
+  const size_t line_end = std::min(request.find('\n'), request.size());
+  std::istringstream header {std::string(request.substr(0, line_end))};
+  request.remove_prefix(std::min(line_end + 1, request.size()));
+
+  std::vector<Compiler::Output> outputs;
+  Compiler::Options options = options_;
+  std::vector<Compiler::Diagnostic> diagnostics;
+  std::string word;
+  while (header >> word) {
+    if (word == "stop") {
+      stopped_ = true;
+      if (listener_ >= 0) {
+        shutdown(listener_, SHUT_RDWR);
+      }
+      return "end\n";
+    }
+    if (!word.starts_with("--")) {
+      outputs.push_back({.format = word, .code = {}});
+    } else if (auto error = ApplyFlag(word, options)) {
+      diagnostics.push_back({Compiler::Diagnostic::Stage::kOptions, std::move(*error)});
+    }
+  }
+
+  std::ostringstream response;
+  if (diagnostics.empty()) {
+    const std::lock_guard lock(compiler_mutex_);
+    diagnostics = compiler_.Compile(request, outputs, options);
+  }
+  for (const auto &diagnostic : diagnostics) {
+    response << "diagnostic " << static_cast<int>(diagnostic.stage) << " " << diagnostic.message.size() << "\n";
+    response << diagnostic.message;
+  }
+  if (diagnostics.empty()) {
+    for (const auto &output : outputs) {
+      response << "output " << output.format << " " << output.code.size() << "\n";
+      response << output.code;
+    }
+  }
+  response << "end\n";
+  return response.str();
+}
+
+} // namespace dbuf
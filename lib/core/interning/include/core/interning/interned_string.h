@@ -10,6 +10,7 @@ the Free Software Foundation, either version 3 of the License, or
 */
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <limits>
@@ -20,30 +21,49 @@ the Free Software Foundation, either version 3 of the License, or
 
 namespace dbuf {
 
+/**
+ * @brief Immutable string stored once in a global table and compared by id
+ *
+ * Strings are reference counted and removed from the table when their last InternedString is destroyed, so a
+ * long-lived process doesn't keep the names of every schema it compiled. Ids are never reused.
+ */
 class InternedString {
 public:
   InternedString() = default;
 
-  explicit InternedString(const uint64_t id)
-      : id_(id) {}
+  explicit InternedString(uint64_t id);
 
   explicit InternedString(const std::string &str);
   explicit InternedString(std::string &&str);
 
+  InternedString(const InternedString &other);
+  InternedString(InternedString &&other) noexcept;
+  InternedString &operator=(const InternedString &other);
+  InternedString &operator=(InternedString &&other) noexcept;
+  ~InternedString();
+
   [[nodiscard]] uint64_t GetId() const;
   [[nodiscard]] const std::string &GetString() const;
 
+  /**
+   * @brief Number of strings in the table
+   *
+   */
+  static size_t GetTableSize();
+
   bool operator==(const InternedString &other) const;
   bool operator<(const InternedString &other) const;
   friend std::ostream &operator<<(std::ostream &os, const InternedString &str);
 
 private:
-  static constexpr uint64_t kInvalidId = std::numeric_limits<uint64_t>::max();
+  struct Entry;
+  struct Table;
+
+  static Table &GetTable();
 
-  static std::unordered_map<std::string, uint64_t> string_map_;
-  static std::unordered_map<uint64_t, std::reference_wrapper<const std::string>> id_map_;
+  void Release();
 
-  uint64_t id_ = kInvalidId;
+  Entry *entry_ = nullptr;
 };
 
 } // namespace dbuf
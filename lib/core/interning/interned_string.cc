@@ -12,45 +12,157 @@ the Free Software Foundation, either version 3 of the License, or
 
 #include "glog/logging.h"
 
+#include <atomic>
 #include <cstdint>
-#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 
 namespace dbuf {
 
+struct InternedString::Entry {
+  Entry(std::string &&str, uint64_t id)
+      : str(std::move(str))
+      , id(id) {}
+
+  const std::string str;
+  const uint64_t id;
+  // Number of InternedStrings pointing to the entry, the entry is removed under the unique lock once it drops to 0
+  std::atomic<uint64_t> references {1};
+};
+
+struct InternedString::Table {
+  std::unordered_map<std::string_view, std::unique_ptr<Entry>> string_map;
+  std::unordered_map<uint64_t, Entry *> id_map;
+  uint64_t next_id = 0;
+  // Strings are interned by code generation threads as well
+  std::shared_mutex mutex;
+};
+
+// Never destroyed, so that static InternedStrings of any translation unit can be released at exit
+InternedString::Table &InternedString::GetTable() {
+  static auto *table = new Table();
+  return *table;
+}
+
+InternedString::InternedString(uint64_t id) {
+  Table &table = GetTable();
+  std::shared_lock lock(table.mutex);
+  auto iter = table.id_map.find(id);
+  DCHECK(iter != table.id_map.end()) << "InternedString id not found in id_map";
+  entry_ = iter->second;
+  entry_->references.fetch_add(1, std::memory_order_relaxed);
+}
+
 InternedString::InternedString(const std::string &str)
     : InternedString(std::string(str)) {}
 
 InternedString::InternedString(std::string &&str) {
-  auto result = string_map_.try_emplace(std::move(str), string_map_.size());
-  if (result.second) {
-    id_map_.emplace(result.first->second, std::ref(result.first->first));
+  Table &table = GetTable();
+  {
+    // Entries are removed only under the unique lock, so the found one can't be removed before it is referenced
+    std::shared_lock lock(table.mutex);
+    auto iter = table.string_map.find(str);
+    if (iter != table.string_map.end()) {
+      entry_ = iter->second.get();
+      entry_->references.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  std::unique_lock lock(table.mutex);
+  auto iter = table.string_map.find(str);
+  if (iter != table.string_map.end()) {
+    entry_ = iter->second.get();
+    entry_->references.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  auto entry = std::make_unique<Entry>(std::move(str), table.next_id++);
+  entry_     = entry.get();
+  table.id_map.emplace(entry_->id, entry_);
+  table.string_map.emplace(entry_->str, std::move(entry));
+}
+
+InternedString::InternedString(const InternedString &other)
+    : entry_(other.entry_) {
+  if (entry_ != nullptr) {
+    entry_->references.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+InternedString::InternedString(InternedString &&other) noexcept
+    : entry_(std::exchange(other.entry_, nullptr)) {}
+
+InternedString &InternedString::operator=(const InternedString &other) {
+  if (entry_ != other.entry_) {
+    InternedString copy(other);
+    std::swap(entry_, copy.entry_);
   }
-  id_ = result.first->second;
+  return *this;
+}
+
+InternedString &InternedString::operator=(InternedString &&other) noexcept {
+  if (this != &other) {
+    Release();
+    entry_ = std::exchange(other.entry_, nullptr);
+  }
+  return *this;
+}
+
+InternedString::~InternedString() {
+  Release();
+}
+
+void InternedString::Release() {
+  if (entry_ == nullptr) {
+    return;
+  }
+  Entry *entry      = std::exchange(entry_, nullptr);
+  const uint64_t id = entry->id;
+  if (entry->references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  // The string may be interned again or even removed by another thread before the lock is taken, so the entry is
+  // looked up by id and removed only if it is still unused
+  Table &table = GetTable();
+  std::unique_lock lock(table.mutex);
+  auto iter = table.id_map.find(id);
+  if (iter == table.id_map.end() || iter->second->references.load(std::memory_order_acquire) != 0) {
+    return;
+  }
+  table.string_map.erase(table.string_map.find(iter->second->str));
+  table.id_map.erase(iter);
 }
 
 uint64_t InternedString::GetId() const {
-  DCHECK(id_ != kInvalidId) << "InternedString id not initialized";
+  DCHECK(entry_ != nullptr) << "InternedString id not initialized";
 
-  return id_;
+  return entry_->id;
 }
 
 const std::string &InternedString::GetString() const {
-  DCHECK(id_ != kInvalidId) << "InternedString id not initialized";
+  DCHECK(entry_ != nullptr) << "InternedString id not initialized";
 
-  auto iter = id_map_.find(id_);
-  DCHECK(iter != id_map_.end()) << "InternedString id not found in id_map";
+  // The entry stays in the table while this string references it
+  return entry_->str;
+}
 
-  return iter->second;
+size_t InternedString::GetTableSize() {
+  Table &table = GetTable();
+  std::shared_lock lock(table.mutex);
+  return table.string_map.size();
 }
 
 bool InternedString::operator==(const InternedString &other) const {
-  return id_ == other.id_;
+  return entry_ == other.entry_;
 }
 
 bool InternedString::operator<(const InternedString &other) const {
-  DCHECK(id_ != kInvalidId && other.id_ != kInvalidId) // NOLINT(readability-simplify-boolean-expr)
+  DCHECK(entry_ != nullptr && other.entry_ != nullptr) // NOLINT(readability-simplify-boolean-expr)
       << "InternedString id not initialized";
   return GetString() < other.GetString();
 }
@@ -60,7 +172,4 @@ std::ostream &operator<<(std::ostream &os, const InternedString &str) {
   return os;
 }
 
-std::unordered_map<std::string, uint64_t> InternedString::string_map_;
-std::unordered_map<uint64_t, std::reference_wrapper<const std::string>> InternedString::id_map_;
-
 } // namespace dbuf
@@ -0,0 +1,38 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#pragma once
+
+#include "core/ast/ast.h"
+#include "core/interning/interned_string.h"
+
+#include <set>
+#include <vector>
+
+namespace dbuf::ir {
+
+/**
+ * @brief Names of the types used by the definition in its dependencies, fields, patterns and constructed values
+ *
+ * Builtin types and the type itself are included too, if they are used.
+ */
+std::set<InternedString> GetUsedTypes(const ast::Message &message, const ast::AST &ast);
+std::set<InternedString> GetUsedTypes(const ast::Enum &ast_enum, const ast::AST &ast);
+
+/**
+ * @brief Removes the types that are not reachable from the roots through dependencies, fields and constructors
+ *
+ * Must be called after the positivity check, the remaining types keep their visit order.
+ *
+ * @return roots that are not types of the schema, nothing is removed if there are any
+ */
+std::vector<InternedString> PruneUnreachableTypes(ast::AST &ast, const std::vector<InternedString> &roots);
+
+} // namespace dbuf::ir
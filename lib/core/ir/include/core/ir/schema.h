@@ -0,0 +1,163 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#pragma once
+
+#include "core/ast/ast.h"
+#include "core/ast/expression.h"
+#include "core/interning/interned_string.h"
+#include "core/patterns/decision_tree.h"
+
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+namespace dbuf::ir {
+
+using TypeId           = size_t;
+using SpecializationId = size_t;
+
+struct Field {
+  const ast::TypedVariable *variable;
+  // Position of the field in its type
+  size_t index;
+  // Type of the field, std::nullopt for builtin types
+  std::optional<TypeId> type;
+  // Specialization of the field type, set if some of its parameters are known only at runtime
+  std::optional<SpecializationId> specialization;
+  // Type and specialization of the elements of `Vec T n`, like type and specialization of the field
+  std::optional<TypeId> element_type;
+  std::optional<SpecializationId> element_specialization;
+  // Is the length of `Vec T n` known only at runtime
+  bool runtime_length = false;
+};
+
+struct Constructor {
+  const ast::Constructor *constructor;
+  // Index of the rule in pattern_mapping
+  size_t rule;
+  // Index of the constructor among all constructors of the enum
+  size_t tag;
+  // Name of the struct generated for the constructor in its specialization
+  InternedString name;
+  std::vector<Field> fields;
+};
+
+/**
+ * @brief Type with every dependency classified as known at compile time or only at runtime
+ *
+ * Dependencies known at compile time stay type parameters, the rest become arguments of the runtime check.
+ * Specialization with runtime dependencies is a hidden type, named after the type and its runtime
+ * dependencies, like `Foo_a_b`.
+ *
+ */
+struct Specialization {
+  TypeId type;
+  InternedString name;
+  // Is dependency with the same index known only at runtime
+  std::vector<bool> is_runtime;
+  std::vector<ast::TypedVariable> static_dependencies;
+  std::vector<ast::TypedVariable> runtime_dependencies;
+  // Fields of a message
+  std::vector<Field> fields;
+  // Constructors of an enum, ordered by rule
+  std::vector<Constructor> constructors;
+};
+
+struct Type {
+  TypeId id;
+  InternedString name;
+  std::variant<const ast::Message *, const ast::Enum *> declaration;
+  std::vector<Field> dependencies;
+  // Specialization with all dependencies known at compile time
+  SpecializationId declared;
+  // Rules of an enum compiled into a decision tree
+  std::optional<patterns::DecisionTree> decision_tree;
+
+  [[nodiscard]] bool IsEnum() const;
+  [[nodiscard]] const ast::Message &AsMessage() const;
+  [[nodiscard]] const ast::Enum &AsEnum() const;
+};
+
+/**
+ * @brief Resolved schema shared by all code generators
+ *
+ * Built once after the checks have passed: types are resolved to ids, fields and constructors are numbered,
+ * and all the hidden specializations are collected into a table, so that generators don't need to look
+ * anything up by name or rebuild synthesized names.
+ *
+ */
+class Schema {
+public:
+  /**
+   * @brief Controls how many hidden specializations a type can have
+   *
+   * By default every combination of runtime dependencies of a type is a separate hidden type, like `Foo_a` and
+   * `Foo_a_b`, which grows exponentially with the number of dependencies. A merged type has at most one hidden type,
+   * with all its dependencies checked at runtime, that is used whenever any of them is known only at runtime.
+   *
+   */
+  struct Options {
+    // All types are merged
+    bool merge_specializations = false;
+    // Types that are merged even if merge_specializations is false
+    std::unordered_set<InternedString> merged_types = {};
+  };
+
+  explicit Schema(const ast::AST &tree);
+  Schema(const ast::AST &tree, Options options);
+
+  [[nodiscard]] const ast::AST &GetAST() const;
+
+  /**
+   * @brief Returns types in the order of ast::AST::visit_order
+   *
+   */
+  [[nodiscard]] const std::vector<Type> &GetTypes() const;
+  [[nodiscard]] const Type &GetType(TypeId id) const;
+  [[nodiscard]] std::optional<TypeId> FindType(const InternedString &name) const;
+
+  [[nodiscard]] const Type &GetConstructorType(const InternedString &constructor) const;
+
+  [[nodiscard]] const std::vector<Specialization> &GetSpecializations() const;
+  [[nodiscard]] const Specialization &GetSpecialization(SpecializationId id) const;
+
+  /**
+   * @brief Number of specializations with runtime dependencies
+   *
+   */
+  [[nodiscard]] size_t GetHiddenSpecializationsCount() const;
+
+private:
+  std::vector<Field> LowerFields(
+      const std::vector<ast::TypedVariable> &variables,
+      std::unordered_set<InternedString> runtime_names);
+
+  // Hidden specialization of the type, if some of the parameters use the runtime names
+  std::optional<SpecializationId> SpecializeParameters(
+      TypeId type,
+      const ast::TypeExpression &type_expression,
+      const std::unordered_set<InternedString> &runtime_names);
+
+  SpecializationId Specialize(TypeId type, const std::vector<bool> &is_runtime);
+
+  const ast::AST *tree_;
+  Options options_;
+  std::vector<Type> types_;
+  std::unordered_map<InternedString, TypeId> type_ids_;
+  std::unordered_map<InternedString, TypeId> constructor_types_;
+  std::vector<Specialization> specializations_;
+  std::unordered_map<InternedString, SpecializationId> specialization_ids_;
+};
+
+} // namespace dbuf::ir
@@ -0,0 +1,127 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#include "core/ir/reachability.h"
+
+#include "glog/logging.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <variant>
+
+namespace dbuf::ir {
+
+namespace {
+
+void CollectTypes(const ast::Expression &expr, const ast::AST &ast, std::set<InternedString> &types);
+
+void CollectTypes(const ast::Value &value, const ast::AST &ast, std::set<InternedString> &types) {
+  if (!std::holds_alternative<ast::ConstructedValue>(value)) {
+    return;
+  }
+  const auto &constructed_value = std::get<ast::ConstructedValue>(value);
+  auto iter                     = ast.constructor_to_type.find(constructed_value.constructor_identifier.name);
+  if (iter != ast.constructor_to_type.end()) {
+    types.insert(iter->second);
+  }
+  for (const auto &[_, field] : constructed_value.fields) {
+    CollectTypes(*field, ast, types);
+  }
+}
+
+void CollectTypes(const ast::TypeExpression &type_expression, const ast::AST &ast, std::set<InternedString> &types) {
+  types.insert(type_expression.identifier.name);
+  for (const auto &parameter : type_expression.parameters) {
+    CollectTypes(*parameter, ast, types);
+  }
+}
+
+void CollectTypes(const ast::Expression &expr, const ast::AST &ast, std::set<InternedString> &types) {
+  if (std::holds_alternative<ast::BinaryExpression>(expr)) {
+    CollectTypes(*std::get<ast::BinaryExpression>(expr).left, ast, types);
+    CollectTypes(*std::get<ast::BinaryExpression>(expr).right, ast, types);
+  } else if (std::holds_alternative<ast::UnaryExpression>(expr)) {
+    CollectTypes(*std::get<ast::UnaryExpression>(expr).expression, ast, types);
+  } else if (std::holds_alternative<ast::TypeExpression>(expr)) {
+    CollectTypes(std::get<ast::TypeExpression>(expr), ast, types);
+  } else if (std::holds_alternative<ast::Value>(expr)) {
+    CollectTypes(std::get<ast::Value>(expr), ast, types);
+  }
+}
+
+} // namespace
+
+std::set<InternedString> GetUsedTypes(const ast::Message &message, const ast::AST &ast) {
+  std::set<InternedString> types;
+  for (const auto &dependency : message.type_dependencies) {
+    CollectTypes(dependency.type_expression, ast, types);
+  }
+  for (const auto &field : message.fields) {
+    CollectTypes(field.type_expression, ast, types);
+  }
+  return types;
+}
+
+std::set<InternedString> GetUsedTypes(const ast::Enum &ast_enum, const ast::AST &ast) {
+  std::set<InternedString> types;
+  for (const auto &dependency : ast_enum.type_dependencies) {
+    CollectTypes(dependency.type_expression, ast, types);
+  }
+  for (const auto &rule : ast_enum.pattern_mapping) {
+    for (const auto &input : rule.inputs) {
+      if (std::holds_alternative<ast::Value>(input)) {
+        CollectTypes(std::get<ast::Value>(input), ast, types);
+      }
+    }
+    for (const auto &constructor : rule.outputs) {
+      for (const auto &field : constructor.fields) {
+        CollectTypes(field.type_expression, ast, types);
+      }
+    }
+  }
+  return types;
+}
+
+std::vector<InternedString> PruneUnreachableTypes(ast::AST &ast, const std::vector<InternedString> &roots) {
+  std::vector<InternedString> unknown_roots;
+  for (const auto &root : roots) {
+    if (!ast.types.contains(root)) {
+      unknown_roots.push_back(root);
+    }
+  }
+  if (!unknown_roots.empty()) {
+    return unknown_roots;
+  }
+
+  std::unordered_set<InternedString> reachable(roots.begin(), roots.end());
+  std::vector<InternedString> stack(roots.begin(), roots.end());
+  while (!stack.empty()) {
+    const InternedString name = stack.back();
+    stack.pop_back();
+    const auto used_types =
+        std::visit([&ast](const auto &type) { return GetUsedTypes(type, ast); }, ast.types.at(name));
+    for (const auto &used_type : used_types) {
+      // Builtin types are not in the AST
+      if (ast.types.contains(used_type) && reachable.insert(used_type).second) {
+        stack.push_back(used_type);
+      }
+    }
+  }
+
+  std::erase_if(ast.visit_order, [&reachable](const InternedString &name) { return !reachable.contains(name); });
+  std::erase_if(ast.types, [&reachable](const auto &type) { return !reachable.contains(type.first); });
+  std::erase_if(ast.constructor_to_type, [&reachable](const auto &constructor) {
+    return !reachable.contains(constructor.second);
+  });
+  DLOG(INFO) << "Kept " << ast.visit_order.size() << " types reachable from " << roots.size() << " roots";
+  return {};
+}
+
+} // namespace dbuf::ir
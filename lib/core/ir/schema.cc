@@ -0,0 +1,274 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#include "core/ir/schema.h"
+
+#include "core/ast/builtin_types.h"
+#include "glog/logging.h"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace dbuf::ir {
+
+namespace {
+
+// Returns true if the expression uses one of the names
+bool DependsOn(const std::unordered_set<InternedString> &names, const ast::Expression &expr) {
+  if (std::holds_alternative<ast::BinaryExpression>(expr)) {
+    const auto &binary = std::get<ast::BinaryExpression>(expr);
+    return DependsOn(names, *binary.left) || DependsOn(names, *binary.right);
+  }
+  if (std::holds_alternative<ast::UnaryExpression>(expr)) {
+    return DependsOn(names, *std::get<ast::UnaryExpression>(expr).expression);
+  }
+  if (std::holds_alternative<ast::VarAccess>(expr)) {
+    return names.contains(std::get<ast::VarAccess>(expr).var_identifier.name);
+  }
+  if (std::holds_alternative<ast::Value>(expr)) {
+    const auto &value = std::get<ast::Value>(expr);
+    if (std::holds_alternative<ast::ConstructedValue>(value)) {
+      for (const auto &[_, field] : std::get<ast::ConstructedValue>(value).fields) {
+        if (DependsOn(names, *field)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+bool Type::IsEnum() const {
+  return std::holds_alternative<const ast::Enum *>(declaration);
+}
+
+const ast::Message &Type::AsMessage() const {
+  return *std::get<const ast::Message *>(declaration);
+}
+
+const ast::Enum &Type::AsEnum() const {
+  return *std::get<const ast::Enum *>(declaration);
+}
+
+Schema::Schema(const ast::AST &tree)
+    : Schema(tree, Options {}) {}
+
+Schema::Schema(const ast::AST &tree, Options options)
+    : tree_(&tree)
+    , options_(std::move(options)) {
+  types_.reserve(tree.visit_order.size());
+  for (const auto &name : tree.visit_order) {
+    Type type;
+    type.id   = types_.size();
+    type.name = name;
+    std::visit([&type](const auto &declaration) { type.declaration = &declaration; }, tree.types.at(name));
+    // Messages are constructed by their own names
+    if (type.IsEnum()) {
+      type.decision_tree.emplace(type.AsEnum());
+      for (const auto &rule : type.AsEnum().pattern_mapping) {
+        for (const auto &constructor : rule.outputs) {
+          constructor_types_.emplace(constructor.identifier.name, type.id);
+        }
+      }
+    } else {
+      constructor_types_.emplace(name, type.id);
+    }
+    type_ids_.emplace(name, type.id);
+    types_.emplace_back(std::move(type));
+  }
+
+  // Fields are resolved once all the types have ids
+  for (auto &type : types_) {
+    const auto &dependencies = type.IsEnum() ? type.AsEnum().type_dependencies : type.AsMessage().type_dependencies;
+    // Dependencies are never specialized, they are passed as they are
+    type.dependencies.reserve(dependencies.size());
+    for (size_t index = 0; index < dependencies.size(); ++index) {
+      const auto &dependency = dependencies[index];
+      type.dependencies.emplace_back(Field {
+          &dependency,
+          index,
+          FindType(dependency.type_expression.identifier.name),
+          std::nullopt,
+          std::nullopt,
+          std::nullopt,
+          false});
+    }
+  }
+  for (auto &type : types_) {
+    type.declared = Specialize(type.id, std::vector<bool>(type.dependencies.size(), false));
+  }
+
+  DLOG(INFO) << "Lowered " << types_.size() << " types into " << specializations_.size() << " specializations";
+}
+
+const ast::AST &Schema::GetAST() const {
+  return *tree_;
+}
+
+const std::vector<Type> &Schema::GetTypes() const {
+  return types_;
+}
+
+const Type &Schema::GetType(TypeId id) const {
+  return types_[id];
+}
+
+std::optional<TypeId> Schema::FindType(const InternedString &name) const {
+  auto it = type_ids_.find(name);
+  if (it == type_ids_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+const Type &Schema::GetConstructorType(const InternedString &constructor) const {
+  return types_[constructor_types_.at(constructor)];
+}
+
+const std::vector<Specialization> &Schema::GetSpecializations() const {
+  return specializations_;
+}
+
+const Specialization &Schema::GetSpecialization(SpecializationId id) const {
+  return specializations_[id];
+}
+
+size_t Schema::GetHiddenSpecializationsCount() const {
+  return specializations_.size() - types_.size();
+}
+
+std::vector<Field> Schema::LowerFields(
+    const std::vector<ast::TypedVariable> &variables,
+    std::unordered_set<InternedString> runtime_names) {
+  std::vector<Field> fields;
+  fields.reserve(variables.size());
+  for (size_t index = 0; index < variables.size(); ++index) {
+    const auto &variable        = variables[index];
+    const auto &type_expression = variable.type_expression;
+    Field field {
+        &variable,
+        index,
+        FindType(type_expression.identifier.name),
+        std::nullopt,
+        std::nullopt,
+        std::nullopt,
+        false};
+    if (field.type) {
+      field.specialization = SpecializeParameters(*field.type, type_expression, runtime_names);
+    }
+
+    // Elements of a sequence are specialized like a field, the length is only checked
+    if (ast::IsVecType(type_expression.identifier.name) && type_expression.parameters.size() == 2) {
+      const auto &element = std::get<ast::TypeExpression>(*type_expression.parameters[0]);
+      field.element_type  = FindType(element.identifier.name);
+      if (field.element_type) {
+        field.element_specialization = SpecializeParameters(*field.element_type, element, runtime_names);
+      }
+      field.runtime_length = DependsOn(runtime_names, *type_expression.parameters[1]);
+    }
+
+    // Fields are known only at runtime for the following fields
+    runtime_names.insert(variable.name);
+    fields.emplace_back(field);
+  }
+  return fields;
+}
+
+std::optional<SpecializationId> Schema::SpecializeParameters(
+    TypeId type,
+    const ast::TypeExpression &type_expression,
+    const std::unordered_set<InternedString> &runtime_names) {
+  // Parameters that use a runtime value make the type a hidden specialization
+  const auto &parameters = type_expression.parameters;
+  std::vector<bool> is_runtime(parameters.size(), false);
+  bool has_runtime = false;
+  for (size_t ind = 0; ind < parameters.size(); ++ind) {
+    is_runtime[ind] = DependsOn(runtime_names, *parameters[ind]);
+    has_runtime |= is_runtime[ind];
+  }
+  if (!has_runtime) {
+    return std::nullopt;
+  }
+  // Merged types pass all the dependencies to the runtime check, so they have a single hidden type
+  const auto &type_name = types_[type].name;
+  if (options_.merge_specializations || options_.merged_types.contains(type_name)) {
+    is_runtime.assign(is_runtime.size(), true);
+  }
+  return Specialize(type, is_runtime);
+}
+
+SpecializationId Schema::Specialize(TypeId type_id, const std::vector<bool> &is_runtime) {
+  const Type &type         = types_[type_id];
+  const auto &dependencies = type.IsEnum() ? type.AsEnum().type_dependencies : type.AsMessage().type_dependencies;
+
+  Specialization specialization;
+  specialization.type       = type_id;
+  specialization.is_runtime = is_runtime;
+  std::string name          = type.name.GetString();
+  std::string suffix;
+  std::unordered_set<InternedString> runtime_names;
+  for (size_t ind = 0; ind < dependencies.size(); ++ind) {
+    if (is_runtime[ind]) {
+      suffix += "_" + dependencies[ind].name.GetString();
+      specialization.runtime_dependencies.emplace_back(dependencies[ind]);
+      runtime_names.insert(dependencies[ind].name);
+    } else {
+      specialization.static_dependencies.emplace_back(dependencies[ind]);
+    }
+  }
+  specialization.name = InternedString(name + suffix);
+
+  auto it = specialization_ids_.find(specialization.name);
+  if (it != specialization_ids_.end()) {
+    return it->second;
+  }
+
+  // Registered before the fields are lowered, so that recursive types refer to themselves
+  const SpecializationId id = specializations_.size();
+  specialization_ids_.emplace(specialization.name, id);
+  specializations_.emplace_back(std::move(specialization));
+
+  std::vector<Field> fields;
+  std::vector<Constructor> constructors;
+  if (type.IsEnum()) {
+    const auto &pattern_mapping = type.AsEnum().pattern_mapping;
+    for (size_t rule = 0; rule < pattern_mapping.size(); ++rule) {
+      for (const auto &constructor : pattern_mapping[rule].outputs) {
+        InternedString constructor_name = constructor.identifier.name;
+        if (!suffix.empty()) {
+          constructor_name =
+              InternedString(constructor.identifier.name.GetString() + "_" + std::to_string(rule + 1) + suffix);
+        }
+        constructors.emplace_back(Constructor {
+            &constructor,
+            rule,
+            constructors.size(),
+            constructor_name,
+            LowerFields(constructor.fields, runtime_names)});
+      }
+    }
+  } else {
+    fields = LowerFields(type.AsMessage().fields, runtime_names);
+  }
+
+  // Lowering may have added specializations, so the reference is taken only now
+  specializations_[id].fields       = std::move(fields);
+  specializations_[id].constructors = std::move(constructors);
+  return id;
+}
+
+} // namespace dbuf::ir
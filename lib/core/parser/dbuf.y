@@ -24,6 +24,10 @@ the Free Software Foundation, either version 3 of the License, or
   #include "core/ast/ast.h"
   #include "core/ast/expression.h"
 
+  #include <sstream>
+  #include <string>
+  #include <vector>
+
   namespace dbuf::ast {
     class AST;
   }
@@ -41,16 +45,19 @@ namespace dbuf::parser {
 
   class DbufParser : public Parser {
   public:
-    DbufParser(Lexer *scanner, dbuf::ast::AST *ast) : Parser(scanner, ast), error_cnt_(0) {}
+    DbufParser(Lexer *scanner, dbuf::ast::AST *ast) : Parser(scanner, ast) {}
 
     void error(const location_type &l, const std::string &err_message) override {
-      std::cerr << "Error: " << err_message << " at " << l << std::endl;
-      error_cnt_++;
+      std::ostringstream message;
+      message << "Error: " << err_message << " at " << l;
+      errors_.push_back(message.str());
     }
 
-    size_t GetErrorCnt() const { return error_cnt_; }
+    size_t GetErrorCnt() const { return errors_.size(); }
+
+    const std::vector<std::string> &GetErrors() const { return errors_; }
   private:
-    size_t error_cnt_ = 0;
+    std::vector<std::string> errors_;
   };
 
 }
@@ -102,6 +109,8 @@ namespace dbuf::parser {
   RIGHT_PAREN ")"
   LEFT_BRACE "{"
   RIGHT_BRACE "}"
+  LEFT_BRACKET "["
+  RIGHT_BRACKET "]"
 ;
 %token
   COMMA ","
@@ -260,6 +269,33 @@ field_declarations
     $$ = std::move($1);
     $$.emplace_back(std::move($2));
   }
+  | field_declarations typed_variable "[" field_annotations "]" SEMICOLON {
+    $$ = std::move($1);
+    $2.annotations = std::move($4);
+    $$.emplace_back(std::move($2));
+  }
+  ;
+
+%nterm <std::vector<ast::Identifier>> field_annotations;
+field_annotations
+  : field_annotation {
+    $$ = std::vector<ast::Identifier>();
+    $$.emplace_back(std::move($1));
+  }
+  | field_annotations "," field_annotation {
+    $$ = std::move($1);
+    $$.emplace_back(std::move($3));
+  }
+  ;
+
+%nterm <ast::Identifier> field_annotation;
+field_annotation
+  : LC_IDENTIFIER {
+    if ($1 != ast::kColdAnnotation) {
+      throw syntax_error(@1, "Unknown field annotation: " + $1);
+    }
+    $$ = ast::Identifier{{@1}, {InternedString(std::move($1))}};
+  }
   ;
 
 %nterm <ast::TypeExpression> type_expr;
@@ -271,6 +307,10 @@ type_expr
     $$ = std::move($1);
     $$.parameters.emplace_back(std::move($2));
   }
+  | type_expr type_identifier {
+    $$ = std::move($1);
+    $$.parameters.emplace_back(std::make_shared<const ast::Expression>(ast::TypeExpression{{@2}, {$2}}));
+  }
   ;
 
 %nterm <ExprPtr> expression;
@@ -11,6 +11,9 @@ the Free Software Foundation, either version 3 of the License, or
 #include "core/parser/lexer.h"
 #include "dbuf.tab.hpp"
 
+#include <string>
+#include <vector>
+
 namespace dbuf::parser {
 
 class ParseHelper {
@@ -21,6 +24,12 @@ public:
 
   void Parse();
 
+  /**
+   * @brief Syntax errors reported by the parser, it recovers from some of them and continues
+   *
+   */
+  [[nodiscard]] const std::vector<std::string> &GetErrors() const;
+
 private:
   Lexer lexer_;
   DbufParser parser_;
@@ -18,4 +18,8 @@ void ParseHelper::Parse() {
     throw "Parse failed!";
   }
 }
+
+const std::vector<std::string> &ParseHelper::GetErrors() const {
+  return parser_.GetErrors();
+}
 } // namespace dbuf::parser
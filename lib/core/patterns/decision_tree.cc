@@ -0,0 +1,192 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#include "core/patterns/decision_tree.h"
+
+#include "glog/logging.h"
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace dbuf::patterns {
+
+Key GetKey(const ast::Value &value) {
+  return std::visit(
+      [](const auto &val) -> Key {
+        if constexpr (std::is_same_v<std::decay_t<decltype(val)>, ast::ConstructedValue>) {
+          return val.constructor_identifier.name;
+        } else {
+          return val.value;
+        }
+      },
+      value);
+}
+
+struct DecisionTree::Builder {
+  using Rows    = std::vector<size_t>;
+  using Columns = std::vector<bool>;
+
+  const ast::Enum &ast_enum;
+  std::vector<Node> &nodes;
+  // Subtrees already built for the given rows and inspected dependencies
+  std::map<std::pair<Rows, Columns>, size_t> built = {};
+
+  // Pattern of the rule for the dependency, nullptr for stars
+  [[nodiscard]] const ast::Value *GetPattern(size_t row, size_t column) const {
+    const auto &inputs = ast_enum.pattern_mapping[row].inputs;
+    if (column >= inputs.size() || std::holds_alternative<ast::Star>(inputs[column])) {
+      return nullptr;
+    }
+    return &std::get<ast::Value>(inputs[column]);
+  }
+
+  // Constructed values with nested patterns are not fully checked by comparing constructors
+  static bool IsDecidedByKey(const ast::Value &pattern) {
+    if (!std::holds_alternative<ast::ConstructedValue>(pattern)) {
+      return true;
+    }
+    for (const auto &[_, field] : std::get<ast::ConstructedValue>(pattern).fields) {
+      if (!std::holds_alternative<ast::VarAccess>(*field)) {
+        return false;
+      }
+      if (!std::get<ast::VarAccess>(*field).field_identifiers.empty()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  [[nodiscard]] bool IsDecided(size_t row, const Columns &inspected) const {
+    for (size_t column = 0; column < inspected.size(); ++column) {
+      const ast::Value *pattern = GetPattern(row, column);
+      if (pattern != nullptr && (!inspected[column] || !IsDecidedByKey(*pattern))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_t Build(const Rows &rows, const Columns &inspected) {
+    // Rules after the one that surely matches are unreachable
+    Rows reachable;
+    for (size_t row : rows) {
+      reachable.push_back(row);
+      if (IsDecided(row, inspected)) {
+        break;
+      }
+    }
+
+    auto it = built.find({reachable, inspected});
+    if (it != built.end()) {
+      return it->second;
+    }
+    size_t id = BuildNode(reachable, inspected);
+    built.emplace(std::make_pair(std::move(reachable), inspected), id);
+    return id;
+  }
+
+  size_t BuildNode(const Rows &rows, const Columns &inspected) {
+    // We switch on the first dependency that the first rule needs and that is not known yet
+    std::optional<size_t> column;
+    if (!rows.empty()) {
+      for (size_t id = 0; id < inspected.size(); ++id) {
+        if (!inspected[id] && GetPattern(rows.front(), id) != nullptr) {
+          column = id;
+          break;
+        }
+      }
+    }
+
+    if (!column) {
+      nodes.emplace_back(Leaf {rows});
+      return nodes.size() - 1;
+    }
+
+    Columns next_inspected  = inspected;
+    next_inspected[*column] = true;
+
+    Rows fallback_rows;
+    for (size_t row : rows) {
+      if (GetPattern(row, *column) == nullptr) {
+        fallback_rows.push_back(row);
+      }
+    }
+
+    Switch node_switch;
+    node_switch.input    = *column;
+    node_switch.fallback = Build(fallback_rows, next_inspected);
+    std::map<Key, const ast::Value *> keys;
+    for (size_t row : rows) {
+      const ast::Value *pattern = GetPattern(row, *column);
+      if (pattern != nullptr) {
+        keys.emplace(GetKey(*pattern), pattern);
+      }
+    }
+
+    // Rules with a star match every value, so they are kept in every case
+    for (const auto &[key, value] : keys) {
+      Rows case_rows;
+      for (size_t row : rows) {
+        const ast::Value *pattern = GetPattern(row, *column);
+        if (pattern == nullptr || GetKey(*pattern) == key) {
+          case_rows.push_back(row);
+        }
+      }
+      size_t next = Build(case_rows, next_inspected);
+      // Cases that lead to the same subtree as other values are not needed
+      if (next != node_switch.fallback) {
+        node_switch.cases.push_back(Case {key, *value, next});
+      }
+    }
+
+    if (node_switch.cases.empty()) {
+      return node_switch.fallback;
+    }
+    nodes.emplace_back(std::move(node_switch));
+    return nodes.size() - 1;
+  }
+};
+
+DecisionTree::DecisionTree(const ast::Enum &ast_enum) {
+  std::vector<size_t> rows(ast_enum.pattern_mapping.size());
+  for (size_t id = 0; id < rows.size(); ++id) {
+    rows[id] = id;
+    for (const auto &input : ast_enum.pattern_mapping[id].inputs) {
+      if (std::holds_alternative<ast::Value>(input) &&
+          std::holds_alternative<ast::ConstructedValue>(std::get<ast::Value>(input))) {
+        is_scalar_ = false;
+      }
+    }
+  }
+
+  Builder builder {ast_enum, nodes_};
+  root_ = builder.Build(rows, std::vector<bool>(ast_enum.type_dependencies.size(), false));
+  DLOG(INFO) << "Compiled " << ast_enum.pattern_mapping.size() << " rules of enum " << ast_enum.identifier.name
+             << " into " << nodes_.size() << " nodes";
+}
+
+const DecisionTree::Node &DecisionTree::GetRoot() const {
+  return nodes_[root_];
+}
+
+const DecisionTree::Node &DecisionTree::GetNode(size_t id) const {
+  return nodes_[id];
+}
+
+bool DecisionTree::IsScalar() const {
+  return is_scalar_;
+}
+
+} // namespace dbuf::patterns
@@ -0,0 +1,118 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#pragma once
+
+#include "core/ast/ast.h"
+#include "core/ast/expression.h"
+#include "core/interning/interned_string.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace dbuf::patterns {
+
+/**
+ * @brief Value a decision tree switches on: a scalar literal or a constructor name
+ *
+ */
+using Key = std::variant<bool, int64_t, uint64_t, double, std::string, InternedString>;
+
+/**
+ * @brief Key of a value, constructed values are identified by their constructor
+ *
+ */
+Key GetKey(const ast::Value &value);
+
+/**
+ * @brief Enum rules compiled into a decision tree
+ *
+ * Every inner node switches on the value of one dependency and every leaf holds the rules that may match
+ * once the dependencies on its path are known, in their original order. A leaf holds a single rule unless
+ * some patterns are constructed values with nested patterns, which are not inspected by the tree. Identical
+ * subtrees are shared, so the tree is stored as a DAG of nodes.
+ *
+ */
+class DecisionTree {
+public:
+  struct Leaf {
+    // Indexes of rules in pattern_mapping, empty if no rule matches
+    std::vector<size_t> rules;
+  };
+
+  struct Case {
+    Key key;
+    // Pattern the key was taken from
+    ast::Value value;
+    size_t next;
+  };
+
+  struct Switch {
+    // Index of the inspected dependency
+    size_t input;
+    // Cases sorted by key
+    std::vector<Case> cases;
+    // Node for values that are not listed in cases
+    size_t fallback;
+  };
+
+  using Node = std::variant<Leaf, Switch>;
+
+  explicit DecisionTree(const ast::Enum &ast_enum);
+
+  [[nodiscard]] const Node &GetRoot() const;
+  [[nodiscard]] const Node &GetNode(size_t id) const;
+
+  /**
+   * @brief Returns true if all the patterns are stars or scalar literals
+   *
+   */
+  [[nodiscard]] bool IsScalar() const;
+
+  /**
+   * @brief Finds the leaf for the given dependencies
+   *
+   * @param get_key returns the key of the dependency with the given index or std::nullopt if it is unknown
+   * @return the leaf or nullptr if the tree needs a dependency that is unknown
+   */
+  template <typename F>
+  [[nodiscard]] const Leaf *Select(F get_key) const {
+    const Node *node = &GetRoot();
+    while (std::holds_alternative<Switch>(*node)) {
+      const auto &node_switch      = std::get<Switch>(*node);
+      const std::optional<Key> key = get_key(node_switch.input);
+      if (!key) {
+        return nullptr;
+      }
+      auto it = std::lower_bound(
+          node_switch.cases.begin(),
+          node_switch.cases.end(),
+          *key,
+          [](const Case &lhs, const Key &rhs) { return lhs.key < rhs; });
+      node = &GetNode((it != node_switch.cases.end() && it->key == *key) ? it->next : node_switch.fallback);
+    }
+    return &std::get<Leaf>(*node);
+  }
+
+private:
+  struct Builder;
+
+  std::vector<Node> nodes_;
+  size_t root_    = 0;
+  bool is_scalar_ = true;
+};
+
+} // namespace dbuf::patterns
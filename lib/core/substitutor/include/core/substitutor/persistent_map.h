@@ -0,0 +1,163 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace dbuf {
+
+/**
+ * @brief Immutable hash map implemented as a hash array mapped trie
+ *
+ * Insertion returns a new map and leaves the old one untouched. Both maps share every node that was not on the
+ * path to the inserted key, so copying a map is O(1) and insertion and lookup take O(log32 n).
+ *
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class PersistentMap {
+public:
+  [[nodiscard]] const Value *Find(const Key &key) const {
+    const size_t hash = Hash()(key);
+    const Node *node  = root_.get();
+    for (size_t shift = 0; node != nullptr; shift += kBitsPerLevel) {
+      if (shift >= kHashBits) {
+        return FindCollision(*node, key);
+      }
+      const uint32_t bit = Bit(hash, shift);
+      if ((node->bitmap & bit) == 0) {
+        return nullptr;
+      }
+      const Slot &slot = node->slots[Position(node->bitmap, bit)];
+      if (std::holds_alternative<Entry>(slot)) {
+        const auto &entry = std::get<Entry>(slot);
+        return (entry.hash == hash && entry.key == key) ? &entry.value : nullptr;
+      }
+      node = std::get<NodePtr>(slot).get();
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief Returns the map with key bound to value, the previous binding of key is replaced
+   *
+   */
+  [[nodiscard]] PersistentMap Insert(const Key &key, Value value) const {
+    PersistentMap res;
+    bool added = false;
+    res.root_  = Insert(root_.get(), 0, Entry {Hash()(key), key, std::move(value)}, &added);
+    res.size_  = size_ + (added ? 1 : 0);
+    return res;
+  }
+
+  [[nodiscard]] size_t Size() const {
+    return size_;
+  }
+
+  [[nodiscard]] bool Empty() const {
+    return size_ == 0;
+  }
+
+private:
+  static constexpr size_t kBitsPerLevel = 5;
+  static constexpr size_t kHashBits     = 8 * sizeof(size_t);
+
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+
+  struct Entry {
+    size_t hash;
+    Key key;
+    Value value;
+  };
+
+  using Slot = std::variant<Entry, NodePtr>;
+
+  // Slots are stored densely in the order of their bits in the bitmap. Nodes below the last level have no
+  // hash bits left, so they store colliding entries as a plain list and do not use the bitmap
+  struct Node {
+    uint32_t bitmap = 0;
+    std::vector<Slot> slots;
+  };
+
+  static uint32_t Bit(size_t hash, size_t shift) {
+    return uint32_t {1} << ((hash >> shift) & ((1U << kBitsPerLevel) - 1));
+  }
+
+  static size_t Position(uint32_t bitmap, uint32_t bit) {
+    return std::popcount(bitmap & (bit - 1));
+  }
+
+  static const Value *FindCollision(const Node &node, const Key &key) {
+    for (const auto &slot : node.slots) {
+      const auto &entry = std::get<Entry>(slot);
+      if (entry.key == key) {
+        return &entry.value;
+      }
+    }
+    return nullptr;
+  }
+
+  // Copies the path from node to the entry position, the rest of the trie is shared
+  static NodePtr Insert(const Node *node, size_t shift, Entry entry, bool *added) {
+    auto res = (node != nullptr) ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+
+    if (shift >= kHashBits) {
+      for (auto &slot : res->slots) {
+        if (std::get<Entry>(slot).key == entry.key) {
+          slot = std::move(entry);
+          return res;
+        }
+      }
+      res->slots.emplace_back(std::move(entry));
+      *added = true;
+      return res;
+    }
+
+    const uint32_t bit = Bit(entry.hash, shift);
+    const auto pos     = static_cast<std::ptrdiff_t>(Position(res->bitmap, bit));
+    if ((res->bitmap & bit) == 0) {
+      res->bitmap |= bit;
+      res->slots.emplace(res->slots.begin() + pos, std::move(entry));
+      *added = true;
+      return res;
+    }
+
+    Slot &slot = res->slots[pos];
+    if (std::holds_alternative<NodePtr>(slot)) {
+      slot = Insert(std::get<NodePtr>(slot).get(), shift + kBitsPerLevel, std::move(entry), added);
+      return res;
+    }
+
+    auto &existing = std::get<Entry>(slot);
+    if (existing.hash == entry.hash && existing.key == entry.key) {
+      existing.value = std::move(entry.value);
+      return res;
+    }
+
+    // Two different keys share this position, so we move both of them one level down
+    bool moved    = false;
+    NodePtr child = Insert(nullptr, shift + kBitsPerLevel, std::move(existing), &moved);
+    slot          = Insert(child.get(), shift + kBitsPerLevel, std::move(entry), added);
+    return res;
+  }
+
+  NodePtr root_;
+  size_t size_ = 0;
+};
+
+} // namespace dbuf
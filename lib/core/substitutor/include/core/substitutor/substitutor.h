@@ -13,56 +13,123 @@ the Free Software Foundation, either version 3 of the License, or
 #include "core/ast/ast.h"
 #include "core/ast/expression.h"
 #include "core/interning/interned_string.h"
+#include "core/substitutor/persistent_map.h"
 #include "glog/logging.h"
 
-#include <deque>
+#include <cstddef>
 #include <memory>
+#include <ostream>
 #include <stdexcept>
-#include <unordered_map>
 #include <variant>
 #include <vector>
 
 namespace dbuf {
 
+/**
+ * @brief Substitutes variables in expressions with the expressions bound to them
+ *
+ * Substitutions are explicit: every bound expression is stored together with the environment it was added in and
+ * is substituted only when some variable actually refers to it. Results of substitution share every subtree that
+ * was left unchanged with the original expression.
+ *
+ * Environments are persistent maps, so saving and restoring them (and therefore pushing and popping scopes) is O(1)
+ * and lookup does not depend on the number of scopes.
+ *
+ */
 struct Substitutor {
-  void AddSubstitution(InternedString name, const std::shared_ptr<const ast::Expression> &expression);
-  void PushScope();
-  void PopScope();
+  using ExpressionPtr = std::shared_ptr<const ast::Expression>;
+
+private:
+  struct Binding;
+  using Environment = PersistentMap<InternedString, std::shared_ptr<const Binding>>;
 
-  template <typename T>
-  ast::Expression operator()(const ast::ScalarValue<T> &value) {
-    return ast::ScalarValue<T>(value);
-  }
+  /**
+   * @brief Expression bound to a name. It is substituted in the bindings that were added before it
+   *
+   */
+  struct Binding {
+    InternedString name;
+    ExpressionPtr expression;
+    // Bindings visible when this one was added
+    Environment environment;
+    // Result of the substitution, filled on the first lookup
+    mutable ExpressionPtr forced = nullptr;
+  };
 
-  ast::Expression operator()(const ast::BinaryExpression &expression);
-  ast::Expression operator()(const ast::UnaryExpression &expression);
+public:
+  /**
+   * @brief Saved set of substitutions
+   *
+   */
+  using Snapshot = Environment;
 
-  ast::Expression operator()(const ast::VarAccess &value, const ast::ConstructedValue &substitution);
-  ast::Expression operator()(const ast::VarAccess &value, const ast::VarAccess &substitution);
-  template <typename T>
-  ast::Expression operator()(const ast::VarAccess &value, const ast::ScalarValue<T> &substitution) {
-    DCHECK(value.field_identifiers.empty()) << "Field access on scalar value";
-    return substitution;
-  }
-  ast::Expression operator()(const ast::VarAccess &value, const ast::Value &substitution) {
-    return std::visit(*this, ast::Expression(value), substitution);
-  }
-  template <typename T, typename U>
-  ast::Expression operator()(const T &, const U &) {
-    throw std::runtime_error("Substitution error");
-  }
+  /**
+   * @brief Type expression paired with the substitution environment it has to be read in
+   *
+   * The identifier is available right away, parameters are substituted one by one when they are requested
+   *
+   */
+  class LazyTypeExpression {
+  public:
+    /**
+     * @brief Wraps type expression that needs no substitution
+     *
+     * @param type_expression should outlive the wrapper
+     */
+    explicit LazyTypeExpression(const ast::TypeExpression &type_expression);
 
-  ast::Expression operator()(const ast::VarAccess &value);
+    [[nodiscard]] const ast::Identifier &GetIdentifier() const;
+    [[nodiscard]] size_t GetParametersCount() const;
+    [[nodiscard]] const ExpressionPtr &GetParameter(size_t id) const;
 
-  ast::Expression operator()(const ast::ConstructedValue &value);
+    /**
+     * @brief Substitutes all parameters and builds the resulting type expression
+     *
+     */
+    [[nodiscard]] ast::TypeExpression Force() const;
 
-  ast::Expression operator()(const ast::Value &value);
+  private:
+    friend struct Substitutor;
 
-  ast::Expression operator()(const ast::TypeExpression &type_expression);
+    LazyTypeExpression(const ast::TypeExpression &type_expression, Environment environment);
+
+    const ast::TypeExpression *type_expression_;
+    Environment environment_;
+    mutable std::vector<ExpressionPtr> parameters_;
+  };
+
+  void AddSubstitution(InternedString name, const ExpressionPtr &expression);
+  void PushScope();
+  void PopScope();
+
+  /**
+   * @brief Saves current substitutions, so they can be restored after a speculative match
+   *
+   */
+  [[nodiscard]] Snapshot Save() const;
+  void Restore(Snapshot snapshot);
+
+  /**
+   * @brief Pairs type expression with the current substitutions without substituting anything
+   *
+   * @param type_expression should outlive the result
+   */
+  [[nodiscard]] LazyTypeExpression Lazy(const ast::TypeExpression &type_expression) const;
+
+  ExpressionPtr operator()(const ExpressionPtr &expression) const;
+
+  ast::Expression operator()(const ast::TypeExpression &type_expression) const;
 
 private:
-  using Scope = std::unordered_map<InternedString, std::shared_ptr<const ast::Expression>>;
-  std::deque<Scope> substitute_;
+  struct Visitor;
+
+  static ExpressionPtr Substitute(const ExpressionPtr &expression, const Environment &environment);
+  static const ExpressionPtr &Force(const Binding &binding);
+
+  Environment environment_;
+  std::vector<Environment> scopes_;
 };
 
+std::ostream &operator<<(std::ostream &os, const Substitutor::LazyTypeExpression &expr);
+
 } // namespace dbuf
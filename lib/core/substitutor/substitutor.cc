@@ -15,131 +15,258 @@ the Free Software Foundation, either version 3 of the License, or
 #include "location.hh"
 
 #include <cassert>
+#include <cstddef>
 #include <memory>
-#include <ranges>
 #include <stdexcept>
 
 namespace dbuf {
 
-// Add a new (name -> expression) substitution to last scope
-void Substitutor::AddSubstitution(InternedString name, const std::shared_ptr<const ast::Expression> &expression) {
-  DCHECK(!substitute_.empty());
+// Visitor that substitutes variables of an expression in the given environment. Every visit returns
+// the original pointer if nothing changed inside the visited subtree, so unchanged subtrees are shared
+struct Substitutor::Visitor {
+  const Environment &environment;
+
+  ExpressionPtr operator()(const ExpressionPtr &expression) {
+    return std::visit([this, &expression](const auto &node) { return (*this)(node, expression); }, *expression);
+  }
+
+  // If we want to substitute a binary expression, we need to substitute its left and right parts
+  ExpressionPtr operator()(const ast::BinaryExpression &expression, const ExpressionPtr &self) {
+    ExpressionPtr left  = (*this)(expression.left);
+    ExpressionPtr right = (*this)(expression.right);
+    if (left == expression.left && right == expression.right) {
+      return self;
+    }
+    return std::make_shared<const ast::Expression>(
+        ast::BinaryExpression {{expression.location}, expression.type, std::move(left), std::move(right)});
+  }
+
+  // If we want to substitute an unary expression, we just need to substitute its expression part
+  ExpressionPtr operator()(const ast::UnaryExpression &expression, const ExpressionPtr &self) {
+    ExpressionPtr inner = (*this)(expression.expression);
+    if (inner == expression.expression) {
+      return self;
+    }
+    return std::make_shared<const ast::Expression>(
+        ast::UnaryExpression {{expression.location}, expression.type, std::move(inner)});
+  }
+
+  // To substitute type_expression we need to substitute all of its parameters
+  ExpressionPtr operator()(const ast::TypeExpression &type_expression, const ExpressionPtr &self) {
+    std::vector<ExpressionPtr> parameters;
+    if (!SubstituteAll(type_expression.parameters, &parameters)) {
+      return self;
+    }
+    return std::make_shared<const ast::Expression>(
+        ast::TypeExpression {{type_expression.location}, type_expression.identifier, std::move(parameters)});
+  }
+
+  ExpressionPtr operator()(const ast::Value &value, const ExpressionPtr &self) {
+    // Scalar values have nothing to substitute
+    if (!std::holds_alternative<ast::ConstructedValue>(value)) {
+      return self;
+    }
+
+    // To substitute constucted value we need to subtitute all fields of constructed value
+    const auto &constructed_value = std::get<ast::ConstructedValue>(value);
+    std::vector<std::pair<ast::Identifier, ExpressionPtr>> fields;
+    fields.reserve(constructed_value.fields.size());
+    bool changed = false;
+    for (const auto &[field_identifier, field] : constructed_value.fields) {
+      fields.emplace_back(field_identifier, (*this)(field));
+      changed |= (fields.back().second != field);
+    }
+    if (!changed) {
+      return self;
+    }
+
+    ast::ConstructedValue res;
+    res.location               = constructed_value.location;
+    res.constructor_identifier = constructed_value.constructor_identifier;
+    res.fields                 = std::move(fields);
+
+    return std::make_shared<const ast::Expression>(ast::Value(std::move(res)));
+  }
+
+  ExpressionPtr operator()(const ast::VarAccess &value, const ExpressionPtr &self) {
+    const auto *binding = environment.Find(value.var_identifier.name);
+    if (binding == nullptr) {
+      return self;
+    }
+    return Access(value, Force(**binding));
+  }
+
+  // Substitutes all expressions, returns false and leaves result empty if none of them changed
+  bool SubstituteAll(const std::vector<ExpressionPtr> &expressions, std::vector<ExpressionPtr> *result) {
+    for (size_t id = 0; id < expressions.size(); ++id) {
+      ExpressionPtr substituted = (*this)(expressions[id]);
+      if (result->empty() && substituted == expressions[id]) {
+        continue;
+      }
+      if (result->empty()) {
+        result->reserve(expressions.size());
+        result->insert(result->end(), expressions.begin(), expressions.begin() + static_cast<std::ptrdiff_t>(id));
+      }
+      result->emplace_back(std::move(substituted));
+    }
+    return !result->empty();
+  }
+
+  // Apply field accesses of value to the expression substituted for its head
+  static ExpressionPtr Access(const ast::VarAccess &value, const ExpressionPtr &substitution) {
+    if (std::holds_alternative<ast::VarAccess>(*substitution)) {
+      // Case foo -> var1.var2 for foo.bar, expected result is var1.var2.bar
+      if (value.field_identifiers.empty()) {
+        return substitution;
+      }
+      const auto &substitution_access = std::get<ast::VarAccess>(*substitution);
+
+      // Push substitution fields (var1.var2) first and when all fields of value (bar)
+      std::vector<ast::Identifier> fields = substitution_access.field_identifiers;
+      fields.insert(fields.end(), value.field_identifiers.begin(), value.field_identifiers.end());
+
+      // So we return var1.var2.bar
+      return std::make_shared<const ast::Expression>(
+          ast::VarAccess {substitution_access.var_identifier, std::move(fields)});
+    }
+
+    if (!std::holds_alternative<ast::Value>(*substitution)) {
+      throw std::runtime_error("Substitution error");
+    }
+    const auto &substitution_value = std::get<ast::Value>(*substitution);
+
+    if (!std::holds_alternative<ast::ConstructedValue>(substitution_value)) {
+      DCHECK(value.field_identifiers.empty()) << "Field access on scalar value";
+      return substitution;
+    }
+
+    // If field identifiers are empty, we have the case: n -> Succ {prev: 5},
+    // so we just return Succ {prev: 5} as a result
+    if (value.field_identifiers.empty()) {
+      return substitution;
+    }
+
+    // Else we have case foo -> Foo {bar: some_value} and we need to substitute foo.bar
+    // First we need to find bar field in the substitution
+    const auto &constructed_value = std::get<ast::ConstructedValue>(substitution_value);
+    size_t id                     = 0;
+    for (id = 0; id < constructed_value.fields.size(); ++id) {
+      if (constructed_value.fields[id].first.name == value.field_identifiers[0].name) {
+        break;
+      }
+    }
+    DCHECK(id < constructed_value.fields.size()) << "Unknown field " << value.field_identifiers[0].name;
+
+    // Let's notice that foo.bar.buzz.far with Foo {bar: {buzz: varible}} should return the same
+    // expression as bar.buzz with Bar {buzz: variable}. The expected result in both cases is
+    // variable.bar. That means, that we can go deeper by one field each time
+    const ast::VarAccess next {
+        value.field_identifiers[0],
+        std::vector<ast::Identifier>(value.field_identifiers.begin() + 1, value.field_identifiers.end())};
+
+    return Access(next, constructed_value.fields[id].second);
+  }
+};
+
+// Add a new (name -> expression) substitution to last scope. The expression is not substituted until
+// some variable refers to it
+void Substitutor::AddSubstitution(InternedString name, const ExpressionPtr &expression) {
+  DCHECK(!scopes_.empty());
   DLOG(INFO) << "Adding substitution: " << name << " -> " << *expression;
-  auto expr = std::make_shared<ast::Expression>(std::visit(*this, *expression));
-  DLOG(INFO) << "Added substitution: " << name << " -> " << *expr;
-  substitute_.back().insert_or_assign(name, std::move(expr));
+  environment_ = environment_.Insert(name, std::make_shared<const Binding>(Binding {name, expression, environment_}));
 }
 
 // Add a new scope
 void Substitutor::PushScope() {
   DLOG(INFO) << "Added a scope to substitutor";
-  substitute_.emplace_back();
+  scopes_.push_back(environment_);
 }
 
 void Substitutor::PopScope() {
-  DCHECK(!substitute_.empty());
+  DCHECK(!scopes_.empty());
   DLOG(INFO) << "Popped a scope from substitutor";
-  substitute_.pop_back();
+  environment_ = std::move(scopes_.back());
+  scopes_.pop_back();
 }
 
-// If we want to substitute a binary expression, we need to substitute its left and right parts
-ast::Expression Substitutor::operator()(const ast::BinaryExpression &expression) {
-  return ast::BinaryExpression {
-      {expression.location},
-      expression.type,
-      std::make_unique<ast::Expression>(std::visit(*this, *expression.left)),
-      std::make_unique<ast::Expression>(std::visit(*this, *expression.right))};
+Substitutor::Snapshot Substitutor::Save() const {
+  return environment_;
 }
 
-// If we want to substitute an unary expression, we just need to substitute its expression part
-ast::Expression Substitutor::operator()(const ast::UnaryExpression &expression) {
-  return ast::UnaryExpression {
-      {expression.location},
-      expression.type,
-      std::make_unique<ast::Expression>(std::visit(*this, *expression.expression))};
+void Substitutor::Restore(Snapshot snapshot) {
+  environment_ = std::move(snapshot);
 }
 
-ast::Expression Substitutor::operator()(const ast::VarAccess &value, const ast::ConstructedValue &substitution) {
-  // If field identifiers are empty, we have the case: n -> Succ {prev: 5},
-  // so we just return Succ {prev: 5} as a result
-  if (value.field_identifiers.empty()) {
-    return substitution;
-  }
-
-  // Else we have case foo -> Foo {bar: some_value} and we need to substitute foo.bar
-  // First we need to find bar field in the substitution
-  size_t id = 0;
-  for (id = 0; id < substitution.fields.size(); ++id) {
-    if (substitution.fields[id].first.name == value.field_identifiers[0].name) {
-      break;
-    }
-  }
-
-  // Let's notice that foo.bar.buzz.far with Foo {bar: {buzz: varible}} should return the same
-  // expression as bar.buzz with Bar {buzz: variable}. The expected result in both cases is
-  // variable.bar. That means, that we can go deeper by one field each time
-  const ast::Expression next = ast::VarAccess {
-      value.field_identifiers[0],
-      std::vector<ast::Identifier>(value.field_identifiers.begin() + 1, value.field_identifiers.end())};
-
-  return std::visit(*this, next, *substitution.fields[id].second);
+Substitutor::LazyTypeExpression Substitutor::Lazy(const ast::TypeExpression &type_expression) const {
+  return {type_expression, environment_};
 }
 
-// Case foo -> var1.var2 for foo.bar, expected result if var1.var2.bar
-ast::Expression Substitutor::operator()(const ast::VarAccess &value, const ast::VarAccess &substitution) {
-  // Push substitution fields (var1.var2) first and when all fields except first (bar) of value
-  std::vector<ast::Identifier> fields = substitution.field_identifiers;
-  fields.insert(fields.end(), value.field_identifiers.begin(), value.field_identifiers.end());
+Substitutor::ExpressionPtr Substitutor::operator()(const ExpressionPtr &expression) const {
+  return Substitute(expression, environment_);
+}
 
-  // So we return var1.var2.bar
-  return ast::VarAccess {substitution.var_identifier, fields};
+ast::Expression Substitutor::operator()(const ast::TypeExpression &type_expression) const {
+  return Lazy(type_expression).Force();
 }
 
-ast::Expression Substitutor::operator()(const ast::VarAccess &value) {
-  for (const auto &scope : std::ranges::reverse_view(substitute_)) {
-    auto it = scope.find(value.var_identifier.name);
-    if (it != scope.end()) {
-      return std::visit(*this, ast::Expression(value), *it->second);
-    }
+Substitutor::ExpressionPtr Substitutor::Substitute(const ExpressionPtr &expression, const Environment &environment) {
+  if (environment.Empty()) {
+    return expression;
   }
-
-  return value;
+  return Visitor {environment}(expression);
 }
 
-// To substitute constucted value we need to subtitute all fields of constructed value
-ast::Expression Substitutor::operator()(const ast::ConstructedValue &value) {
-  std::vector<std::pair<ast::Identifier, std::shared_ptr<const ast::Expression>>> fields;
-  fields.reserve(value.fields.size());
-  for (const auto &field : value.fields) {
-    fields.emplace_back(field.first, std::make_shared<const ast::Expression>(std::visit(*this, *field.second)));
+const Substitutor::ExpressionPtr &Substitutor::Force(const Binding &binding) {
+  if (!binding.forced) {
+    binding.forced = Substitute(binding.expression, binding.environment);
+    DLOG(INFO) << "Forced substitution: " << binding.name << " -> " << *binding.forced;
   }
+  return binding.forced;
+}
 
-  ast::ConstructedValue res;
-  res.constructor_identifier.name = value.constructor_identifier.name;
-  res.fields                      = std::move(fields);
+Substitutor::LazyTypeExpression::LazyTypeExpression(const ast::TypeExpression &type_expression)
+    : LazyTypeExpression(type_expression, Environment()) {}
 
-  return res;
-}
+Substitutor::LazyTypeExpression::LazyTypeExpression(
+    const ast::TypeExpression &type_expression,
+    Environment environment)
+    : type_expression_(&type_expression)
+    , environment_(std::move(environment)) {}
 
-ast::Expression Substitutor::operator()(const ast::Value &value) {
-  return std::visit(*this, value);
+const ast::Identifier &Substitutor::LazyTypeExpression::GetIdentifier() const {
+  return type_expression_->identifier;
 }
 
-// To substitute type_expression we need to substitute all of its parameters
-ast::Expression Substitutor::operator()(const ast::TypeExpression &type_expression) {
-  std::vector<std::shared_ptr<const ast::Expression>> parameters;
-  parameters.reserve(type_expression.parameters.size());
+size_t Substitutor::LazyTypeExpression::GetParametersCount() const {
+  return type_expression_->parameters.size();
+}
 
-  for (const auto &parameter : type_expression.parameters) {
-    parameters.emplace_back(std::make_shared<const ast::Expression>(std::visit(*this, *parameter)));
+const Substitutor::ExpressionPtr &Substitutor::LazyTypeExpression::GetParameter(size_t id) const {
+  DCHECK(id < GetParametersCount());
+  if (environment_.Empty()) {
+    return type_expression_->parameters[id];
   }
+  if (parameters_.empty()) {
+    parameters_.resize(GetParametersCount());
+  }
+  if (!parameters_[id]) {
+    parameters_[id] = Substitute(type_expression_->parameters[id], environment_);
+  }
+  return parameters_[id];
+}
 
-  ast::TypeExpression res {
-      {parser::location()},
-      {parser::location(), type_expression.identifier.name},
-      std::move(parameters)};
-
+ast::TypeExpression Substitutor::LazyTypeExpression::Force() const {
+  ast::TypeExpression res {{type_expression_->location}, type_expression_->identifier, {}};
+  res.parameters.reserve(GetParametersCount());
+  for (size_t id = 0; id < GetParametersCount(); ++id) {
+    res.parameters.emplace_back(GetParameter(id));
+  }
   return res;
 }
 
+std::ostream &operator<<(std::ostream &os, const Substitutor::LazyTypeExpression &expr) {
+  os << expr.Force();
+  return os;
+}
+
 } // namespace dbuf
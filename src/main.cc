@@ -9,7 +9,9 @@ the Free Software Foundation, either version 3 of the License, or
 (at your option) any later version.
 */
 #include "CLI/CLI.hpp"
+#include "core/driver/compiler.h"
 #include "core/driver/driver.h"
+#include "core/driver/server.h"
 #include "glog/logging.h"
 
 #include <cstdlib>
@@ -26,10 +28,48 @@ int main(const int argc, const char **argv) {
   std::string dbuf_file;
   std::string dir_path;
   std::vector<std::string> formats;
-  app.add_option("-f,--file", dbuf_file, "dbuf file name")->required();
-  app.add_option("-p,--path", dir_path, "path to generated files")->required();
-  app.add_option("-o", formats, "required formats for generation")->required();
+  dbuf::Driver::Options options;
+  auto *file_option    = app.add_option("-f,--file", dbuf_file, "dbuf file name");
+  auto *path_option    = app.add_option("-p,--path", dir_path, "path to generated files");
+  auto *formats_option = app.add_option("-o", formats, "required formats for generation");
+  app.add_option("-j,--jobs", options.jobs, "number of threads for code generation")->check(CLI::PositiveNumber);
+  app.add_option("--root", options.roots, "generate only this type and the types it uses, can be repeated");
+  app.add_flag("--split-headers", options.cpp.split_headers, "write a c++ header per type and a header including them");
+  app.add_flag("--codecs", options.cpp.codecs, "generate binary encode() and decode() for c++ structs");
+  app.add_flag("--compact-enums", options.cpp.compact_enums, "use a compact tagged union for c++ enums");
+  app.add_flag("--reorder-fields", options.cpp.reorder_fields, "order members of c++ structs to minimize padding");
+  app.add_flag("--pmr", options.cpp.pmr, "use std::pmr::string in c++ structs and generate dbuf::Arena");
+  app.add_flag(
+      "--merge-specializations",
+      options.merge_specializations,
+      "generate at most one hidden type per type, that checks all dependencies at runtime");
+  app.add_option("--merge", options.merged_types, "generate at most one hidden type for this type, can be repeated");
+  app.add_flag("--stats", options.print_stats, "print the number of generated types and specializations");
+
+  std::string socket_path;
+  auto *serve = app.add_subcommand("serve", "keep the compiler running and serve requests on a unix socket");
+  serve->add_option("-s,--socket", socket_path, "path to the unix socket")->required();
+  // Generation flags are accepted after `serve` as well
+  serve->fallthrough();
+  app.require_subcommand(0, 1);
 
   CLI11_PARSE(app, argc, argv);
-  return dbuf::Driver::Run(dbuf_file, dir_path, formats);
+  if (serve->parsed()) {
+    // Generation flags given before `serve` apply to every request
+    dbuf::Compiler::Options server_options;
+    server_options.jobs                  = options.jobs;
+    server_options.roots                 = options.roots;
+    server_options.cpp                   = options.cpp;
+    server_options.merge_specializations = options.merge_specializations;
+    server_options.merged_types          = options.merged_types;
+    return dbuf::Server(socket_path, server_options).Run();
+  }
+
+  // Options of the one-shot compilation are not needed by the server
+  for (const auto *option : {file_option, path_option, formats_option}) {
+    if (option->count() == 0) {
+      return app.exit(CLI::RequiredError(option->get_name()));
+    }
+  }
+  return dbuf::Driver::Run(dbuf_file, dir_path, formats, options);
 }
@@ -0,0 +1,103 @@
+#include "core/codegen/code_writer.h"
+#include "core/interning/interned_string.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dbuf::gen {
+
+TEST(CodeWriterTest, PrintsLikeStream) {
+  CodeWriter writer;
+  std::stringstream expected;
+
+  writer << "struct " << InternedString("Foo") << ' ' << -42 << uint64_t {18446744073709551615ULL} << 2.5 << true;
+  expected << "struct " << InternedString("Foo") << ' ' << -42 << uint64_t {18446744073709551615ULL} << 2.5 << true;
+  EXPECT_EQ(writer.str(), expected.str());
+}
+
+TEST(CodeWriterTest, IndentAndFormat) {
+  CodeWriter writer;
+  writer.Indent(0) << "a\n";
+  writer.Indent(4) << "b\n";
+  writer.Indent(130) << "c\n";
+  writer.Format("str_{}[] = \"{}\";\n", 3, "text");
+
+  EXPECT_EQ(writer.str(), "a\n    b\n" + std::string(130, ' ') + "c\nstr_3[] = \"text\";\n");
+}
+
+TEST(CodeWriterTest, WriteToFile) {
+  const std::string path = "./code_writer_test.txt";
+  CodeWriter writer;
+  writer << "first line\n";
+  EXPECT_TRUE(writer.WriteToFile(path));
+  writer << "second line\n";
+  EXPECT_TRUE(writer.WriteToFile(path));
+
+  std::ifstream file(path);
+  std::stringstream content;
+  content << file.rdbuf();
+  EXPECT_EQ(content.str(), "first line\nsecond line\n");
+  EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+  std::filesystem::remove(path);
+}
+
+TEST(CodeWriterTest, ConcurrentWritersDontShareTemporaryFiles) {
+  const std::string directory = "./code_writer_concurrent_test";
+  const std::string path      = directory + "/generated.h";
+  std::filesystem::create_directory(directory);
+  std::vector<std::string> contents;
+  for (size_t ind = 0; ind < 8; ++ind) {
+    contents.push_back(std::string(1 << 16, static_cast<char>('a' + ind)));
+  }
+
+  std::vector<std::thread> writers;
+  for (const auto &content : contents) {
+    writers.emplace_back([&path, &content] {
+      CodeWriter writer;
+      writer << content;
+      for (size_t iteration = 0; iteration < 16; ++iteration) {
+        writer.WriteToFile(path);
+      }
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+
+  // The file is one of the buffers as a whole and no temporary file is left behind
+  std::ifstream file(path);
+  std::stringstream content;
+  content << file.rdbuf();
+  EXPECT_NE(std::find(contents.begin(), contents.end(), content.str()), contents.end());
+  EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()), 1);
+  std::filesystem::remove_all(directory);
+}
+
+TEST(CodeWriterTest, UnchangedFileIsNotRewritten) {
+  const std::string path = "./code_writer_unchanged_test.txt";
+  CodeWriter writer;
+  writer << "struct Foo {};\n";
+  ASSERT_TRUE(writer.WriteToFile(path));
+  const auto write_time = std::filesystem::last_write_time(path);
+
+  CodeWriter same_writer;
+  same_writer << "struct Foo {};\n";
+  EXPECT_EQ(same_writer.Hash(), writer.Hash());
+  EXPECT_FALSE(same_writer.WriteToFile(path));
+  EXPECT_EQ(std::filesystem::last_write_time(path), write_time);
+
+  CodeWriter other_writer;
+  other_writer << "struct Bar {};\n";
+  EXPECT_NE(other_writer.Hash(), writer.Hash());
+  EXPECT_TRUE(other_writer.WriteToFile(path));
+  std::filesystem::remove(path);
+}
+
+} // namespace dbuf::gen
@@ -0,0 +1,241 @@
+#include "core/driver/compiler.h"
+#include "core/driver/server.h"
+#include "core/interning/interned_string.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace dbuf {
+
+const std::string kCompilerSamplesPath        = "../../test/cpp_test_samples/dbuf_files";
+const std::string kCompilerCorrectSamplesPath = "../../test/cpp_test_samples/correct_cpp_files";
+
+std::string ReadSample(const std::string &path) {
+  std::ifstream file(path);
+  std::stringstream text;
+  text << file.rdbuf();
+  return text.str();
+}
+
+TEST(CompilerTest, GeneratesIntoBuffers) {
+  Compiler compiler;
+  std::vector<Compiler::Output> outputs = {{.format = "cpp", .code = {}}, {.format = "kt", .code = {}}};
+
+  auto diagnostics = compiler.Compile(ReadSample(kCompilerSamplesPath + "/simple_messages.dbuf"), outputs);
+
+  ASSERT_TRUE(diagnostics.empty());
+  EXPECT_EQ(outputs[0].code, ReadSample(kCompilerCorrectSamplesPath + "/simple_messages"));
+  EXPECT_FALSE(outputs[1].code.empty());
+}
+
+TEST(CompilerTest, ReturnsDiagnostics) {
+  Compiler compiler;
+  std::vector<Compiler::Output> outputs = {{.format = "cpp", .code = {}}};
+
+  auto diagnostics = compiler.Compile("message Foo {\n  bar Bar;\n}\n", outputs);
+  ASSERT_FALSE(diagnostics.empty());
+  EXPECT_EQ(diagnostics.front().stage, Compiler::Diagnostic::Stage::kNameResolution);
+  EXPECT_TRUE(outputs[0].code.empty());
+
+  diagnostics = compiler.Compile("message Foo {\n  bar Int\n}\n", outputs);
+  ASSERT_FALSE(diagnostics.empty());
+  EXPECT_EQ(diagnostics.front().stage, Compiler::Diagnostic::Stage::kParsing);
+
+  std::vector<Compiler::Output> unknown_outputs = {{.format = "py", .code = {}}};
+  diagnostics = compiler.Compile("message Foo {}\n", unknown_outputs);
+  ASSERT_EQ(diagnostics.size(), 1U);
+  EXPECT_EQ(diagnostics.front().stage, Compiler::Diagnostic::Stage::kOptions);
+}
+
+TEST(CompilerTest, ReleasesInternedStrings) {
+  Compiler compiler;
+  std::vector<Compiler::Output> outputs = {{.format = "cpp", .code = {}}, {.format = "kt", .code = {}}};
+  const std::string source = "message CompilerTestMessage {\n  compiler_test_field Vec Int 2u;\n}\n";
+  // Strings kept by static variables of the compiler are interned by the first compilation
+  ASSERT_TRUE(compiler.Compile(source, outputs).empty());
+  const InternedString probe("compiler_test_probe");
+  const size_t table_size = InternedString::GetTableSize();
+
+  ASSERT_TRUE(compiler.Compile("message CompilerTestOther {\n  compiler_test_other Int;\n}\n", outputs).empty());
+  EXPECT_EQ(InternedString::GetTableSize(), table_size);
+  EXPECT_EQ(probe.GetString(), "compiler_test_probe");
+
+  // Strings that outlive a compilation keep their ids
+  const InternedString field("compiler_test_field");
+  ASSERT_TRUE(compiler.Compile(source, outputs).empty());
+  EXPECT_EQ(field.GetString(), "compiler_test_field");
+  EXPECT_EQ(InternedString("compiler_test_field"), field);
+}
+
+TEST(CompilerTest, RechecksDependentsOfChangedTypes) {
+  Compiler compiler;
+  std::vector<Compiler::Output> outputs = {{.format = "cpp", .code = {}}};
+  const std::string dependent = "\n\nmessage B (a A) {\n}\n\nmessage C {\n  b B A{x: 5};\n}\n";
+
+  ASSERT_TRUE(compiler.Compile("message A {\n  x Int;\n}" + dependent, outputs).empty());
+  ASSERT_TRUE(compiler.Compile("message A {\n  x Int;\n}" + dependent, outputs).empty());
+
+  auto diagnostics = compiler.Compile("message A {\n  x String;\n}" + dependent, outputs);
+  ASSERT_FALSE(diagnostics.empty());
+  EXPECT_EQ(diagnostics.front().stage, Compiler::Diagnostic::Stage::kTypeChecking);
+
+  EXPECT_TRUE(compiler.Compile("message A {\n  x Int;\n}" + dependent, outputs).empty());
+}
+
+TEST(CompilerTest, KeepsDatatypesOfUnchangedTypes) {
+  Compiler compiler;
+  std::vector<Compiler::Output> outputs = {{.format = "cpp", .code = {}}};
+  const std::string base = "message A {\n  x Int;\n}\n\nmessage B (a A) {\n}\n\n";
+
+  ASSERT_TRUE(compiler.Compile(base + "message C {\n  b B A{x: 5};\n}\n", outputs).empty());
+  // Only C is checked again, against the datatypes of A and B from the first compilation
+  EXPECT_TRUE(compiler.Compile(base + "message C {\n  b B A{x: 6};\n  c B A{x: 7};\n}\n", outputs).empty());
+
+  // A changed definition gets a new datatype, with its own fields
+  const std::string renamed = "message A {\n  y Int;\n}\n\nmessage B (a A) {\n}\n\nmessage C {\n  b B A{y: 5};\n}\n";
+  EXPECT_TRUE(compiler.Compile(renamed, outputs).empty());
+  EXPECT_TRUE(compiler.Compile(base + "message C {\n  b B A{x: 5};\n}\n", outputs).empty());
+
+  // Removed types are forgotten and checked again when they come back
+  EXPECT_TRUE(compiler.Compile("message A {\n  x Int;\n}\n", outputs).empty());
+  auto diagnostics = compiler.Compile(base + "message C {\n  b B A{x: \"five\"};\n}\n", outputs);
+  ASSERT_FALSE(diagnostics.empty());
+  EXPECT_EQ(diagnostics.front().stage, Compiler::Diagnostic::Stage::kTypeChecking);
+}
+
+TEST(CompilerTest, PassesOptionsToGenerators) {
+  Compiler compiler;
+  const std::string source = "message Foo {\n  bar String;\n}\n";
+  std::vector<Compiler::Output> outputs = {{.format = "cpp", .code = {}}};
+
+  ASSERT_TRUE(compiler.Compile(source, outputs).empty());
+  EXPECT_EQ(outputs[0].code.find("encode("), std::string::npos);
+  EXPECT_EQ(outputs[0].code.find("std::pmr::string"), std::string::npos);
+
+  Compiler::Options options;
+  options.cpp.codecs = true;
+  options.cpp.pmr    = true;
+  ASSERT_TRUE(compiler.Compile(source, outputs, options).empty());
+  EXPECT_NE(outputs[0].code.find("encode("), std::string::npos);
+  EXPECT_NE(outputs[0].code.find("std::pmr::string"), std::string::npos);
+}
+
+TEST(CompilerTest, RejectsInvalidOptions) {
+  Compiler compiler;
+  std::vector<Compiler::Output> outputs = {{.format = "cpp", .code = {}}};
+
+  Compiler::Options options;
+  options.merged_types = {"Bar"};
+  auto diagnostics     = compiler.Compile("message Foo {}\n", outputs, options);
+  ASSERT_EQ(diagnostics.size(), 1U);
+  EXPECT_EQ(diagnostics.front().stage, Compiler::Diagnostic::Stage::kOptions);
+  EXPECT_EQ(diagnostics.front().message, "Unknown merged type: Bar");
+
+  options                   = {};
+  options.cpp.split_headers = true;
+  diagnostics               = compiler.Compile("message Foo {}\n", outputs, options);
+  ASSERT_EQ(diagnostics.size(), 1U);
+  EXPECT_EQ(diagnostics.front().stage, Compiler::Diagnostic::Stage::kOptions);
+  EXPECT_TRUE(outputs[0].code.empty());
+}
+
+TEST(ServerTest, HandlesRequests) {
+  Server server("./unused.sock");
+
+  const std::string response = server.HandleRequest("cpp kt\nmessage Foo {\n  bar Int;\n}\n");
+  EXPECT_EQ(response.rfind("output cpp ", 0), 0U);
+  EXPECT_NE(response.find("output kt "), std::string::npos);
+  EXPECT_TRUE(response.ends_with("end\n"));
+
+  const std::string error_response = server.HandleRequest("cpp\nmessage Foo {\n  bar Bar;\n}\n");
+  EXPECT_EQ(error_response.rfind("diagnostic ", 0), 0U);
+  EXPECT_EQ(error_response.find("output "), std::string::npos);
+
+  EXPECT_EQ(server.HandleRequest("stop\n"), "end\n");
+}
+
+TEST(ServerTest, PassesGenerationFlags) {
+  Compiler::Options options;
+  options.cpp.codecs = true;
+  Server server("./unused.sock", options);
+
+  const std::string response = server.HandleRequest("cpp --pmr\nmessage Foo {\n  bar String;\n}\n");
+  EXPECT_EQ(response.rfind("output cpp ", 0), 0U);
+  EXPECT_NE(response.find("encode("), std::string::npos);
+  EXPECT_NE(response.find("std::pmr::string"), std::string::npos);
+
+  // Flags of a request don't stay for the next one
+  const std::string plain_response = server.HandleRequest("cpp\nmessage Foo {\n  bar String;\n}\n");
+  EXPECT_NE(plain_response.find("encode("), std::string::npos);
+  EXPECT_EQ(plain_response.find("std::pmr::string"), std::string::npos);
+
+  const std::string error_response = server.HandleRequest("cpp --unknown\nmessage Foo {}\n");
+  EXPECT_EQ(error_response.rfind("diagnostic 0 ", 0), 0U);
+  EXPECT_EQ(error_response.find("output "), std::string::npos);
+}
+
+int ConnectToServer(const std::string &socket_path) {
+  sockaddr_un address {};
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+  const int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+  // The server may not be listening yet
+  while (connect(connection, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return connection;
+}
+
+std::string SendRequest(const std::string &socket_path, const std::string &request) {
+  const int connection = ConnectToServer(socket_path);
+  EXPECT_EQ(write(connection, request.data(), request.size()), static_cast<ssize_t>(request.size()));
+  shutdown(connection, SHUT_WR);
+  std::string response;
+  char buffer[1 << 12];
+  ssize_t size = 0;
+  while ((size = read(connection, buffer, sizeof(buffer))) > 0) {
+    response.append(buffer, size);
+  }
+  close(connection);
+  return response;
+}
+
+TEST(ServerTest, AnswersWhileAnotherClientIsIdle) {
+  const std::string socket_path = "./concurrent_server.sock";
+  Server server(socket_path);
+  int exit_code = EXIT_FAILURE;
+  std::thread serving([&] { exit_code = server.Run(); });
+
+  // The idle client has sent nothing, the next one is answered anyway
+  const int idle = ConnectToServer(socket_path);
+  const std::string response = SendRequest(socket_path, "cpp\nmessage Foo {\n  bar Int;\n}\n");
+  EXPECT_EQ(response.rfind("output cpp ", 0), 0U);
+  EXPECT_EQ(SendRequest(socket_path, "stop\n"), "end\n");
+  close(idle);
+
+  serving.join();
+  EXPECT_EQ(exit_code, EXIT_SUCCESS);
+}
+
+TEST(ServerTest, KeepsFilesThatAreNotSockets) {
+  const std::string socket_path = "./not_a_socket.sock";
+  std::ofstream(socket_path) << "data";
+
+  Server server(socket_path);
+  EXPECT_EQ(server.Run(), EXIT_FAILURE);
+  EXPECT_EQ(ReadSample(socket_path), "data");
+  unlink(socket_path.c_str());
+}
+
+} // namespace dbuf
@@ -1,10 +1,12 @@
 #include "core/codegen/cpp_gen.h"
 #include "core/driver/driver.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -52,7 +54,439 @@ TEST_P(CPPMessagesCorrectnessTest, MessagesTest) {
   }
 }
 
+TEST_P(CPPMessagesCorrectnessTest, ParallelMessagesTest) {
+  std::string filename             = GetParam();
+  std::string dbuf_filename        = filename + ".dbuf";
+  std::string cpp_filename         = filename + ".h";
+  std::vector<std::string> formats = {"cpp"};
+
+  dbuf::Driver::Options options;
+  options.jobs = 4;
+
+  ASSERT_EQ(driver_->Run(kSamplesPath + dbuf_filename, kGenerationPath, formats, options), EXIT_SUCCESS);
+
+  std::ifstream generated(kGenerationPath + cpp_filename);
+  std::ifstream required(kCorrectSamplesPath + filename);
+  std::stringstream generated_text;
+  std::stringstream required_text;
+  generated_text << generated.rdbuf();
+  required_text << required.rdbuf();
+  ASSERT_EQ(generated_text.str(), required_text.str());
+}
+
+std::string ReadFile(const std::string &path) {
+  std::ifstream file(path);
+  std::stringstream text;
+  text << file.rdbuf();
+  return text.str();
+}
+
+// Generates C++ for a sample into a directory of the test, that is removed after it
+class CPPGenerationTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    const auto *test_info = ::testing::UnitTest::GetInstance()->current_test_info();
+    path_ = std::string("./") + test_info->test_suite_name() + "_" + test_info->name();
+    std::filesystem::create_directory(path_);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(path_);
+  }
+
+  // Returns the header of the sample, empty if it is not generated
+  std::string Generate(const std::string &sample, const dbuf::Driver::Options &options = {}) {
+    std::vector<std::string> formats = {"cpp"};
+    EXPECT_EQ(dbuf::Driver::Run(kSamplesPath + "/" + sample + ".dbuf", path_, formats, options), EXIT_SUCCESS);
+    return ReadFile(path_ + "/" + sample + ".h");
+  }
+
+  std::string path_;
+};
+
+using CPPSplitHeadersTest          = CPPGenerationTest;
+using CPPMergedSpecializationsTest = CPPGenerationTest;
+using CPPCodecsTest                = CPPGenerationTest;
+using CPPDecisionTreeTest          = CPPGenerationTest;
+using CPPPmrTest                   = CPPGenerationTest;
+using CPPCompactEnumsTest          = CPPGenerationTest;
+using CPPReorderFieldsTest         = CPPGenerationTest;
+using CPPColdFieldsTest            = CPPGenerationTest;
+using CPPFixedWidthTest            = CPPGenerationTest;
+using CPPSequenceTest              = CPPGenerationTest;
+
+TEST_P(CPPMessagesCorrectnessTest, PermutedDefinitionsTest) {
+  std::string filename             = GetParam();
+  std::vector<std::string> formats = {"cpp"};
+
+  // Definitions are separated by empty lines
+  std::string source = ReadFile(kSamplesPath + filename + ".dbuf");
+  std::vector<std::string> definitions;
+  for (size_t begin = 0; begin < source.size();) {
+    size_t end = std::min(source.find("\n\n", begin), source.size());
+    definitions.emplace_back(source.substr(begin, end - begin));
+    begin = end + 2;
+  }
+  std::reverse(definitions.begin(), definitions.end());
+  std::ofstream permuted(kGenerationPath + filename + "_permuted.dbuf");
+  for (const auto &definition : definitions) {
+    permuted << definition << "\n\n";
+  }
+  permuted.close();
+
+  ASSERT_EQ(driver_->Run(kSamplesPath + filename + ".dbuf", kGenerationPath, formats), EXIT_SUCCESS);
+  const std::string generated = ReadFile(kGenerationPath + filename + ".h");
+  ASSERT_EQ(driver_->Run(kSamplesPath + filename + ".dbuf", kGenerationPath, formats), EXIT_SUCCESS);
+  ASSERT_EQ(ReadFile(kGenerationPath + filename + ".h"), generated);
+  ASSERT_EQ(driver_->Run(kGenerationPath + filename + "_permuted.dbuf", kGenerationPath, formats), EXIT_SUCCESS);
+  ASSERT_EQ(ReadFile(kGenerationPath + filename + "_permuted.h"), generated);
+}
+
+TEST_P(CPPMessagesCorrectnessTest, SplitHeadersTest) {
+  std::string filename             = GetParam();
+  std::vector<std::string> formats = {"cpp"};
+  dbuf::Driver::Options options;
+  options.cpp.split_headers = true;
+
+  ASSERT_EQ(driver_->Run(kSamplesPath + filename + ".dbuf", kGenerationPath, formats, options), EXIT_SUCCESS);
+
+  // Headers included by the umbrella header have every struct of the single header
+  std::istringstream umbrella(ReadFile(kGenerationPath + filename + ".h"));
+  const std::string include = "#include \"";
+  std::string headers;
+  std::string line;
+  while (std::getline(umbrella, line)) {
+    if (line.starts_with(include)) {
+      const std::string header = line.substr(include.size(), line.size() - include.size() - 1);
+      ASSERT_TRUE(std::filesystem::exists(kGenerationPath + "/" + header)) << header;
+      headers += ReadFile(kGenerationPath + "/" + header);
+    }
+  }
+  std::istringstream single(ReadFile(kCorrectSamplesPath + filename));
+  while (std::getline(single, line)) {
+    if (line.starts_with("struct ")) {
+      EXPECT_NE(headers.find(line), std::string::npos) << line;
+    }
+  }
+}
+
+TEST_F(CPPSplitHeadersTest, HeadersIncludeUsedTypes) {
+  dbuf::Driver::Options options;
+  options.jobs              = 2;
+  options.cpp.split_headers = true;
+
+  Generate("rt_dependent_messages", options);
+
+  // Hidden types are next to the type they specialize
+  const std::string sum = ReadFile(path_ + "/rt_dependent_messages/Sum.h");
+  EXPECT_NE(sum.find("struct Sum_a {"), std::string::npos);
+  const std::string foo = ReadFile(path_ + "/rt_dependent_messages/Foo.h");
+  EXPECT_NE(foo.find("#include \"Sum.h\"\n"), std::string::npos);
+  EXPECT_NE(foo.find("struct Foo_a_b {"), std::string::npos);
+  EXPECT_NE(foo.find("struct Foo_b {"), std::string::npos);
+  EXPECT_EQ(foo.find("struct Sum_a {"), std::string::npos);
+  const std::string kek = ReadFile(path_ + "/rt_dependent_messages/Kek.h");
+  EXPECT_NE(kek.find("#include \"Bar.h\"\n#include \"Foo.h\"\n"), std::string::npos);
+
+  // Kek takes a message as a template parameter, so it can't be declared without its definition
+  const std::string forward = ReadFile(path_ + "/rt_dependent_messages/fwd.h");
+  EXPECT_NE(forward.find("template <int a, int b>\nstruct Foo;\n"), std::string::npos);
+  EXPECT_EQ(forward.find("struct Kek;"), std::string::npos);
+
+  const std::string manifest = ReadFile(path_ + "/rt_dependent_messages.manifest");
+  EXPECT_NE(manifest.find(" rt_dependent_messages/Foo.h\n"), std::string::npos);
+}
+
+TEST_F(CPPMergedSpecializationsTest, SingleHiddenTypePerType) {
+  dbuf::Driver::Options options;
+  options.merge_specializations = true;
+
+  const std::string generated = Generate("rt_dependent_messages", options);
+
+  // Foo_b is replaced by Foo_a_b, that gets the template parameter of Bar in its check
+  EXPECT_EQ(generated.find("struct Foo_b"), std::string::npos);
+  EXPECT_NE(generated.find("struct Foo_a_b {"), std::string::npos);
+  EXPECT_NE(generated.find("Foo_a_b g;"), std::string::npos);
+  EXPECT_NE(generated.find("g.check(c, (e + d))"), std::string::npos);
+}
+
+TEST_F(CPPCodecsTest, DependenciesAreNotEncoded) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs = true;
+
+  const std::string generated = Generate("rt_dependent_messages", options);
+
+  EXPECT_NE(generated.find("#include <string_view>\n"), std::string::npos);
+  EXPECT_NE(generated.find("bool decode_varint(std::string_view &in, unsigned long long &value)"), std::string::npos);
+  // Enums with a single constructor for their template parameters don't write its index, get is found by ADL for both
+  // std::variant and detail::tagged_union
+  EXPECT_NE(
+      generated.find("if constexpr (sizeof...(Ts) == 1) {\n    get<0>(value).encode(out);"),
+      std::string::npos);
+  EXPECT_NE(
+      generated.find("    detail::encode(out, e);\n"
+                     "    detail::encode(out, d);\n"
+                     "    detail::encode(out, f);\n"
+                     "    detail::encode(out, g);\n"
+                     "  }\n"),
+      std::string::npos);
+  EXPECT_NE(
+      generated.find("    return true && detail::decode(in, e) && detail::decode(in, d) && "
+                     "detail::decode(in, f, e, d) && detail::decode(in, g, (e + d));\n"),
+      std::string::npos);
+
+  // Kek gets a, b and f from its template parameters, so only bar is written
+  const size_t kek = generated.find("struct Kek {");
+  ASSERT_NE(kek, std::string::npos);
+  EXPECT_NE(
+      generated.find("  void encode(std::string &out) const {\n    detail::encode(out, bar);\n  }\n", kek),
+      std::string::npos);
+}
+
+TEST_F(CPPCodecsTest, CheckedDecodingPassesDependencies) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs = true;
+
+  const std::string generated = Generate("rt_dependent_messages", options);
+
+  EXPECT_NE(generated.find("#include <type_traits>\n"), std::string::npos);
+  // Runtime dependencies of the fields are computed from the fields decoded before
+  EXPECT_NE(
+      generated.find("  bool decode_checked(std::string_view &in, int a, int b) {\n"
+                     "    return true && detail::decode_checked(in, sum, (-a + b));\n"),
+      std::string::npos);
+  EXPECT_NE(
+      generated.find("    return true && detail::decode_checked(in, e) && detail::decode_checked(in, d) && "
+                     "detail::decode_checked(in, f, e, d) && detail::decode_checked(in, g, (e + d));\n"),
+      std::string::npos);
+}
+
+TEST_F(CPPCodecsTest, CheckedDecodingRejectsConstructorsBeforeDecoding) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs = true;
+
+  const std::string generated = Generate("rt_dependent_enums", options);
+
+  EXPECT_NE(generated.find("  static bool has_constructor(std::size_t tag_"), std::string::npos);
+  EXPECT_NE(
+      generated.find("    return detail::decode_tag(in, value, tag_) && has_constructor(tag_"),
+      std::string::npos);
+}
+
+TEST_F(CPPDecisionTreeTest, CaseLabelsFitDependencies) {
+  const std::string generated = Generate("wide_keys");
+
+  // Int is generated as int, so the key out of its range can't be a case label and never matches
+  EXPECT_NE(generated.find("    switch (a) {\n    case 7:\n"), std::string::npos);
+  EXPECT_EQ(generated.find("case 5000000000:"), std::string::npos);
+}
+
+TEST_F(CPPPmrTest, StringsUseMemoryResource) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs = true;
+  options.cpp.pmr    = true;
+
+  const std::string generated = Generate("simple_messages", options);
+
+  EXPECT_NE(generated.find("#include <memory_resource>\n"), std::string::npos);
+  EXPECT_NE(generated.find("class Arena {"), std::string::npos);
+  EXPECT_EQ(generated.find("set_default_resource"), std::string::npos);
+  EXPECT_NE(generated.find("std::pmr::string "), std::string::npos);
+  EXPECT_EQ(generated.find("  std::string "), std::string::npos);
+}
+
+TEST_F(CPPPmrTest, StructsTakeAllocators) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs = true;
+  options.cpp.pmr    = true;
+
+  const std::string generated = Generate("simple_messages", options);
+
+  // Members using allocators get the one of the struct, the rest are value-initialized
+  EXPECT_NE(
+      generated.find("  using allocator_type = std::pmr::polymorphic_allocator<>;\n"
+                     "  B() = default;\n"
+                     "  explicit B(const allocator_type &alloc)\n"
+                     "      : i()\n"
+                     "      , u()\n"
+                     "      , s(alloc)\n"),
+      std::string::npos);
+  EXPECT_NE(generated.find("      , s(std::move(other.s), alloc)\n"), std::string::npos);
+  // Structs with such members pass the allocator on
+  EXPECT_NE(
+      generated.find("  explicit C(const allocator_type &alloc)\n      : a()\n      , b(alloc) {}\n"),
+      std::string::npos);
+  EXPECT_NE(
+      generated.find("  bool decode(std::string_view &in, const std::pmr::polymorphic_allocator<> &alloc) {\n"
+                     "    detail::reset(s, alloc);\n"),
+      std::string::npos);
+  EXPECT_NE(generated.find(" && detail::decode(in, b, alloc);\n"), std::string::npos);
+}
+
+TEST_F(CPPCompactEnumsTest, EnumsUseTaggedUnion) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs        = true;
+  options.cpp.compact_enums = true;
+
+  const std::string generated = Generate("rt_dependent_enums", options);
+
+  EXPECT_NE(generated.find("class tagged_union {"), std::string::npos);
+  EXPECT_EQ(generated.find("std::variant<"), std::string::npos);
+  EXPECT_NE(generated.find("  detail::tagged_union<Third<a, b>, Fourth<a, b>> value;\n"), std::string::npos);
+  // Constructors are checked by their tags
+  EXPECT_NE(
+      generated.find("    return false || (value.index() == 0 && detail::get<0>(value).check()) ||\n"
+                     "           (value.index() == 1 && detail::get<1>(value).check());\n"),
+      std::string::npos);
+  EXPECT_NE(generated.find("(value.index() == 1 && detail::get<1>(value).check(b))"), std::string::npos);
+}
+
+TEST_F(CPPReorderFieldsTest, MembersAreOrderedByAlignment) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs         = true;
+  options.cpp.reorder_fields = true;
+
+  const std::string generated = Generate("simple_messages", options);
+
+  EXPECT_NE(
+      generated.find("  std::string s;\n"
+                     "  double f;\n"
+                     "  int i;\n"
+                     "  unsigned u;\n"
+                     "  bool b;\n"
+                     "  B() = default;\n"
+                     "  constexpr B(int i, unsigned u, std::string s, double f, bool b)\n"
+                     "      : s(std::move(s))\n"),
+      std::string::npos);
+  // The wire format keeps the order of declaration
+  EXPECT_NE(generated.find("    detail::encode(out, i);\n    detail::encode(out, u);\n"), std::string::npos);
+  EXPECT_NE(
+      generated.find("static_assert(sizeof(D) == detail::min_struct_size<decltype(D::a), decltype(D::b)>());"),
+      std::string::npos);
+  // The alignment of std::string is only estimated, so the layout of B and of C holding it is not asserted
+  EXPECT_EQ(generated.find("static_assert(sizeof(C)"), std::string::npos);
+  // Structs without padding keep the aggregate initialization
+  EXPECT_EQ(generated.find("  D() = default;"), std::string::npos);
+}
+
+TEST_F(CPPColdFieldsTest, ColdFieldsAreAllocatedOnWrite) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs = true;
+
+  const std::string generated = Generate("cold_fields", options);
+
+  EXPECT_NE(generated.find("class cold_storage {"), std::string::npos);
+  EXPECT_NE(
+      generated.find("struct Config {\n"
+                     "  struct Cold {\n"
+                     "    std::string note;\n"
+                     "    double weight;\n"
+                     "  };\n"
+                     "  int id;\n"
+                     "  unsigned hits;\n"
+                     "  detail::cold_storage<Cold> cold_;\n"
+                     "  const std::string &note() const {\n"
+                     "    return cold_.get().note;\n"
+                     "  }\n"
+                     "  std::string &mutable_note() {\n"
+                     "    return cold_.get_or_create().note;\n"
+                     "  }\n"),
+      std::string::npos);
+  // The wire format keeps the order of declaration
+  EXPECT_NE(generated.find("    detail::encode(out, hits);\n    detail::encode(out, note());\n"), std::string::npos);
+  EXPECT_NE(generated.find(" && detail::decode(in, hits) && detail::decode(in, mutable_note())"), std::string::npos);
+  // n is read by the dependency of sized, so it stays a member
+  EXPECT_NE(generated.find("    Config config;\n  };\n  int n;\n"), std::string::npos);
+}
+
+TEST_F(CPPFixedWidthTest, FieldsHaveExactWidths) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs = true;
+
+  const std::string generated = Generate("fixed_width", options);
+
+  EXPECT_NE(generated.find("#include <cstdint>\n"), std::string::npos);
+  EXPECT_NE(generated.find("template <std::uint8_t version>\nstruct Header {\n"), std::string::npos);
+  EXPECT_NE(
+      generated.find("  std::int8_t kind;\n"
+                     "  std::uint32_t length;\n"
+                     "  std::uint32_t checksum;\n"
+                     "  std::int64_t offset;\n"
+                     "  float ratio;\n"),
+      std::string::npos);
+  // Fixed32 has the C++ type of UInt32, but is always written in 4 bytes
+  EXPECT_NE(
+      generated.find("    detail::encode(out, length);\n    detail::encode_fixed(out, checksum);\n"),
+      std::string::npos);
+  EXPECT_NE(generated.find(" && detail::decode(in, length) && detail::decode_fixed(in, checksum)"), std::string::npos);
+}
+
+TEST_F(CPPSequenceTest, LengthsChooseContainers) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs = true;
+
+  const std::string generated = Generate("sequences", options);
+
+  EXPECT_NE(generated.find("#include <array>\n"), std::string::npos);
+  EXPECT_NE(generated.find("#include <vector>\n"), std::string::npos);
+  // Length known at compile time makes an array, the length known only at runtime is checked
+  EXPECT_NE(
+      generated.find("template <unsigned n>\nstruct Group {\n  std::array<User, n> members;\n"),
+      std::string::npos);
+  EXPECT_NE(generated.find("struct Group_n {\n  std::vector<User> members;\n"), std::string::npos);
+  EXPECT_NE(generated.find("return true && members.size() == n;"), std::string::npos);
+  EXPECT_NE(
+      generated.find("  unsigned count;\n"
+                     "  std::vector<int> values;\n"
+                     "  std::array<std::uint32_t, 4> checksums;\n"
+                     "  Group_n group;\n"
+                     "  std::array<Group_n, 2> groups;\n"),
+      std::string::npos);
+  EXPECT_NE(
+      generated.find("std::all_of(groups.begin(), groups.end(), [&](const auto &item) { return item.check(count); })"),
+      std::string::npos);
+  EXPECT_NE(
+      generated.find(" && detail::decode_checked(in, values, count) && detail::decode_fixed(in, checksums) && "
+                     "detail::decode_checked(in, group, count) && detail::decode_checked(in, groups, count);"),
+      std::string::npos);
+  // Lengths aren't written, decode() takes them from the dependencies as well
+  EXPECT_NE(
+      generated.find(" && detail::decode(in, values, count) && detail::decode_fixed(in, checksums) && "
+                     "detail::decode(in, group, count) && detail::decode(in, groups, count);"),
+      std::string::npos);
+}
+
+TEST_F(CPPSequenceTest, IntegerSequencesUseBulkCodecs) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs = true;
+
+  const std::string generated = Generate("sequences", options);
+
+  EXPECT_NE(generated.find("#include <cstring>\n"), std::string::npos);
+  EXPECT_NE(
+      generated.find("#if defined(__x86_64__) && defined(__GNUC__)\n#include <immintrin.h>\n#endif\n"),
+      std::string::npos);
+  EXPECT_NE(generated.find("inline varint_kernel default_varint_kernel() {"), std::string::npos);
+  EXPECT_NE(generated.find("encode_varints(out, value.data(), value.size());"), std::string::npos);
+  EXPECT_NE(generated.find("return decode_varints(in, value.data(), size);"), std::string::npos);
+}
+
+TEST_F(CPPSequenceTest, NoBulkCodecsWithoutSequences) {
+  dbuf::Driver::Options options;
+  options.cpp.codecs = true;
+
+  const std::string generated = Generate("simple_messages", options);
+
+  EXPECT_EQ(generated.find("immintrin.h"), std::string::npos);
+  EXPECT_EQ(generated.find("encode_varints"), std::string::npos);
+}
+
 INSTANTIATE_TEST_SUITE_P(
     CPPGenerationTest,
     CPPMessagesCorrectnessTest,
-    testing::Values("/simple_messages", "/simple_enums", "/rt_dependent_messages", "/rt_dependent_enums"));
\ No newline at end of file
+    testing::Values(
+        "/simple_messages",
+        "/simple_enums",
+        "/rt_dependent_messages",
+        "/rt_dependent_enums",
+        "/rt_dependent_string_enums"));
\ No newline at end of file
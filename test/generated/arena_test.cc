@@ -0,0 +1,107 @@
+#include "round_trip.h"
+
+#include <gtest/gtest.h>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace dbuf {
+
+namespace {
+std::string EncodeDrawing() {
+  Polygon_3_corners polygon;
+  polygon.name = "a polygon with a name longer than the small string buffer";
+  Drawing drawing {};
+  drawing.title       = "a title longer than the small string buffer as well";
+  drawing.corners     = 5;
+  drawing.shape.value = polygon;
+  std::string encoded;
+  drawing.encode(encoded);
+  return encoded;
+}
+} // namespace
+
+TEST(ArenaTest, KeepsTheDefaultResource) {
+  std::pmr::memory_resource *previous = std::pmr::get_default_resource();
+  Arena arena;
+  EXPECT_EQ(std::pmr::get_default_resource(), previous);
+  EXPECT_NE(arena.resource(), previous);
+}
+
+TEST(ArenaTest, ConstructsMembersWithTheAllocator) {
+  Arena arena;
+  Drawing drawing(arena.resource());
+  EXPECT_EQ(drawing.title.get_allocator().resource(), arena.resource());
+
+  // Copies and moves with an allocator take it, the plain ones keep the resource of the source
+  Drawing other {};
+  other.title = "a title longer than the small string buffer";
+  Drawing copy(other, arena.resource());
+  EXPECT_EQ(copy.title, other.title);
+  EXPECT_EQ(copy.title.get_allocator().resource(), arena.resource());
+  Drawing moved(std::move(copy), std::pmr::get_default_resource());
+  EXPECT_EQ(moved.title, other.title);
+  EXPECT_EQ(moved.title.get_allocator().resource(), std::pmr::get_default_resource());
+
+  // Vectors pass their allocator on to the elements
+  std::pmr::vector<Drawing> drawings(arena.resource());
+  drawings.emplace_back();
+  drawings.push_back(other);
+  EXPECT_EQ(drawings[0].title.get_allocator().resource(), arena.resource());
+  EXPECT_EQ(drawings[1].title.get_allocator().resource(), arena.resource());
+}
+
+TEST(ArenaTest, DecodesStringsIntoTheArena) {
+  const std::string encoded = EncodeDrawing();
+
+  Arena arena;
+  Drawing decoded;
+  std::string_view in = encoded;
+  ASSERT_TRUE(decoded.decode_checked(in, arena.resource()));
+  EXPECT_TRUE(in.empty());
+  EXPECT_EQ(decoded.title.get_allocator().resource(), arena.resource());
+  // Constructors of enums are constructed by the enum, so they get the allocator from decode()
+  const auto &name = get<Polygon_3_corners>(decoded.shape.value).name;
+  EXPECT_EQ(name, "a polygon with a name longer than the small string buffer");
+  EXPECT_EQ(name.get_allocator().resource(), arena.resource());
+
+  Drawing unchecked;
+  in = encoded;
+  ASSERT_TRUE(unchecked.decode(in, arena.resource()));
+  EXPECT_EQ(unchecked.title, decoded.title);
+  EXPECT_EQ(unchecked.title.get_allocator().resource(), arena.resource());
+}
+
+TEST(ArenaTest, DecodesSequencesIntoTheArena) {
+  Packet packet {};
+  packet.count  = 2;
+  packet.values = {1, 2};
+  packet.points.resize(2);
+  packet.empties.resize(2);
+  packet.marks.resize(2);
+  packet.batch.items = {3, 4};
+  std::string encoded;
+  packet.encode(encoded);
+
+  Arena arena;
+  Packet decoded;
+  std::string_view in = encoded;
+  ASSERT_TRUE(decoded.decode_checked(in, arena.resource()));
+  EXPECT_EQ(decoded.values.get_allocator().resource(), arena.resource());
+  EXPECT_EQ(decoded.points.get_allocator().resource(), arena.resource());
+  EXPECT_EQ(decoded.batch.items.get_allocator().resource(), arena.resource());
+  EXPECT_EQ(decoded.batch.items, packet.batch.items);
+}
+
+TEST(ArenaTest, DecodingWithoutAllocatorKeepsTheResource) {
+  const std::string encoded = EncodeDrawing();
+
+  Arena arena;
+  Drawing decoded(arena.resource());
+  std::string_view in = encoded;
+  ASSERT_TRUE(decoded.decode(in));
+  EXPECT_EQ(decoded.title.get_allocator().resource(), arena.resource());
+}
+
+} // namespace dbuf
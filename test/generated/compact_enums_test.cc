@@ -0,0 +1,82 @@
+#include "round_trip.h"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+
+namespace dbuf {
+
+Polygon_3_corners MakePolygon(std::string_view name) {
+  Polygon_3_corners polygon;
+  polygon.name = name;
+  return polygon;
+}
+
+TEST(TaggedUnionTest, IsSmall) {
+  // The tag alone for field-less constructors
+  EXPECT_EQ(sizeof(Color), 1U);
+  // Polygon holds a string and is kept out of line, the rest fits next to the tag
+  EXPECT_LE(sizeof(Shape_corners), 2 * sizeof(void *));
+  EXPECT_LE(sizeof(Shape<4>), 2 * sizeof(int) + sizeof(void *));
+}
+
+TEST(TaggedUnionTest, HoldsEveryConstructor) {
+  Shape_corners shape;
+  EXPECT_EQ(shape.value.index(), 0U);
+
+  Square_2_corners square;
+  square.side = 3;
+  shape.value = square;
+  ASSERT_EQ(shape.value.index(), 1U);
+  EXPECT_TRUE(holds_alternative<Square_2_corners>(shape.value));
+  EXPECT_EQ(get<1>(shape.value).side, 3);
+
+  shape.value = MakePolygon("pentagon");
+  ASSERT_EQ(shape.value.index(), 3U);
+  EXPECT_EQ(get<3>(shape.value).name, "pentagon");
+  EXPECT_TRUE(shape.check(5));
+  EXPECT_FALSE(shape.check(4));
+
+  auto &rectangle  = shape.value.emplace<2>();
+  rectangle.width  = 2;
+  rectangle.height = 3;
+  EXPECT_EQ(shape.value.index(), 2U);
+  EXPECT_EQ(visit([](const auto &constructor) { return sizeof(constructor); }, shape.value), sizeof(rectangle));
+}
+
+TEST(TaggedUnionTest, CopiesOutOfLineConstructors) {
+  Shape_corners shape;
+  shape.value = MakePolygon("pentagon");
+
+  Shape_corners copy      = shape;
+  get<3>(copy.value).name = "hexagon";
+  EXPECT_EQ(get<3>(shape.value).name, "pentagon");
+  EXPECT_EQ(get<3>(copy.value).name, "hexagon");
+
+  // Assignment replaces a constructor of another kind
+  Shape_corners square;
+  square.value.emplace<1>().side = 1;
+
+  square = shape;
+  ASSERT_EQ(square.value.index(), 3U);
+  EXPECT_EQ(get<3>(square.value).name, "pentagon");
+  shape = copy;
+  EXPECT_EQ(get<3>(shape.value).name, "hexagon");
+}
+
+TEST(TaggedUnionTest, MovesOutOfLineConstructors) {
+  Shape_corners shape;
+  shape.value             = MakePolygon("pentagon");
+  const std::string *name = &get<3>(shape.value).name;
+
+  Shape_corners moved = std::move(shape);
+  ASSERT_EQ(moved.value.index(), 3U);
+  // The constructor is moved by its pointer
+  EXPECT_EQ(&get<3>(moved.value).name, name);
+
+  // A moved-from value may be assigned to
+  shape = moved;
+  EXPECT_EQ(get<3>(shape.value).name, "pentagon");
+}
+
+} // namespace dbuf
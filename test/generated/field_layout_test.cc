@@ -0,0 +1,35 @@
+#include "round_trip.h"
+
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+
+namespace dbuf {
+
+// Structs with exact alignments are also checked by the static_assert after their definition in round_trip.h
+TEST(FieldLayoutTest, ReorderedStructHasNoPadding) {
+  EXPECT_EQ(sizeof(Sample), (detail::min_struct_size<bool, double, int, bool>()));
+  EXPECT_LT(sizeof(Sample), sizeof(double) * 3);
+  EXPECT_EQ(offsetof(Sample, total), 0U);
+}
+
+TEST(FieldLayoutTest, ConstructorTakesFieldsInOrderOfDeclaration) {
+  const Sample sample(true, 2.5, -3, false);
+  EXPECT_TRUE(sample.valid);
+  EXPECT_EQ(sample.total, 2.5);
+  EXPECT_EQ(sample.count, -3);
+  EXPECT_FALSE(sample.last);
+
+  std::string encoded;
+  sample.encode(encoded);
+  Sample decoded;
+  std::string_view in = encoded;
+  ASSERT_TRUE(decoded.decode_checked(in));
+  EXPECT_TRUE(decoded.valid);
+  EXPECT_EQ(decoded.total, 2.5);
+  EXPECT_EQ(decoded.count, -3);
+  EXPECT_FALSE(decoded.last);
+}
+
+} // namespace dbuf
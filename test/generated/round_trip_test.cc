@@ -0,0 +1,388 @@
+#include "round_trip.h"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dbuf {
+
+constexpr std::string_view kPolygonName = "a polygon with a name longer than the small string buffer";
+
+template <typename T>
+std::string Encode(const T &value) {
+  std::string out;
+  value.encode(out);
+  return out;
+}
+
+// The whole input must be consumed by the value
+template <typename T>
+bool Decode(std::string_view in, T &value) {
+  return value.decode(in) && in.empty();
+}
+
+template <typename T>
+bool DecodeChecked(std::string_view in, T &value) {
+  return value.decode_checked(in) && in.empty();
+}
+
+Drawing MakeDrawing() {
+  Polygon_3_corners polygon;
+  polygon.name = kPolygonName;
+  Circle<0> circle;
+  circle.radius = 0.5;
+
+  Drawing drawing;
+  drawing.title         = "triangle";
+  drawing.corners       = 3;
+  drawing.shape.value   = polygon;
+  drawing.circle.value  = circle;
+  drawing.color.value   = Green {};
+  drawing.visible       = true;
+  drawing.range.point.x = -7;
+  drawing.range.point.y = 300;
+  return drawing;
+}
+
+void ExpectDrawing(const Drawing &drawing) {
+  EXPECT_EQ(drawing.title, "triangle");
+  EXPECT_EQ(drawing.corners, 3U);
+  ASSERT_EQ(drawing.shape.value.index(), 3U);
+  EXPECT_EQ(get<Polygon_3_corners>(drawing.shape.value).name, kPolygonName);
+  EXPECT_EQ(get<Circle<0>>(drawing.circle.value).radius, 0.5);
+  EXPECT_EQ(drawing.color.value.index(), 1U);
+  EXPECT_TRUE(drawing.visible);
+  EXPECT_EQ(drawing.range.point.x, -7);
+  EXPECT_EQ(drawing.range.point.y, 300);
+}
+
+TEST(RoundTripTest, MessagesAndEnums) {
+  const Drawing drawing     = MakeDrawing();
+  const std::string encoded = Encode(drawing);
+
+  Drawing decoded;
+  ASSERT_TRUE(Decode(encoded, decoded));
+  ExpectDrawing(decoded);
+  EXPECT_TRUE(decoded.check());
+  EXPECT_EQ(Encode(decoded), encoded);
+}
+
+TEST(RoundTripTest, EveryConstructor) {
+  Drawing drawing = MakeDrawing();
+  Square_2_corners square;
+  square.side = -1;
+  Rectangle_2_corners rectangle;
+  rectangle.width  = 2;
+  rectangle.height = 3;
+
+  drawing.corners     = 4;
+  drawing.shape.value = square;
+  Drawing decoded;
+  ASSERT_TRUE(Decode(Encode(drawing), decoded));
+  ASSERT_EQ(decoded.shape.value.index(), 1U);
+  EXPECT_EQ(get<Square_2_corners>(decoded.shape.value).side, -1);
+
+  drawing.shape.value = rectangle;
+  ASSERT_TRUE(Decode(Encode(drawing), decoded));
+  ASSERT_EQ(decoded.shape.value.index(), 2U);
+  EXPECT_EQ(get<Rectangle_2_corners>(decoded.shape.value).width, 2);
+  EXPECT_EQ(get<Rectangle_2_corners>(decoded.shape.value).height, 3);
+}
+
+TEST(RoundTripTest, EncodesKnownBytes) {
+  Polygon_3_corners polygon;
+  polygon.name = "pentagon";
+
+  // Dependencies are not written, Range is encoded as its point alone
+  Range<-5, 5> range;
+  range.point.x = -1;
+  range.point.y = 2;
+  EXPECT_EQ(Encode(range), std::string("\x01\x04", 2));
+
+  // Shape 4u has two constructors, Rectangle is the second one
+  Rectangle<4> rectangle;
+  rectangle.width  = 2;
+  rectangle.height = 3;
+  Shape<4> square_or_rectangle;
+  square_or_rectangle.value = rectangle;
+  EXPECT_EQ(Encode(square_or_rectangle), std::string("\x01\x04\x06", 3));
+
+  // Shape 0u has a single constructor, its index is not written
+  Circle<0> circle;
+  circle.radius = 0.5;
+  Shape<0> round;
+  round.value = circle;
+  EXPECT_EQ(Encode(round), std::string("\x00\x00\x00\x00\x00\x00\xe0\x3f", 8));
+
+  // Fields are encoded in the order of declaration, whatever the layout of the struct
+  const Sample sample {true, 2.5, -3, false};
+  EXPECT_EQ(Encode(sample), std::string("\x01\0\0\0\0\0\0\x04\x40\x05\x00", 11));
+
+  // Indices of the constructors are the same for every representation of enums
+  Drawing drawing {};
+  drawing.corners     = 5;
+  drawing.shape.value = polygon;
+  drawing.color.value = Blue {};
+  EXPECT_EQ(Encode(drawing), std::string("\x00\x05\x03\x08pentagon\0\0\0\0\0\0\0\0\x02\x00\x00\x00", 24));
+}
+
+TEST(RoundTripTest, FixedWidthScalars) {
+  Header<1> header {};
+  header.kind     = -2;
+  header.length   = 300;
+  header.checksum = 0x01020304;
+  header.offset   = -1;
+  header.ratio    = 1.0F;
+
+  const std::string encoded = Encode(header);
+  EXPECT_EQ(encoded, std::string("\x03\xac\x02\x04\x03\x02\x01\x01\x00\x00\x80\x3f", 12));
+
+  Header<1> decoded {};
+  ASSERT_TRUE(Decode(encoded, decoded));
+  EXPECT_EQ(decoded.kind, -2);
+  EXPECT_EQ(decoded.length, 300U);
+  EXPECT_EQ(decoded.checksum, 0x01020304U);
+  EXPECT_EQ(decoded.offset, -1);
+  EXPECT_EQ(decoded.ratio, 1.0F);
+
+  // Varint of Int8 kind that doesn't fit in 8 bits
+  EXPECT_FALSE(Decode(std::string("\x80\x02") + encoded.substr(1), decoded));
+}
+
+TEST(RoundTripTest, RejectsTruncatedInput) {
+  const std::string encoded = Encode(MakeDrawing());
+  for (size_t size = 0; size < encoded.size(); ++size) {
+    Drawing decoded;
+    EXPECT_FALSE(Decode(std::string_view(encoded).substr(0, size), decoded)) << size;
+  }
+}
+
+TEST(RoundTripTest, RejectsMalformedValues) {
+  Drawing decoded;
+  std::string encoded = Encode(MakeDrawing());
+  // Index of a constructor that Shape doesn't have
+  const size_t shape_index = 1 + std::string("triangle").size() + 1;
+  ASSERT_EQ(encoded[shape_index], '\x03');
+  encoded[shape_index] = '\x04';
+  EXPECT_FALSE(Decode(encoded, decoded));
+
+  // Bool is a single byte of 0 or 1, visible is followed by the varints of the point
+  encoded = Encode(MakeDrawing());
+  ASSERT_EQ(encoded[encoded.size() - 4], '\x01');
+  encoded[encoded.size() - 4] = '\x02';
+  EXPECT_FALSE(Decode(encoded, decoded));
+
+  // Varint of Unsigned corners that doesn't fit in 32 bits
+  std::string wide = "\x08triangle";
+  wide += "\x80\x80\x80\x80\x80\x01";
+  EXPECT_FALSE(Decode(wide, decoded));
+}
+
+TEST(CheckedDecodingTest, AcceptsValidValues) {
+  const std::string encoded = Encode(MakeDrawing());
+
+  Drawing decoded;
+  ASSERT_TRUE(DecodeChecked(encoded, decoded));
+  ExpectDrawing(decoded);
+  EXPECT_EQ(Encode(decoded), encoded);
+}
+
+TEST(CheckedDecodingTest, RejectsConstructorNotAllowedByDependencies) {
+  // A polygon with 4 corners is well formed, but Shape 4u is either a square or a rectangle
+  Drawing drawing = MakeDrawing();
+  drawing.corners = 4;
+  ASSERT_FALSE(drawing.check());
+  const std::string encoded = Encode(drawing);
+
+  Drawing decoded;
+  EXPECT_TRUE(Decode(encoded, decoded));
+  EXPECT_FALSE(decoded.check());
+  EXPECT_FALSE(DecodeChecked(encoded, decoded));
+}
+
+TEST(CheckedDecodingTest, RejectsTruncatedInput) {
+  const std::string encoded = Encode(MakeDrawing());
+  for (size_t size = 0; size < encoded.size(); ++size) {
+    Drawing decoded;
+    EXPECT_FALSE(DecodeChecked(std::string_view(encoded).substr(0, size), decoded)) << size;
+  }
+}
+
+Packet MakePacket() {
+  Point first {};
+  Point second {};
+  second.x = 1;
+  second.y = -1;
+
+  Packet packet {};
+  packet.version = 1;
+  packet.count   = 2;
+  packet.values  = {-1, 1};
+  packet.sizes   = {1, 2, 3};
+  packet.points  = {first, second};
+  packet.empties.resize(2);
+  packet.marks.resize(2);
+  packet.batch.items = {5, 6};
+  return packet;
+}
+
+TEST(SequenceTest, RoundTrip) {
+  const std::string encoded = Encode(MakePacket());
+  // Lengths are never written, count is written once as a field
+  const std::string header("\x01\x00\x00\0\0\0\0\x00\0\0\0\0", 12);
+  EXPECT_EQ(encoded, header + std::string("\x02\x01\x02\x01\x02\x03\x00\x00\x02\x01\x0a\x0c", 12));
+
+  Packet decoded;
+  ASSERT_TRUE(DecodeChecked(encoded, decoded));
+  EXPECT_EQ(decoded.count, 2U);
+  ASSERT_EQ(decoded.values.size(), 2U);
+  EXPECT_EQ(decoded.values[0], -1);
+  EXPECT_EQ(decoded.values[1], 1);
+  EXPECT_EQ(decoded.sizes[2], 3U);
+  ASSERT_EQ(decoded.points.size(), 2U);
+  EXPECT_EQ(decoded.points[1].x, 1);
+  EXPECT_EQ(decoded.points[1].y, -1);
+  // Elements of Empty and Marker take no bytes
+  EXPECT_EQ(decoded.empties.size(), 2U);
+  EXPECT_EQ(decoded.marks.size(), 2U);
+  // Batch gets its length from the dependency of the hidden type
+  ASSERT_EQ(decoded.batch.items.size(), 2U);
+  EXPECT_EQ(decoded.batch.items[1], 6);
+  EXPECT_EQ(Encode(decoded), encoded);
+}
+
+TEST(SequenceTest, LengthsComeFromDecodedFields) {
+  const std::string encoded = Encode(MakePacket());
+  Packet decoded;
+
+  // With a larger count the sequences take the bytes of the next fields and run out of input
+  std::string longer      = encoded;
+  const size_t count      = 12;
+  longer[count]           = '\x03';
+  EXPECT_FALSE(Decode(longer, decoded));
+  EXPECT_FALSE(DecodeChecked(longer, decoded));
+
+  // With a smaller count the input isn't consumed
+  std::string shorter = encoded;
+  shorter[count]      = '\x01';
+  EXPECT_FALSE(Decode(shorter, decoded));
+  EXPECT_FALSE(DecodeChecked(shorter, decoded));
+}
+
+std::vector<detail::varint_kernel> GetSupportedKernels() {
+  switch (detail::detect_varint_kernel()) {
+  case detail::varint_kernel::avx2:
+    return {detail::varint_kernel::scalar, detail::varint_kernel::sse41, detail::varint_kernel::avx2};
+  case detail::varint_kernel::sse41:
+    return {detail::varint_kernel::scalar, detail::varint_kernel::sse41};
+  case detail::varint_kernel::scalar:
+    break;
+  }
+  return {detail::varint_kernel::scalar};
+}
+
+// Runs of single byte varints, that the vector kernels take in bulk, broken by longer ones
+std::vector<int> MakeVarints() {
+  std::vector<int> values;
+  for (int ind = 0; ind < 1000; ++ind) {
+    if (ind % 37 == 0) {
+      values.push_back(ind % 2 == 0 ? std::numeric_limits<int>::min() : std::numeric_limits<int>::max());
+    } else if (ind % 11 == 0) {
+      values.push_back(ind * 1000);
+    } else {
+      values.push_back(ind % 128 - 64);
+    }
+  }
+  return values;
+}
+
+TEST(SequenceTest, BulkVarintsMatchScalarCodec) {
+  const std::vector<int> values = MakeVarints();
+  std::string expected;
+  for (const int value : values) {
+    detail::encode(expected, value);
+  }
+
+  for (const auto kernel : GetSupportedKernels()) {
+    std::string encoded;
+    detail::encode_varints(encoded, values.data(), values.size(), kernel);
+    EXPECT_EQ(encoded, expected) << static_cast<int>(kernel);
+
+    std::vector<int> decoded(values.size());
+    std::string_view in = encoded;
+    ASSERT_TRUE(detail::decode_varints(in, decoded.data(), decoded.size(), kernel)) << static_cast<int>(kernel);
+    EXPECT_TRUE(in.empty());
+    EXPECT_EQ(decoded, values) << static_cast<int>(kernel);
+
+    // Truncated input and varints wider than the elements are rejected
+    in = std::string_view(encoded).substr(0, encoded.size() - 1);
+    EXPECT_FALSE(detail::decode_varints(in, decoded.data(), decoded.size(), kernel)) << static_cast<int>(kernel);
+    // The element at byte 40 is a single byte varint in a run of them
+    std::string wide = expected;
+    wide.replace(40, 1, "\x80\x80\x80\x80\x80\x01");
+    in = wide;
+    EXPECT_FALSE(detail::decode_varints(in, decoded.data(), decoded.size(), kernel)) << static_cast<int>(kernel);
+  }
+}
+
+TEST(SequenceTest, LongSequenceRoundTrip) {
+  const std::vector<int> values = MakeVarints();
+  Packet packet                 = MakePacket();
+  packet.count                  = static_cast<unsigned>(values.size());
+  packet.values.assign(values.begin(), values.end());
+  packet.points.resize(values.size());
+  packet.empties.resize(values.size());
+  packet.marks.resize(values.size());
+  packet.batch.items.assign(values.begin(), values.end());
+  const std::string encoded = Encode(packet);
+
+  Packet decoded;
+  ASSERT_TRUE(DecodeChecked(encoded, decoded));
+  EXPECT_TRUE(std::equal(decoded.values.begin(), decoded.values.end(), values.begin(), values.end()));
+  EXPECT_EQ(Encode(decoded), encoded);
+}
+
+TEST(ColdFieldsTest, AbsentFieldsHaveDefaultValues) {
+  Settings settings {};
+  settings.id   = 1;
+  settings.hits = 2;
+  EXPECT_EQ(settings.note(), "");
+  EXPECT_EQ(settings.weight(), 0.0);
+  EXPECT_EQ(Encode(settings), std::string("\x02\x02\x00\0\0\0\0\0\0\0\0", 11));
+}
+
+TEST(ColdFieldsTest, RoundTrip) {
+  Settings settings {};
+  settings.id               = -1;
+  settings.mutable_note()   = "rarely read";
+  settings.mutable_weight() = 0.25;
+
+  Settings decoded;
+  ASSERT_TRUE(DecodeChecked(Encode(settings), decoded));
+  EXPECT_EQ(decoded.id, -1);
+  EXPECT_EQ(decoded.hits, 0U);
+  EXPECT_EQ(decoded.note(), "rarely read");
+  EXPECT_EQ(decoded.weight(), 0.25);
+}
+
+TEST(ColdFieldsTest, CopiesAreIndependent) {
+  Settings settings {};
+  settings.mutable_note() = "original";
+
+  Settings copy         = settings;
+  copy.mutable_note()   = "copy";
+  copy.mutable_weight() = 1.5;
+  EXPECT_EQ(settings.note(), "original");
+  EXPECT_EQ(settings.weight(), 0.0);
+  EXPECT_EQ(copy.note(), "copy");
+
+  Settings empty {};
+  copy = empty;
+  EXPECT_EQ(copy.note(), "");
+  EXPECT_EQ(copy.weight(), 0.0);
+}
+
+} // namespace dbuf
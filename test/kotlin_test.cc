@@ -48,7 +48,50 @@ TEST_P(KotlinCodegenerationTest, CorrectGeneration) {
   ASSERT_EQ(generated.eof(), expect.eof());
 }
 
+TEST_P(KotlinCodegenerationTest, ParallelGeneration) {
+  std::string filename    = GetParam();
+  std::string input_file  = kSamplePath + filename + ".dbuf";
+  std::string expect_file = kExpectResultsPath + filename + ".kt";
+  std::string output_file = kGenerationOutputPath + filename + ".kt";
+  std::vector<std::string> output_formats {"kt"};
+
+  ASSERT_EQ(driver_->Run(input_file, kGenerationOutputPath, output_formats, {.jobs = 4}), 0);
+
+  std::ifstream generated(output_file);
+  std::ifstream expect(expect_file);
+
+  while (!generated.eof() && !expect.eof()) {
+    ASSERT_EQ(generated.get(), expect.get());
+  }
+  ASSERT_EQ(generated.eof(), expect.eof());
+}
+
+TEST_P(KotlinCodegenerationTest, GenerationWithOtherTarget) {
+  std::string filename    = GetParam();
+  std::string input_file  = kSamplePath + filename + ".dbuf";
+  std::string expect_file = kExpectResultsPath + filename + ".kt";
+  std::string output_file = kGenerationOutputPath + filename + ".kt";
+  std::vector<std::string> output_formats {"cpp", "kt"};
+
+  ASSERT_EQ(driver_->Run(input_file, kGenerationOutputPath, output_formats), 0);
+  ASSERT_TRUE(std::filesystem::exists(kGenerationOutputPath + filename + ".h"));
+
+  std::ifstream generated(output_file);
+  std::ifstream expect(expect_file);
+
+  while (!generated.eof() && !expect.eof()) {
+    ASSERT_EQ(generated.get(), expect.get());
+  }
+  ASSERT_EQ(generated.eof(), expect.eof());
+}
+
 INSTANTIATE_TEST_SUITE_P(
     KotlinTest,
     KotlinCodegenerationTest,
-    testing::Values("/message", "/enum", "/self_reference", "/simple_constructed", "/hard_constructed"));
+    testing::Values(
+        "/message",
+        "/enum",
+        "/self_reference",
+        "/simple_constructed",
+        "/hard_constructed",
+        "/fixed_width"));
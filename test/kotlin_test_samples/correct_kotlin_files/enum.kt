@@ -461,36 +461,67 @@ class Triple(val n: Long, val m: Long, val k: Kek) {
 
         check(this::inside.isInitialized) {"property inside should be initialized"}
 
-        if (n == 1L) {
-            if (inside is Constructor1) (inside as Constructor1).check()
-            else check(false) {"not valid inside"}
-            return
-        }
-        if (n == 2L && m == 2L) {
-            if (inside is Constructor2) (inside as Constructor2).check()
-            else if (inside is Constructor3) (inside as Constructor3).check()
-            else check(false) {"not valid inside"}
-            return
-        }
-        if (m == 3L) {
-            if (inside is Constructor4) (inside as Constructor4).check()
-            else if (inside is Constructor5) (inside as Constructor5).check()
-            else check(false) {"not valid inside"}
-            return
-        }
-        if (n == 4L && m == -4L) {
-            check(false) {"not valid inside"}
-            return
-        }
-        if (true) {
-            if (inside is Constructor7) (inside as Constructor7).check()
-            else check(false) {"not valid inside"}
-            return
-        }
-        if (n == 4L) {
-            if (inside is Constructor8) (inside as Constructor8).check()
-            else check(false) {"not valid inside"}
-            return
+        when (n) {
+            1L -> {
+                if (inside is Constructor1) (inside as Constructor1).check()
+                else check(false) {"not valid inside"}
+                return
+            }
+            2L -> {
+                when (m) {
+                    2L -> {
+                        if (inside is Constructor2) (inside as Constructor2).check()
+                        else if (inside is Constructor3) (inside as Constructor3).check()
+                        else check(false) {"not valid inside"}
+                        return
+                    }
+                    3L -> {
+                        if (inside is Constructor4) (inside as Constructor4).check()
+                        else if (inside is Constructor5) (inside as Constructor5).check()
+                        else check(false) {"not valid inside"}
+                        return
+                    }
+                    else -> {
+                        if (inside is Constructor7) (inside as Constructor7).check()
+                        else check(false) {"not valid inside"}
+                        return
+                    }
+                }
+            }
+            4L -> {
+                when (m) {
+                    -4L -> {
+                        check(false) {"not valid inside"}
+                        return
+                    }
+                    3L -> {
+                        if (inside is Constructor4) (inside as Constructor4).check()
+                        else if (inside is Constructor5) (inside as Constructor5).check()
+                        else check(false) {"not valid inside"}
+                        return
+                    }
+                    else -> {
+                        if (inside is Constructor7) (inside as Constructor7).check()
+                        else check(false) {"not valid inside"}
+                        return
+                    }
+                }
+            }
+            else -> {
+                when (m) {
+                    3L -> {
+                        if (inside is Constructor4) (inside as Constructor4).check()
+                        else if (inside is Constructor5) (inside as Constructor5).check()
+                        else check(false) {"not valid inside"}
+                        return
+                    }
+                    else -> {
+                        if (inside is Constructor7) (inside as Constructor7).check()
+                        else check(false) {"not valid inside"}
+                        return
+                    }
+                }
+            }
         }
         check(false) {"not valid inside"}
     }
@@ -0,0 +1,311 @@
+package dbuf
+
+// This file is autogenerated. Please, do not change it manually.
+
+class Nop(val code: UByte) {
+    @Throws(IllegalStateException::class) constructor(code: UByte, @Suppress("UNUSED_PARAMETER") _unused: Any) : this(code){
+        check()
+    }
+
+    fun check() {
+    }
+
+    override fun equals(other: Any?): Boolean {
+        if (other !is Nop) return false
+
+        if (this.code != other.code) return false
+
+        return true
+    }
+
+    override fun toString(): String {
+        return toString(1U)
+    }
+
+    fun toString(depth: UInt): String {
+        if (depth == 0U) return "dbuf.Nop@${hashCode().toString(radix=16)}"
+        return "Nop <code = $code> {}"
+    }
+
+    infix internal fun sameFields(other: Any?): Boolean {
+        if (other !is Nop) return false
+
+        return true
+    }
+
+    infix internal fun notSameFields(other: Any?): Boolean {
+        return !(this sameFields other)
+    }
+
+    internal companion object Factory {
+        fun default() : Nop {
+            var return_object = Nop(0u)
+            return return_object
+        }
+        fun make(): Opcode {
+            var return_object = Opcode.default()
+            var inside_object = Nop.default()
+            return_object.inside = inside_object
+            return return_object
+        }
+    }
+}
+
+class Push(val code: UByte) {
+    var value: Short = 0
+
+    @Throws(IllegalStateException::class) constructor(code: UByte, value: Short) : this(code){
+        this.value = value
+
+        check()
+    }
+
+    fun check() {
+    }
+
+    override fun equals(other: Any?): Boolean {
+        if (other !is Push) return false
+
+        if (this.code != other.code) return false
+
+        if (this.value != other.value) return false
+
+        return true
+    }
+
+    override fun toString(): String {
+        return toString(1U)
+    }
+
+    fun toString(depth: UInt): String {
+        if (depth == 0U) return "dbuf.Push@${hashCode().toString(radix=16)}"
+        return "Push <code = $code> {value: $value}"
+    }
+
+    infix internal fun sameFields(other: Any?): Boolean {
+        if (other !is Push) return false
+
+        if (this.value != other.value) return false
+
+        return true
+    }
+
+    infix internal fun notSameFields(other: Any?): Boolean {
+        return !(this sameFields other)
+    }
+
+    internal companion object Factory {
+        fun default() : Push {
+            var return_object = Push(0u)
+            return return_object
+        }
+        fun make(value: Short): Opcode {
+            var return_object = Opcode.default()
+            var inside_object = Push.default()
+            inside_object.value = value
+            return_object.inside = inside_object
+            return return_object
+        }
+    }
+}
+
+class Unknown(val code: UByte) {
+    var raw: ULong = 0UL
+
+    @Throws(IllegalStateException::class) constructor(code: UByte, raw: ULong) : this(code){
+        this.raw = raw
+
+        check()
+    }
+
+    fun check() {
+    }
+
+    override fun equals(other: Any?): Boolean {
+        if (other !is Unknown) return false
+
+        if (this.code != other.code) return false
+
+        if (this.raw != other.raw) return false
+
+        return true
+    }
+
+    override fun toString(): String {
+        return toString(1U)
+    }
+
+    fun toString(depth: UInt): String {
+        if (depth == 0U) return "dbuf.Unknown@${hashCode().toString(radix=16)}"
+        return "Unknown <code = $code> {raw: $raw}"
+    }
+
+    infix internal fun sameFields(other: Any?): Boolean {
+        if (other !is Unknown) return false
+
+        if (this.raw != other.raw) return false
+
+        return true
+    }
+
+    infix internal fun notSameFields(other: Any?): Boolean {
+        return !(this sameFields other)
+    }
+
+    internal companion object Factory {
+        fun default() : Unknown {
+            var return_object = Unknown(0u)
+            return return_object
+        }
+        fun make(raw: ULong): Opcode {
+            var return_object = Opcode.default()
+            var inside_object = Unknown.default()
+            inside_object.raw = raw
+            return_object.inside = inside_object
+            return return_object
+        }
+    }
+}
+
+class Opcode(val code: UByte) {
+    lateinit var inside: Any
+
+    @Throws(IllegalStateException::class) constructor(code: UByte, inside: Any) : this(code) {
+        this.inside = inside
+        check()
+    }
+
+    fun check() {
+        check(this::inside.isInitialized) {"property inside should be initialized"}
+
+        when (code) {
+            (0UL).toUByte() -> {
+                if (inside is Nop) (inside as Nop).check()
+                else check(false) {"not valid inside"}
+                return
+            }
+            (1UL).toUByte() -> {
+                if (inside is Push) (inside as Push).check()
+                else check(false) {"not valid inside"}
+                return
+            }
+            else -> {
+                if (inside is Unknown) (inside as Unknown).check()
+                else check(false) {"not valid inside"}
+                return
+            }
+        }
+        check(false) {"not valid inside"}
+    }
+
+    override fun equals(other: Any?): Boolean {
+        if (other !is Opcode) return false
+
+        if (inside is Nop) return (inside as Nop).equals(other.inside)
+        if (inside is Push) return (inside as Push).equals(other.inside)
+        if (inside is Unknown) return (inside as Unknown).equals(other.inside)
+
+        check(false) {"not valid inside"}
+        return false
+    }
+
+    override fun toString(): String {
+        return toString(1U)
+    }
+
+    fun toString(depth: UInt): String {
+        if (depth == 0U) return "dbuf.Opcode@${hashCode().toString(radix=16)}"
+
+        if (inside is Nop) return "(Opcode) ${(inside as Nop).toString(depth)}"
+        if (inside is Push) return "(Opcode) ${(inside as Push).toString(depth)}"
+        if (inside is Unknown) return "(Opcode) ${(inside as Unknown).toString(depth)}"
+
+        check(false) {"not valid inside"}
+        return "(Opcode) Unknow"
+    }
+
+    infix internal fun sameFields(other: Any?): Boolean {
+        if (other !is Opcode) return false
+
+        if (inside is Nop) return (inside as Nop).sameFields(other.inside)
+        if (inside is Push) return (inside as Push).sameFields(other.inside)
+        if (inside is Unknown) return (inside as Unknown).sameFields(other.inside)
+
+        check(false) {"not valid inside"}
+        return false
+    }
+
+    infix internal fun notSameFields(other: Any?): Boolean {
+        return !(this sameFields other)
+    }
+
+    internal companion object Factory {
+        fun default() : Opcode {
+            var return_object = Opcode(0u)
+            return return_object
+        }
+    }
+}
+
+class Instruction() {
+    var code: UByte = 0u
+    lateinit var operation: Opcode
+
+    @Throws(IllegalStateException::class) constructor(code: UByte, operation: Opcode) : this(){
+        this.code = code
+        this.operation = operation
+
+        check()
+    }
+
+    fun check() {
+        check(this::operation.isInitialized) {"property operation should be initialized"}
+
+        check(operation.code == (code).toUByte()) {"dependency code of operation (is ${operation.code}) should be ${code}"}
+    }
+
+    override fun equals(other: Any?): Boolean {
+        if (other !is Instruction) return false
+
+        if (this.code != other.code) return false
+        if (this.operation != other.operation) return false
+
+        return true
+    }
+
+    override fun toString(): String {
+        return toString(1U)
+    }
+
+    fun toString(depth: UInt): String {
+        if (depth == 0U) return "dbuf.Instruction@${hashCode().toString(radix=16)}"
+        return "Instruction {code: $code, operation: ${operation.toString(depth-1U)}}"
+    }
+
+    infix internal fun sameFields(other: Any?): Boolean {
+        if (other !is Instruction) return false
+
+        if (this.code != other.code) return false
+        if (this.operation notSameFields other.operation) return false
+
+        return true
+    }
+
+    infix internal fun notSameFields(other: Any?): Boolean {
+        return !(this sameFields other)
+    }
+
+    internal companion object Factory {
+        fun default() : Instruction {
+            var return_object = Instruction()
+            return return_object
+        }
+        fun make(code: UByte, operation: Opcode): Instruction {
+            var return_object = Instruction.default()
+            return_object.code = code
+            return_object.operation = operation
+            return return_object
+        }
+    }
+}
+
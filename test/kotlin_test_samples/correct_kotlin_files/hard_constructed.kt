@@ -365,16 +365,18 @@ class HardEnum(val x: Long) {
     fun check() {
         check(this::inside.isInitialized) {"property inside should be initialized"}
 
-        if (x == 1L) {
-            if (inside is Cons2) (inside as Cons2).check()
-            else if (inside is Cons3) (inside as Cons3).check()
-            else check(false) {"not valid inside"}
-            return
-        }
-        if (true) {
-            if (inside is Cons4) (inside as Cons4).check()
-            else check(false) {"not valid inside"}
-            return
+        when (x) {
+            1L -> {
+                if (inside is Cons2) (inside as Cons2).check()
+                else if (inside is Cons3) (inside as Cons3).check()
+                else check(false) {"not valid inside"}
+                return
+            }
+            else -> {
+                if (inside is Cons4) (inside as Cons4).check()
+                else check(false) {"not valid inside"}
+                return
+            }
         }
         check(false) {"not valid inside"}
     }
@@ -135,15 +135,17 @@ class Tree(val height: Long) {
     fun check() {
         check(this::inside.isInitialized) {"property inside should be initialized"}
 
-        if (height == 0L) {
-            if (inside is Leaf) (inside as Leaf).check()
-            else check(false) {"not valid inside"}
-            return
-        }
-        if (true) {
-            if (inside is Node) (inside as Node).check()
-            else check(false) {"not valid inside"}
-            return
+        when (height) {
+            0L -> {
+                if (inside is Leaf) (inside as Leaf).check()
+                else check(false) {"not valid inside"}
+                return
+            }
+            else -> {
+                if (inside is Node) (inside as Node).check()
+                else check(false) {"not valid inside"}
+                return
+            }
         }
         check(false) {"not valid inside"}
     }
@@ -87,6 +87,19 @@ INSTANTIATE_TEST_SUITE_P(
              token::TOK_TRUE,
              token::TOK_RIGHT_BRACE,
              token::TOK_RIGHT_PAREN}),
+        ParamTuple(
+            "s String [cold];",
+            {token::TOK_LC_IDENTIFIER,
+             token::TOK_UC_IDENTIFIER,
+             token::TOK_LEFT_BRACKET,
+             token::TOK_LC_IDENTIFIER,
+             token::TOK_RIGHT_BRACKET,
+             token::TOK_SEMICOLON}),
+        ParamTuple(
+            "5u8 -3i8 1.5f32 7u",
+            {token::TOK_UINT_LITERAL, token::TOK_INT_LITERAL, token::TOK_FLOAT_LITERAL, token::TOK_UINT_LITERAL}),
+        // Literals with a suffix must fit in its type
+        ParamTuple("256u8", {}),
         ParamTuple("message", {token::TOK_MESSAGE}),
         ParamTuple("messages", {token::TOK_LC_IDENTIFIER})));
 
@@ -326,16 +326,16 @@ TEST(NameResolutionTest, UnknownFieldOfConstructor) {
 TEST(NameResolutionTest, UnknownVariable) {
   ast::AST ast;
 
-  std::vector<ast::TypedVariable> message_vec_dependencies;
-  message_vec_dependencies.emplace_back(NameResolutionTest::make_simple_typed_variable("i", "Int"));
-  message_vec_dependencies.emplace_back(NameResolutionTest::make_simple_typed_variable("n", "Int"));
-  ast::Message message_vec         = NameResolutionTest::make_message("Vec", std::move(message_vec_dependencies), {});
-  ast.types[InternedString("Vec")] = std::move(message_vec);
+  std::vector<ast::TypedVariable> message_pair_dependencies;
+  message_pair_dependencies.emplace_back(NameResolutionTest::make_simple_typed_variable("i", "Int"));
+  message_pair_dependencies.emplace_back(NameResolutionTest::make_simple_typed_variable("n", "Int"));
+  ast::Message message_pair         = NameResolutionTest::make_message("Pair", std::move(message_pair_dependencies), {});
+  ast.types[InternedString("Pair")] = std::move(message_pair);
 
   std::vector<std::shared_ptr<const ast::Expression>> parameters;
   parameters.emplace_back(std::make_unique<ast::Expression>(NameResolutionTest::make_var_access("a", {})));
   parameters.emplace_back(std::make_unique<ast::Expression>(NameResolutionTest::make_var_access("b", {})));
-  ast::TypeExpression type_expression = NameResolutionTest::make_type_expression("Vec", std::move(parameters));
+  ast::TypeExpression type_expression = NameResolutionTest::make_type_expression("Pair", std::move(parameters));
 
   std::vector<ast::TypedVariable> message_a_fields;
   message_a_fields.emplace_back(NameResolutionTest::make_typed_variable("field1", std::move(type_expression)));
@@ -0,0 +1,88 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#include "core/substitutor/persistent_map.h"
+
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <string>
+
+namespace dbuf {
+
+// Every key collides with every other key, so all of them end up in the last level of the trie
+struct CollidingHash {
+  size_t operator()(int /*key*/) const {
+    return 0;
+  }
+};
+
+// Keys differ only in the high bits, so they share a long prefix of the trie path
+struct HighBitsHash {
+  size_t operator()(int key) const {
+    return static_cast<size_t>(key) << (8 * sizeof(size_t) - 8);
+  }
+};
+
+TEST(PersistentMapTest, InsertAndFind) {
+  PersistentMap<int, std::string> map;
+  EXPECT_TRUE(map.Empty());
+  EXPECT_EQ(map.Find(1), nullptr);
+
+  for (int i = 0; i < 1000; ++i) {
+    map = map.Insert(i, std::to_string(i));
+  }
+  EXPECT_EQ(map.Size(), 1000U);
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_NE(map.Find(i), nullptr);
+    EXPECT_EQ(*map.Find(i), std::to_string(i));
+  }
+  EXPECT_EQ(map.Find(1000), nullptr);
+}
+
+TEST(PersistentMapTest, OldVersionsAreUnchanged) {
+  PersistentMap<int, int> before;
+  for (int i = 0; i < 100; ++i) {
+    before = before.Insert(i, i);
+  }
+
+  PersistentMap<int, int> after = before.Insert(5, -5).Insert(100, 100);
+  EXPECT_EQ(before.Size(), 100U);
+  EXPECT_EQ(after.Size(), 101U);
+  EXPECT_EQ(*before.Find(5), 5);
+  EXPECT_EQ(*after.Find(5), -5);
+  EXPECT_EQ(before.Find(100), nullptr);
+  EXPECT_EQ(*after.Find(100), 100);
+}
+
+TEST(PersistentMapTest, HashCollisions) {
+  PersistentMap<int, int, CollidingHash> map;
+  for (int i = 0; i < 10; ++i) {
+    map = map.Insert(i, i);
+  }
+  map = map.Insert(3, 30);
+  EXPECT_EQ(map.Size(), 10U);
+  EXPECT_EQ(*map.Find(3), 30);
+  EXPECT_EQ(*map.Find(9), 9);
+  EXPECT_EQ(map.Find(10), nullptr);
+}
+
+TEST(PersistentMapTest, SharedHashPrefix) {
+  PersistentMap<int, int, HighBitsHash> map;
+  for (int i = 0; i < 200; ++i) {
+    map = map.Insert(i, i);
+  }
+  EXPECT_EQ(map.Size(), 200U);
+  for (int i = 0; i < 200; ++i) {
+    ASSERT_NE(map.Find(i), nullptr);
+    EXPECT_EQ(*map.Find(i), i);
+  }
+}
+
+} // namespace dbuf
@@ -0,0 +1,121 @@
+/*
+This file is part of DependoBuf project.
+
+Copyright (C) 2023 Alexander Bogdanov, Alice Vernigor
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+#include "core/ast/ast.h"
+#include "core/checker/checker.h"
+#include "core/ir/reachability.h"
+#include "core/ir/schema.h"
+#include "core/parser/parse_helper.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace dbuf {
+
+const std::string kSchemaSample = "../../test/cpp_test_samples/dbuf_files/rt_dependent_enums.dbuf";
+
+TEST(SchemaTest, HiddenSpecializations) {
+  std::ifstream input_file(kSchemaSample);
+  ASSERT_TRUE(input_file.is_open());
+  ast::AST ast;
+  parser::ParseHelper parse_helper(input_file, std::cout, &ast);
+  ASSERT_NO_THROW(parse_helper.Parse());
+  ASSERT_EQ(checker::Checker::CheckAll(ast), EXIT_SUCCESS);
+
+  const ir::Schema schema(ast);
+  ASSERT_EQ(schema.GetTypes().size(), 2U);
+  EXPECT_FALSE(schema.FindType(InternedString("Int")).has_value());
+
+  const auto now = schema.FindType(InternedString("Now"));
+  ASSERT_TRUE(now.has_value());
+  const auto &fields = schema.GetSpecialization(schema.GetType(*now).declared).fields;
+  ASSERT_EQ(fields.size(), 3U);
+
+  // c is a builtin field, d1 and d2 depend on it
+  EXPECT_FALSE(fields[0].type.has_value());
+  EXPECT_FALSE(fields[0].specialization.has_value());
+  ASSERT_TRUE(fields[1].specialization.has_value());
+  ASSERT_TRUE(fields[2].specialization.has_value());
+
+  const auto &d1 = schema.GetSpecialization(*fields[1].specialization);
+  EXPECT_EQ(d1.name, InternedString("Dependent_b"));
+  EXPECT_EQ(d1.is_runtime, std::vector<bool>({false, true}));
+  ASSERT_EQ(d1.static_dependencies.size(), 1U);
+  EXPECT_EQ(d1.static_dependencies[0].name, InternedString("a"));
+
+  const auto &d2 = schema.GetSpecialization(*fields[2].specialization);
+  EXPECT_EQ(d2.name, InternedString("Dependent_a_b"));
+  EXPECT_TRUE(d2.static_dependencies.empty());
+  ASSERT_EQ(d2.constructors.size(), 5U);
+  const std::vector<size_t> rules = {0, 1, 2, 2, 3};
+  for (size_t tag = 0; tag < d2.constructors.size(); ++tag) {
+    EXPECT_EQ(d2.constructors[tag].tag, tag);
+    EXPECT_EQ(d2.constructors[tag].rule, rules[tag]);
+  }
+  EXPECT_EQ(d2.constructors[3].name, InternedString("Fourth_3_a_b"));
+
+  // Both declared types and the two hidden ones
+  EXPECT_EQ(schema.GetSpecializations().size(), 4U);
+}
+
+TEST(SchemaTest, MergedSpecializations) {
+  std::ifstream input_file(kSchemaSample);
+  ASSERT_TRUE(input_file.is_open());
+  ast::AST ast;
+  parser::ParseHelper parse_helper(input_file, std::cout, &ast);
+  ASSERT_NO_THROW(parse_helper.Parse());
+  ASSERT_EQ(checker::Checker::CheckAll(ast), EXIT_SUCCESS);
+
+  const ir::Schema schema(ast, {.merged_types = {InternedString("Dependent")}});
+  EXPECT_EQ(schema.GetHiddenSpecializationsCount(), 1U);
+  const auto now = schema.FindType(InternedString("Now"));
+  ASSERT_TRUE(now.has_value());
+  const auto &fields = schema.GetSpecialization(schema.GetType(*now).declared).fields;
+  ASSERT_EQ(fields.size(), 3U);
+  ASSERT_TRUE(fields[1].specialization.has_value());
+  EXPECT_EQ(fields[1].specialization, fields[2].specialization);
+  EXPECT_EQ(schema.GetSpecialization(*fields[1].specialization).name, InternedString("Dependent_a_b"));
+}
+
+TEST(SchemaTest, PruneUnreachableTypes) {
+  std::istringstream input(
+      "message Unused {\n  x Int;\n}\n\n"
+      "message Size {\n  n Int;\n}\n\n"
+      "enum Shape (size Size) {\n  * => {\n    Circle {\n      r Int;\n    }\n  }\n}\n\n"
+      "message Root (s Size) {\n  shape Shape s;\n}\n\n"
+      "message Other {\n  shape Shape (Size{n: 1});\n}\n");
+  ast::AST ast;
+  parser::ParseHelper parse_helper(input, std::cout, &ast);
+  ASSERT_NO_THROW(parse_helper.Parse());
+  ASSERT_EQ(checker::Checker::CheckAll(ast), EXIT_SUCCESS);
+
+  const auto unknown_roots = ir::PruneUnreachableTypes(ast, {InternedString("Root"), InternedString("Missing")});
+  ASSERT_EQ(unknown_roots, std::vector<InternedString>({InternedString("Missing")}));
+  EXPECT_EQ(ast.types.size(), 5U);
+
+  ASSERT_TRUE(ir::PruneUnreachableTypes(ast, {InternedString("Root")}).empty());
+  EXPECT_EQ(
+      ast.visit_order,
+      std::vector<InternedString>({InternedString("Size"), InternedString("Shape"), InternedString("Root")}));
+  EXPECT_EQ(ast.types.size(), 3U);
+  EXPECT_FALSE(ast.constructor_to_type.contains(InternedString("Other")));
+  EXPECT_TRUE(ast.constructor_to_type.contains(InternedString("Circle")));
+
+  const ir::Schema schema(ast);
+  EXPECT_EQ(schema.GetTypes().size(), 3U);
+  EXPECT_FALSE(schema.FindType(InternedString("Unused")).has_value());
+}
+
+} // namespace dbuf